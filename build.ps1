@@ -8,6 +8,9 @@ Param (
 	[parameter(HelpMessage = "Build the Kubernetes device plugins only, do not build the device discovery library or container images")]
 	[switch] $PluginsOnly,
 	
+	[parameter(HelpMessage = "Count the heap allocations performed by the device discovery library, for use with the benchmark programs")]
+	[switch] $CountAllocations,
+	
 	[parameter(HelpMessage = "Build container images for the Kubernetes device plugins")]
 	[switch] $Images,
 	
@@ -190,7 +193,8 @@ if (!$PluginsOnly)
 	Run-Command cmake "$PSScriptRoot/library" `
 		-A x64 -DVCPKG_TARGET_TRIPLET=x64-windows `
 		"-DCMAKE_INSTALL_PREFIX=$PSScriptRoot" `
-		"-DCMAKE_TOOLCHAIN_FILE=$vcpkgDir\scripts\buildsystems\vcpkg.cmake" 
+		"-DCMAKE_TOOLCHAIN_FILE=$vcpkgDir\scripts\buildsystems\vcpkg.cmake" `
+		"-DDISCOVERY_COUNT_ALLOCATIONS=$(if ($CountAllocations) { 'ON' } else { 'OFF' })"
 	Run-Command cmake --build . --target install --config Release
 	Pop-Location
 }
@@ -1,5 +1,11 @@
 #pragma once
 #include "DeviceFilter.h"
+#include "DeviceSnapshot.h"
+#include "DeviceHealth.h"
+#include "DeviceUsage.h"
+#include "DiscoveryMetrics.h"
+#include "DiscoveryBackend.h"
+#include "StringProperty.h"
 
 #define DLLEXPORT __declspec(dllexport)
 
@@ -10,6 +16,9 @@ extern "C" {
 // Opaque pointer type for DeviceDiscovery instances
 typedef void* DeviceDiscoveryInstance;
 
+// Opaque pointer type for handles to immutable device snapshots
+typedef void* DeviceDiscoverySnapshot;
+
 // Returns the version string for the device discovery library
 DLLEXPORT const wchar_t* GetDiscoveryLibraryVersion();
 
@@ -19,19 +28,42 @@ DLLEXPORT void DisableDiscoveryLogging();
 // Enables verbose logging for the device discovery library
 DLLEXPORT void EnableDiscoveryLogging();
 
-// Creates a new DeviceDiscovery instance
+// Enables verbose logging for the device discovery library, routing messages to an in-memory ring buffer that retains up to the specified number of
+// messages rather than writing them to stdout. Messages are retrieved with DrainDiscoveryLog(), and when the buffer is full the oldest messages are
+// overwritten. This should be called before any DeviceDiscovery instances are created, since it replaces the library's default logger.
+DLLEXPORT void EnableDiscoveryLogBuffer(unsigned int capacity);
+
+// Moves as many of the oldest buffered log messages as will fit into the supplied buffer, and returns the number of bytes written (or 0 if no
+// messages are buffered), or -1 if the ring buffer has not been enabled. Each message is a NUL-terminated UTF-8 string with tab-separated
+// timestamp, level, source location, function and message fields. Callers should drain repeatedly until 0 is returned to retrieve all messages.
+DLLEXPORT int DrainDiscoveryLog(char* buffer, unsigned int size);
+
+// Returns the number of heap allocations performed by the device discovery library since it was loaded, for use when benchmarking.
+// This is a process-wide count that includes allocations made by all DeviceDiscovery instances and their worker threads.
+// Allocations are only counted if the library was built with the DISCOVERY_COUNT_ALLOCATIONS CMake option enabled, and zero is returned otherwise.
+DLLEXPORT unsigned long long GetDiscoveryAllocationCount();
+
+// Creates a new DeviceDiscovery instance that uses the default discovery backend (WMI)
 DLLEXPORT DeviceDiscoveryInstance CreateDeviceDiscoveryInstance();
 
+// Creates a new DeviceDiscovery instance that uses the specified discovery backend, or returns a NULL pointer if the backend is invalid
+DLLEXPORT DeviceDiscoveryInstance CreateDeviceDiscoveryInstanceWithBackend(int backend);
+
 // Frees the memory for a DeviceDiscovery instance
 DLLEXPORT void DestroyDeviceDiscoveryInstance(DeviceDiscoveryInstance instance);
 
-// Retrieves the error message for the last operation performed by the DeviceDiscovery instance.
-// If the last operation succeeded then an empty string will be returned.
+// Retrieves the error message for the last operation performed by the calling thread on a DeviceDiscovery instance.
+// If the last operation succeeded then an empty string will be returned. Error messages are tracked per thread, so concurrent callers do not overwrite one another's errors.
 DLLEXPORT const wchar_t* DeviceDiscovery_GetLastErrorMessage(DeviceDiscoveryInstance instance);
 
-// Determines whether the current device list is stale and needs to be refreshed by performing device discovery again
+// Determines whether the current device list is stale and needs to be refreshed by performing device discovery again.
+// Returns 1 if a refresh is required, 0 if it is not, or -1 if the adapter list could not be queried.
 DLLEXPORT int DeviceDiscovery_IsRefreshRequired(DeviceDiscoveryInstance instance);
 
+// Retrieves the handle of an auto-reset Win32 event that is signalled when the device list becomes stale, or a NULL pointer if notifications are unavailable.
+// The handle is owned by the DeviceDiscovery instance and must not be closed by the caller. It remains valid until the instance is destroyed.
+DLLEXPORT void* DeviceDiscovery_GetRefreshEventHandle(DeviceDiscoveryInstance instance);
+
 // Performs device discovery. Returns 0 on success and -1 on failure.
 // Call GetLastErrorMessage to retrieve the error details for a failure.
 DLLEXPORT int DeviceDiscovery_DiscoverDevices(DeviceDiscoveryInstance instance, int filter, int includeIntegrated, int includeDetachable);
@@ -42,6 +74,8 @@ DLLEXPORT int DeviceDiscovery_GetNumDevices(DeviceDiscoveryInstance instance);
 DLLEXPORT long long DeviceDiscovery_GetDeviceAdapterLUID(DeviceDiscoveryInstance instance, unsigned int device);
 
 // Returns the unique ID of the device with the specified index, or a NULL pointer if the specified device index is invalid
+// (The pointers returned by this and the other per-device string functions remain valid only until the next device discovery, so callers
+// that perform device discovery concurrently with reading device details must read them through a snapshot handle instead)
 DLLEXPORT const wchar_t* DeviceDiscovery_GetDeviceID(DeviceDiscoveryInstance instance, unsigned int device);
 
 DLLEXPORT const wchar_t* DeviceDiscovery_GetDeviceDescription(DeviceDiscoveryInstance instance, unsigned int device);
@@ -54,6 +88,25 @@ DLLEXPORT const wchar_t* DeviceDiscovery_GetDeviceLocationPath(DeviceDiscoveryIn
 
 DLLEXPORT const wchar_t* DeviceDiscovery_GetDeviceVendor(DeviceDiscoveryInstance instance, unsigned int device);
 
+// Returns the PCIe root complex under which the device is located (e.g. "PCIROOT(0)"), or an empty string if it is unknown
+DLLEXPORT const wchar_t* DeviceDiscovery_GetDevicePcieRoot(DeviceDiscoveryInstance instance, unsigned int device);
+
+// Returns the NUMA node to which the device is attached, DEVICE_NUMA_NODE_UNKNOWN if the device does not report one,
+// or -1 if the specified device index is invalid
+DLLEXPORT int DeviceDiscovery_GetDeviceNumaNode(DeviceDiscoveryInstance instance, unsigned int device);
+
+// Returns the version number of the device's driver, or -1 if the specified device index is invalid
+DLLEXPORT long long DeviceDiscovery_GetDeviceDriverVersion(DeviceDiscoveryInstance instance, unsigned int device);
+
+// Returns the WDDM or MCDM version of the device's kernel-mode driver as a D3DKMT_DRIVERVERSION value, or -1 if the specified device index is invalid
+DLLEXPORT int DeviceDiscovery_GetDeviceKmdModelVersion(DeviceDiscoveryInstance instance, unsigned int device);
+
+// Returns the number of bytes of dedicated adapter memory for the device, or -1 if the specified device index is invalid
+DLLEXPORT long long DeviceDiscovery_GetDeviceDedicatedMemory(DeviceDiscoveryInstance instance, unsigned int device);
+
+// Returns the number of bytes of system memory that the device can share with the CPU, or -1 if the specified device index is invalid
+DLLEXPORT long long DeviceDiscovery_GetDeviceSharedMemory(DeviceDiscoveryInstance instance, unsigned int device);
+
 DLLEXPORT int DeviceDiscovery_GetNumRuntimeFiles(DeviceDiscoveryInstance instance, unsigned int device);
 
 DLLEXPORT const wchar_t* DeviceDiscovery_GetRuntimeFileSource(DeviceDiscoveryInstance instance, unsigned int device, unsigned int file);
@@ -74,6 +127,61 @@ DLLEXPORT int DeviceDiscovery_DoesDeviceSupportDisplay(DeviceDiscoveryInstance i
 
 DLLEXPORT int DeviceDiscovery_DoesDeviceSupportCompute(DeviceDiscoveryInstance instance, unsigned int device);
 
+// Returns a string property of a device, as specified by one of the DEVICESTRING_* values in StringProperty.h, or a NULL pointer if the device index or property is invalid.
+// If length is not NULL then the length of the string in UTF-16 code units (excluding the NUL terminator) is stored in the location it points to, so the caller
+// can decode the string directly without scanning it for its terminator. The pointer remains valid only until the next device discovery.
+DLLEXPORT const wchar_t* DeviceDiscovery_GetDeviceString(DeviceDiscoveryInstance instance, unsigned int device, int property, unsigned int* length);
+
+// Returns a string property of a runtime file, as specified by one of the RUNTIMEFILESTRING_* values in StringProperty.h, or a NULL pointer if the device index,
+// file index or property is invalid. The length is reported in the same manner as DeviceDiscovery_GetDeviceString.
+DLLEXPORT const wchar_t* DeviceDiscovery_GetRuntimeFileString(DeviceDiscoveryInstance instance, unsigned int device, unsigned int file, int property, unsigned int* length);
+
+// Copies a snapshot of the details of all devices found by the last device discovery into the supplied buffer, using the format described in DeviceSnapshot.h.
+// Returns the size of the snapshot in bytes, or -1 if device discovery has not been performed. If the buffer is NULL or smaller than the snapshot
+// then nothing is copied, and the caller should retry with a buffer of at least the returned size.
+DLLEXPORT int DeviceDiscovery_GetSnapshot(DeviceDiscoveryInstance instance, void* buffer, unsigned int size);
+
+// Specifies the path to a file used to cache device details between instances, or disables caching if the path is NULL or empty (the default).
+// Valid cached details are reported by the first device discovery and then revalidated by a subsequent device discovery, for which a refresh is requested.
+// This must be called before the first device discovery is performed. Returns 0 on success and -1 on failure.
+DLLEXPORT int DeviceDiscovery_SetCacheFile(DeviceDiscoveryInstance instance, const wchar_t* path);
+
+// Copies the timing metrics for each discovery phase into the supplied array, with the records aggregated across all devices listed first.
+// Returns the number of records. If the array is NULL or has fewer elements than the number of records then nothing is copied,
+// and the caller should retry with an array of at least the returned size.
+DLLEXPORT int DeviceDiscovery_GetMetrics(DeviceDiscoveryInstance instance, DiscoveryMetricsRecord* records, unsigned int count);
+
+// Samples the memory usage and engine utilisation of each device found by the last device discovery and copies the samples into the supplied array.
+// Engine utilisation is measured since the previous sample, so this should be called periodically. Returns the number of records copied, which may be
+// fewer than the number of devices if the statistics for a device could not be queried, or -1 if device discovery has not been performed. If the array
+// is NULL or has fewer elements than the number of devices then no sample is taken and the number of devices is returned instead.
+DLLEXPORT int DeviceDiscovery_GetDeviceUsage(DeviceDiscoveryInstance instance, DeviceUsageRecord* records, unsigned int count);
+
+// Checks the health of each device found by the last device discovery without performing device discovery again, and copies the results into the supplied array.
+// Driver resets are detected since the previous health check, so this should be called periodically. Returns the number of records copied, or -1 if device
+// discovery has not been performed. If the array is NULL or has fewer elements than the number of devices then no check is performed and the number of devices is returned.
+DLLEXPORT int DeviceDiscovery_CheckDeviceHealth(DeviceDiscoveryInstance instance, DeviceHealthRecord* records, unsigned int count);
+
+// Acquires a handle to an immutable snapshot of the devices found by the last device discovery, or returns a NULL pointer if device discovery has not been performed.
+// The snapshot remains valid after subsequent device discovery operations until it is released, so it can be read from any thread without locking while
+// device discovery is performed again in the background. The pointers returned by the per-device functions above remain valid only until the next device discovery.
+DLLEXPORT DeviceDiscoverySnapshot DeviceDiscovery_AcquireSnapshot(DeviceDiscoveryInstance instance);
+
+// Acquires a handle to an immutable snapshot of the subset of devices found by the last device discovery whose adapters match the supplied filtering criteria,
+// or returns a NULL pointer if device discovery has not been performed. This allows a single device discovery performed with DeviceFilter::AllDevices that
+// includes integrated and detachable devices to serve multiple clients with different criteria. The handle is released with DeviceDiscovery_ReleaseSnapshot.
+DLLEXPORT DeviceDiscoverySnapshot DeviceDiscovery_AcquireFilteredSnapshot(DeviceDiscoveryInstance instance, int filter, int includeIntegrated, int includeDetachable);
+
+// Releases a handle acquired by DeviceDiscovery_AcquireSnapshot. The handle and any data pointers retrieved from it must not be used after it has been released.
+DLLEXPORT void DeviceDiscovery_ReleaseSnapshot(DeviceDiscoverySnapshot snapshot);
+
+// Returns the number of devices in a snapshot
+DLLEXPORT unsigned int DeviceDiscoverySnapshot_GetNumDevices(DeviceDiscoverySnapshot snapshot);
+
+// Returns a pointer to the serialised data for a snapshot, using the format described in DeviceSnapshot.h, and stores its size in bytes in the location pointed to by size.
+// The data is read directly from the snapshot without copying, and remains valid until the snapshot is released.
+DLLEXPORT const void* DeviceDiscoverySnapshot_GetData(DeviceDiscoverySnapshot snapshot, unsigned int* size);
+
 #ifdef __cplusplus
 } // extern "C"
 
@@ -114,6 +222,14 @@ class DeviceDiscovery
 			this->instance = CreateDeviceDiscoveryInstance();
 		}
 		
+		inline DeviceDiscovery(DiscoveryBackend backend)
+		{
+			this->instance = CreateDeviceDiscoveryInstanceWithBackend(static_cast<int>(backend));
+			if (this->instance == nullptr) {
+				throw DeviceDiscoveryException(L"failed to create a DeviceDiscovery instance for the specified discovery backend");
+			}
+		}
+		
 		inline ~DeviceDiscovery()
 		{
 			DestroyDeviceDiscoveryInstance(this->instance);
@@ -124,12 +240,19 @@ class DeviceDiscovery
 			return DeviceDiscovery_GetLastErrorMessage(this->instance);
 		}
 		
-		inline bool IsRefreshRequired() {
-			return DeviceDiscovery_IsRefreshRequired(this->instance);
+		inline void* GetRefreshEventHandle() {
+			return DeviceDiscovery_GetRefreshEventHandle(this->instance);
 		}
 		
 		#define THROW_IF_ERROR(sentinel) if (result == sentinel) { throw DeviceDiscoveryException(DeviceDiscovery_GetLastErrorMessage(this->instance)); }
 		
+		inline bool IsRefreshRequired()
+		{
+			int result = DeviceDiscovery_IsRefreshRequired(this->instance);
+			THROW_IF_ERROR(-1);
+			return (result == 1);
+		}
+		
 		inline bool DiscoverDevices(DeviceFilter filter, bool includeIntegrated, bool includeDetachable)
 		{
 			int result = DeviceDiscovery_DiscoverDevices(this->instance, static_cast<int>(filter), includeIntegrated, includeDetachable);
@@ -193,6 +316,48 @@ class DeviceDiscovery
 			return result;
 		}
 		
+		inline const wchar_t* GetDevicePcieRoot(unsigned int device)
+		{
+			const wchar_t* result = DeviceDiscovery_GetDevicePcieRoot(this->instance, device);
+			THROW_IF_ERROR(nullptr);
+			return result;
+		}
+		
+		inline int GetDeviceNumaNode(unsigned int device)
+		{
+			int result = DeviceDiscovery_GetDeviceNumaNode(this->instance, device);
+			THROW_IF_ERROR(-1);
+			return result;
+		}
+		
+		inline unsigned long long GetDeviceDriverVersion(unsigned int device)
+		{
+			long long result = DeviceDiscovery_GetDeviceDriverVersion(this->instance, device);
+			THROW_IF_ERROR(-1);
+			return static_cast<unsigned long long>(result);
+		}
+		
+		inline int GetDeviceKmdModelVersion(unsigned int device)
+		{
+			int result = DeviceDiscovery_GetDeviceKmdModelVersion(this->instance, device);
+			THROW_IF_ERROR(-1);
+			return result;
+		}
+		
+		inline unsigned long long GetDeviceDedicatedMemory(unsigned int device)
+		{
+			long long result = DeviceDiscovery_GetDeviceDedicatedMemory(this->instance, device);
+			THROW_IF_ERROR(-1);
+			return static_cast<unsigned long long>(result);
+		}
+		
+		inline unsigned long long GetDeviceSharedMemory(unsigned int device)
+		{
+			long long result = DeviceDiscovery_GetDeviceSharedMemory(this->instance, device);
+			THROW_IF_ERROR(-1);
+			return static_cast<unsigned long long>(result);
+		}
+		
 		inline int GetNumRuntimeFiles(unsigned int device)
 		{
 			int result = DeviceDiscovery_GetNumRuntimeFiles(this->instance, device);
@@ -263,6 +428,68 @@ class DeviceDiscovery
 			return result;
 		}
 		
+		inline const wchar_t* GetDeviceString(unsigned int device, DeviceStringProperty property, unsigned int* length)
+		{
+			const wchar_t* result = DeviceDiscovery_GetDeviceString(this->instance, device, static_cast<int>(property), length);
+			THROW_IF_ERROR(nullptr);
+			return result;
+		}
+		
+		inline const wchar_t* GetRuntimeFileString(unsigned int device, unsigned int file, RuntimeFileStringProperty property, unsigned int* length)
+		{
+			const wchar_t* result = DeviceDiscovery_GetRuntimeFileString(this->instance, device, file, static_cast<int>(property), length);
+			THROW_IF_ERROR(nullptr);
+			return result;
+		}
+		
+		inline int GetSnapshot(void* buffer, unsigned int size)
+		{
+			int result = DeviceDiscovery_GetSnapshot(this->instance, buffer, size);
+			THROW_IF_ERROR(-1);
+			return result;
+		}
+		
+		inline void SetCacheFile(const wchar_t* path)
+		{
+			int result = DeviceDiscovery_SetCacheFile(this->instance, path);
+			THROW_IF_ERROR(-1);
+		}
+		
+		inline int GetMetrics(DiscoveryMetricsRecord* records, unsigned int count)
+		{
+			int result = DeviceDiscovery_GetMetrics(this->instance, records, count);
+			THROW_IF_ERROR(-1);
+			return result;
+		}
+		
+		inline int GetDeviceUsage(DeviceUsageRecord* records, unsigned int count)
+		{
+			int result = DeviceDiscovery_GetDeviceUsage(this->instance, records, count);
+			THROW_IF_ERROR(-1);
+			return result;
+		}
+		
+		inline int CheckDeviceHealth(DeviceHealthRecord* records, unsigned int count)
+		{
+			int result = DeviceDiscovery_CheckDeviceHealth(this->instance, records, count);
+			THROW_IF_ERROR(-1);
+			return result;
+		}
+		
+		inline DeviceDiscoverySnapshot AcquireSnapshot()
+		{
+			DeviceDiscoverySnapshot result = DeviceDiscovery_AcquireSnapshot(this->instance);
+			THROW_IF_ERROR(nullptr);
+			return result;
+		}
+		
+		inline DeviceDiscoverySnapshot AcquireFilteredSnapshot(DeviceFilter filter, bool includeIntegrated, bool includeDetachable)
+		{
+			DeviceDiscoverySnapshot result = DeviceDiscovery_AcquireFilteredSnapshot(this->instance, static_cast<int>(filter), includeIntegrated, includeDetachable);
+			THROW_IF_ERROR(nullptr);
+			return result;
+		}
+		
 		#undef THROW_IF_ERROR
 };
 
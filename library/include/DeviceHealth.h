@@ -0,0 +1,58 @@
+#pragma once
+
+// The device's adapter could be opened and no driver resets have been detected since the previous health check
+#define DEVICEHEALTH_HEALTHY 0
+
+// The device's adapter could not be opened, which indicates that the device has been removed or has stopped responding
+#define DEVICEHEALTH_REMOVED 1
+
+// One or more timeout detection and recovery (TDR) driver resets have been detected since the previous health check
+#define DEVICEHEALTH_RESET 2
+
+// Represents the result of a health check for an individual device
+typedef struct DeviceHealthRecord
+{
+	// The adapter LUID of the device that the health check relates to
+	long long AdapterLuid;
+	
+	// The health of the device (one of the DEVICEHEALTH_* values)
+	int Health;
+	
+	// The total number of TDR driver resets that have been detected for the device's adapter
+	unsigned int ResetCount;
+}
+DeviceHealthRecord;
+
+
+#ifdef __cplusplus
+
+#include <string>
+
+// Device health enum for C++ clients
+enum class DeviceHealth : int
+{
+	Healthy = DEVICEHEALTH_HEALTHY,
+	Removed = DEVICEHEALTH_REMOVED,
+	Reset = DEVICEHEALTH_RESET
+};
+
+// Returns a string representation of a device health value
+inline std::wstring DeviceHealthName(DeviceHealth health)
+{
+	switch (health)
+	{
+		case DeviceHealth::Healthy:
+			return L"Healthy";
+			
+		case DeviceHealth::Removed:
+			return L"Removed";
+			
+		case DeviceHealth::Reset:
+			return L"Reset";
+			
+		default:
+			return L"<Unknown DeviceHealth enum value>";
+	}
+}
+
+#endif
@@ -0,0 +1,47 @@
+#pragma once
+
+// The magic number at the start of every device snapshot buffer (the ASCII characters "DXDS" when read as little-endian bytes)
+#define DEVICESNAPSHOT_MAGIC 0x53445844
+
+// The version number of the device snapshot format described below
+#define DEVICESNAPSHOT_VERSION 3
+
+// The size of the fixed header at the start of a device snapshot buffer, in bytes
+#define DEVICESNAPSHOT_HEADER_SIZE 16
+
+// The NUMA node value reported for devices that do not report the NUMA node to which they are attached
+#define DEVICE_NUMA_NODE_UNKNOWN -2
+
+// Bit flags for the boolean properties of each device in a device snapshot
+#define DEVICESNAPSHOT_FLAG_INTEGRATED 0x1
+#define DEVICESNAPSHOT_FLAG_DETACHABLE 0x2
+#define DEVICESNAPSHOT_FLAG_SUPPORTS_DISPLAY 0x4
+#define DEVICESNAPSHOT_FLAG_SUPPORTS_COMPUTE 0x8
+
+// Device snapshot buffers use the following layout, with all integers stored in little-endian byte order and no padding between fields:
+// 
+// Header:
+// - uint32 magic (DEVICESNAPSHOT_MAGIC)
+// - uint32 version (DEVICESNAPSHOT_VERSION)
+// - uint32 total size of the snapshot in bytes, including the header
+// - uint32 number of devices
+// 
+// Each device:
+// - int64 adapter LUID
+// - uint32 flags (any combination of the DEVICESNAPSHOT_FLAG_* values)
+// - int32 NUMA node (or DEVICE_NUMA_NODE_UNKNOWN)
+// - uint64 driver version
+// - uint64 dedicated adapter memory in bytes
+// - uint64 shared system memory in bytes
+// - uint32 kernel-mode driver model version (a D3DKMT_DRIVERVERSION value)
+// - string ID
+// - string description
+// - string driver registry key
+// - string driver store path
+// - string location path
+// - string vendor
+// - string PCIe root
+// - uint32 number of System32 runtime files, followed by a source path string and a destination filename string for each file
+// - uint32 number of SysWOW64 runtime files, followed by a source path string and a destination filename string for each file
+// 
+// Each string is stored as a uint32 length in UTF-16 code units, followed by the code units themselves (with no null terminator).
@@ -0,0 +1,27 @@
+#pragma once
+
+// The engine utilisation value reported for devices that have not been sampled previously, since utilisation is measured between consecutive samples
+#define DEVICEUSAGE_UTILISATION_UNKNOWN -1.0
+
+// Represents a sample of the memory usage and engine utilisation of an individual device
+typedef struct DeviceUsageRecord
+{
+	// The adapter LUID of the device that the sample relates to
+	long long AdapterLuid;
+	
+	// The number of bytes currently resident in the device's dedicated (local) memory segments
+	unsigned long long DedicatedMemoryUsed;
+	
+	// The total capacity of the device's dedicated (local) memory segments, in bytes
+	unsigned long long DedicatedMemoryTotal;
+	
+	// The number of bytes currently resident in the device's shared (aperture) memory segments
+	unsigned long long SharedMemoryUsed;
+	
+	// The total capacity of the device's shared (aperture) memory segments, in bytes
+	unsigned long long SharedMemoryTotal;
+	
+	// The utilisation of the device's busiest engine since the previous sample, in the range [0, 1], or DEVICEUSAGE_UTILISATION_UNKNOWN for the first sample
+	double EngineUtilisation;
+}
+DeviceUsageRecord;
@@ -0,0 +1,45 @@
+#pragma once
+
+// Query the details of PnP devices using Windows Management Instrumentation (WMI) (this is the default)
+#define DISCOVERYBACKEND_WMI 0
+
+// Query the details of PnP devices directly from the PnP Configuration Manager (cfgmgr32), without using WMI
+#define DISCOVERYBACKEND_CONFIGMANAGER 1
+
+// Enumerate adapters and query the details of PnP devices using only the D3DKMT kernel thunks, without using DXCore or WMI
+// (This is intended for Server Core and container environments where DXCore is unavailable, and does not support refresh notifications)
+#define DISCOVERYBACKEND_D3DKMT 2
+
+
+#ifdef __cplusplus
+
+#include <string>
+
+// Discovery backend enum for C++ clients
+enum class DiscoveryBackend : int
+{
+	Wmi = DISCOVERYBACKEND_WMI,
+	ConfigManager = DISCOVERYBACKEND_CONFIGMANAGER,
+	D3DKMT = DISCOVERYBACKEND_D3DKMT
+};
+
+// Returns a string representation of a discovery backend
+inline std::wstring DiscoveryBackendName(DiscoveryBackend backend)
+{
+	switch (backend)
+	{
+		case DiscoveryBackend::Wmi:
+			return L"Wmi";
+			
+		case DiscoveryBackend::ConfigManager:
+			return L"ConfigManager";
+			
+		case DiscoveryBackend::D3DKMT:
+			return L"D3DKMT";
+			
+		default:
+			return L"<Unknown DiscoveryBackend enum value>";
+	}
+}
+
+#endif
@@ -0,0 +1,96 @@
+#pragma once
+
+// The total duration of each device discovery operation
+#define DISCOVERYPHASE_DISCOVER_DEVICES 0
+
+// The duration of DXCore adapter enumeration
+#define DISCOVERYPHASE_ENUMERATE_ADAPTERS 1
+
+// The duration of the query that locates the PnP devices for the enumerated adapters (e.g. the WQL query for the WMI backend)
+#define DISCOVERYPHASE_DEVICE_QUERY 2
+
+// The duration of iterating over the results of the device query
+#define DISCOVERYPHASE_DEVICE_ENUMERATION 3
+
+// The duration of retrieving the properties of an individual PnP device (e.g. Win32_PnPEntity::GetDeviceProperties for the WMI backend)
+#define DISCOVERYPHASE_DEVICE_PROPERTIES 4
+
+// The duration of retrieving the driver store path and runtime files of an individual PnP device
+#define DISCOVERYPHASE_DRIVER_DETAILS 5
+
+// The number of discovery phases
+#define DISCOVERYPHASE_COUNT 6
+
+// Represents the timing metrics for a discovery phase, either aggregated across all devices or for an individual device
+typedef struct DiscoveryMetricsRecord
+{
+	// The adapter LUID of the device that the metrics relate to, or 0 if the metrics are aggregated across all devices
+	long long AdapterLuid;
+	
+	// The discovery phase that the metrics relate to (one of the DISCOVERYPHASE_* values)
+	int Phase;
+	
+	// Reserved for future use, always set to zero
+	unsigned int Reserved;
+	
+	// The number of times the phase has been timed
+	unsigned long long Count;
+	
+	// The duration of the most recent timing of the phase, in nanoseconds
+	unsigned long long LastNanoseconds;
+	
+	// The shortest duration of the phase, in nanoseconds
+	unsigned long long MinNanoseconds;
+	
+	// The longest duration of the phase, in nanoseconds
+	unsigned long long MaxNanoseconds;
+	
+	// The sum of the durations of all timings of the phase, in nanoseconds
+	unsigned long long TotalNanoseconds;
+} DiscoveryMetricsRecord;
+
+
+#ifdef __cplusplus
+
+#include <string>
+
+// Discovery phase enum for C++ clients
+enum class DiscoveryPhase : int
+{
+	DiscoverDevices = DISCOVERYPHASE_DISCOVER_DEVICES,
+	EnumerateAdapters = DISCOVERYPHASE_ENUMERATE_ADAPTERS,
+	DeviceQuery = DISCOVERYPHASE_DEVICE_QUERY,
+	DeviceEnumeration = DISCOVERYPHASE_DEVICE_ENUMERATION,
+	DeviceProperties = DISCOVERYPHASE_DEVICE_PROPERTIES,
+	DriverDetails = DISCOVERYPHASE_DRIVER_DETAILS
+};
+
+// Returns a string representation of a discovery phase
+inline std::wstring DiscoveryPhaseName(DiscoveryPhase phase)
+{
+	switch (phase)
+	{
+		case DiscoveryPhase::DiscoverDevices:
+			return L"DiscoverDevices";
+			
+		case DiscoveryPhase::EnumerateAdapters:
+			return L"EnumerateAdapters";
+			
+		case DiscoveryPhase::DeviceQuery:
+			return L"DeviceQuery";
+			
+		case DiscoveryPhase::DeviceEnumeration:
+			return L"DeviceEnumeration";
+			
+		case DiscoveryPhase::DeviceProperties:
+			return L"DeviceProperties";
+			
+		case DiscoveryPhase::DriverDetails:
+			return L"DriverDetails";
+			
+		default:
+			return L"<Unknown DiscoveryPhase enum value>";
+	}
+}
+
+#endif
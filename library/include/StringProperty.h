@@ -0,0 +1,60 @@
+#pragma once
+
+// The unique PnP hardware identifier for a device
+#define DEVICESTRING_ID 0
+
+// The human-readable description of a device
+#define DEVICESTRING_DESCRIPTION 1
+
+// The registry key that contains the driver details for a device
+#define DEVICESTRING_DRIVER_REGISTRY_KEY 2
+
+// The absolute path to the driver store directory that contains the driver files for a device
+#define DEVICESTRING_DRIVER_STORE_PATH 3
+
+// The path to the physical location of a device in the system
+#define DEVICESTRING_LOCATION_PATH 4
+
+// The vendor of a device
+#define DEVICESTRING_VENDOR 5
+
+// The PCIe root complex under which a device is located
+#define DEVICESTRING_PCIE_ROOT 6
+
+// The source path of a runtime file for System32
+#define RUNTIMEFILESTRING_SOURCE 0
+
+// The destination filename of a runtime file for System32
+#define RUNTIMEFILESTRING_DESTINATION 1
+
+// The source path of a runtime file for SysWOW64
+#define RUNTIMEFILESTRING_SOURCE_WOW64 2
+
+// The destination filename of a runtime file for SysWOW64
+#define RUNTIMEFILESTRING_DESTINATION_WOW64 3
+
+
+#ifdef __cplusplus
+
+// Device string property enum for C++ clients
+enum class DeviceStringProperty : int
+{
+	ID = DEVICESTRING_ID,
+	Description = DEVICESTRING_DESCRIPTION,
+	DriverRegistryKey = DEVICESTRING_DRIVER_REGISTRY_KEY,
+	DriverStorePath = DEVICESTRING_DRIVER_STORE_PATH,
+	LocationPath = DEVICESTRING_LOCATION_PATH,
+	Vendor = DEVICESTRING_VENDOR,
+	PcieRoot = DEVICESTRING_PCIE_ROOT
+};
+
+// Runtime file string property enum for C++ clients
+enum class RuntimeFileStringProperty : int
+{
+	Source = RUNTIMEFILESTRING_SOURCE,
+	Destination = RUNTIMEFILESTRING_DESTINATION,
+	SourceWow64 = RUNTIMEFILESTRING_SOURCE_WOW64,
+	DestinationWow64 = RUNTIMEFILESTRING_DESTINATION_WOW64
+};
+
+#endif
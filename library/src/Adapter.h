@@ -6,6 +6,10 @@ struct Adapter
 {
 	inline Adapter() :
 		InstanceLuid(0),
+		DriverVersion(0),
+		KmdModelVersion(0),
+		DedicatedAdapterMemory(0),
+		SharedSystemMemory(0),
 		IsHardware(false),
 		IsIntegrated(false),
 		IsDetachable(false),
@@ -19,6 +23,18 @@ struct Adapter
 	// The PnP hardware ID information for the adapter
 	DXCoreHardwareID HardwareID;
 	
+	// The version number of the adapter's driver
+	uint64_t DriverVersion;
+	
+	// The WDDM or MCDM version of the adapter's kernel-mode driver, as a D3DKMT_DRIVERVERSION value (e.g. 3000 for WDDM 3.0)
+	uint32_t KmdModelVersion;
+	
+	// The number of bytes of dedicated adapter memory that are not shared with the CPU
+	uint64_t DedicatedAdapterMemory;
+	
+	// The number of bytes of system memory that can be shared between the adapter and the CPU
+	uint64_t SharedSystemMemory;
+	
 	// Specifies whether the adapter is a hardware device (as opposed to a software device)
 	bool IsHardware;
 	
@@ -5,12 +5,26 @@
 
 using std::map;
 using std::vector;
-using winrt::com_ptr;
 
+// Represents the differences between the lists of unique adapters retrieved by two consecutive enumeration operations
+struct AdapterChanges
+{
+	// The adapters that were not present in the previous enumeration, keyed by adapter LUID
+	map<int64_t, Adapter> Added;
+	
+	// The adapters that were present in both the previous enumeration and the current enumeration, keyed by adapter LUID
+	map<int64_t, Adapter> Unchanged;
+	
+	// The LUIDs of the adapters that were present in the previous enumeration but are no longer present
+	vector<int64_t> Removed;
+};
+
+// Base class for backends that enumerate DirectX adapters, which applies our filtering criteria and tracks the changes between enumerations
 class AdapterEnumeration
 {
 	public:
-		AdapterEnumeration();
+		
+		virtual ~AdapterEnumeration() {}
 		
 		// Enumerates the DirectX adapters that meet the specified filtering criteria
 		void EnumerateAdapters(const DeviceFilter& filter, bool includeIntegrated, bool includeDetachable);
@@ -18,20 +32,27 @@ class AdapterEnumeration
 		// Retrieves the list of unique adapters retrieved during the last enumeration operation
 		const map<int64_t, Adapter>& GetUniqueAdapters() const;
 		
+		// Retrieves the changes to the list of unique adapters between the previous enumeration operation and the last enumeration operation
+		const AdapterChanges& GetAdapterChanges() const;
+		
 		// Determines whether the list of adapters is stale and needs to be refreshed by performing enumeration again
-		bool IsStale() const;
+		virtual bool IsStale() const = 0;
 		
-	private:
+		// Determines whether an adapter meets the specified filtering criteria
+		// (This is also used to filter published device lists, so snapshots apply exactly the same criteria as enumeration)
+		static bool MatchesFilter(const Adapter& adapter, const DeviceFilter& filter, bool includeIntegrated, bool includeDetachable);
 		
-		// Extracts the details from a DXCore adapter object
-		Adapter ExtractAdapterDetails(const com_ptr<IDXCoreAdapter>& adapter) const;
+	protected:
 		
-		// Our DXCore adapter factory
-		com_ptr<IDXCoreAdapterFactory> adapterFactory;
+		// Enumerates the adapters that may match the specified filter, listing each adapter only once
+		// (Implementations can return adapters that do not match the filter, since our full filtering criteria are applied to the results)
+		virtual vector<Adapter> EnumerateCandidateAdapters(const DeviceFilter& filter) = 0;
 		
-		// Our collection of DXCore adapter lists, used for enumerating adapters with various capabilities
-		vector< com_ptr<IDXCoreAdapterList> > adapterLists;
+	private:
 		
 		// The list of unique adapters retrieved during the last enumeration operation, keyed by adapter LUID
 		map<int64_t, Adapter> uniqueAdapters;
+		
+		// The changes to the list of unique adapters that were detected during the last enumeration operation
+		AdapterChanges changes;
 };
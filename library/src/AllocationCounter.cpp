@@ -0,0 +1,39 @@
+#include "AllocationCounter.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+namespace
+{
+	// The number of allocations performed so far (this is a relaxed counter, since it is only used for diagnostics)
+	std::atomic<uint64_t> numAllocations = 0;
+}
+
+// Since we link against the static CRT, replacing the global allocation functions only affects code in this DLL.
+// The array and nothrow variants are implemented by the CRT in terms of these, so they are counted as well.
+void* operator new(size_t size)
+{
+	// Count the allocation
+	numAllocations.fetch_add(1, std::memory_order_relaxed);
+	
+	// Perform the allocation, treating zero-sized requests as requests for a single byte as the standard requires
+	void* memory = std::malloc((size > 0) ? size : 1);
+	if (memory == nullptr) {
+		throw std::bad_alloc();
+	}
+	
+	return memory;
+}
+
+void operator delete(void* memory) noexcept {
+	std::free(memory);
+}
+
+void operator delete(void* memory, size_t) noexcept {
+	std::free(memory);
+}
+
+uint64_t AllocationCounter::GetCount() {
+	return numAllocations.load(std::memory_order_relaxed);
+}
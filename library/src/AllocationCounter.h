@@ -0,0 +1,14 @@
+#pragma once
+
+#include <stdint.h>
+
+namespace AllocationCounter {
+
+
+// Returns the number of heap allocations performed through operator new by code in the device discovery library since it was loaded.
+// This covers allocations made on any thread, including worker threads, but does not include allocations made internally by system components.
+// (The counting allocation functions are only compiled into the shared library when the DISCOVERY_COUNT_ALLOCATIONS CMake option is enabled)
+uint64_t GetCount();
+
+
+} // namespace AllocationCounter
@@ -0,0 +1,257 @@
+#include "ConfigManagerQuery.h"
+#include "DevicePropertyKeys.h"
+#include "ErrorHandling.h"
+#include "ParsingHelpers.h"
+#include "TraceLogging.h"
+
+#include <algorithm>
+#include <initguid.h>
+#include <devpkey.h>
+#include <fmt/core.h>
+
+using std::set;
+
+namespace
+{
+	// Formats a PnP hardware ID as a device instance ID prefix
+	wstring FormatHardwareIDPrefix(const DXCoreHardwareID& dxHardwareID)
+	{
+		// Build a PCI hardware identifier string as per:
+		// <https://docs.microsoft.com/en-us/windows-hardware/drivers/install/identifiers-for-pci-devices>
+		// and insert a trailing separator for the device instance
+		return fmt::format(
+			L"PCI\\VEN_{:0>4X}&DEV_{:0>4X}&SUBSYS_{:0>8X}&REV_{:0>2X}\\",
+			dxHardwareID.vendorID,
+			dxHardwareID.deviceID,
+			dxHardwareID.subSysID,
+			dxHardwareID.revision
+		);
+	}
+}
+
+ConfigManagerQuery::ConfigManagerQuery(MetricsRecorder& metrics) : metrics(metrics)
+{}
+
+vector<Device> ConfigManagerQuery::GetDevicesForAdapters(const map<int64_t, Adapter>& adapters)
+{
+	// If we don't have any adapters then don't query the Configuration Manager
+	if (adapters.empty())
+	{
+		LOG(L"Empty adapter list provided, skipping Configuration Manager query");
+		return {};
+	}
+	
+	// Gather the unique PnP hardware IDs from the DirectX adapters for matching against device instance IDs
+	set<wstring> hardwareIDs;
+	for (auto const& adapter : adapters) {
+		hardwareIDs.insert(FormatHardwareIDPrefix(adapter.second.HardwareID));
+	}
+	
+	// Log the hardware IDs
+	LOG(L"Matching present PCI devices against hardware IDs: {}", FMT(hardwareIDs));
+	
+	// Retrieve the list of present PCI devices
+	vector<wstring> instanceIDs;
+	{
+		ScopedTimer timer(this->metrics, DiscoveryPhase::DeviceQuery);
+		instanceIDs = this->GetPresentPciDevices();
+	}
+	
+	// Iterate over the present PCI devices and match them to their corresponding DirectX adapters
+	ScopedTimer enumerationTimer(this->metrics, DiscoveryPhase::DeviceEnumeration);
+	vector<Device> devices;
+	for (auto const& instanceID : instanceIDs)
+	{
+		// Ignore any devices that do not match the hardware IDs of our adapters
+		auto matchingID = std::find_if(hardwareIDs.begin(), hardwareIDs.end(), [&instanceID](const wstring& prefix) {
+			return _wcsnicmp(instanceID.c_str(), prefix.c_str(), prefix.size()) == 0;
+		});
+		if (matchingID == hardwareIDs.end()) {
+			continue;
+		}
+		
+		// Extract the details for the device and determine whether it matches any of our adapters
+		Device details;
+		{
+			ScopedTimer timer(this->metrics, DiscoveryPhase::DeviceProperties);
+			TraceActivity activity("CM_Get_DevNode_PropertyW", 0, instanceID);
+			try
+			{
+				if (!this->ExtractDeviceDetails(instanceID, details)) {
+					continue;
+				}
+			}
+			catch (const DeviceDiscoveryError& err)
+			{
+				activity.SetError(err);
+				throw;
+			}
+			timer.SetAdapterLuid(details.DeviceAdapter.InstanceLuid);
+			activity.SetAdapterLuid(details.DeviceAdapter.InstanceLuid);
+		}
+		auto matchingAdapter = adapters.find(details.DeviceAdapter.InstanceLuid);
+		if (matchingAdapter != adapters.end())
+		{
+			// Log the match
+			LOG(L"Matched adapter LUID {} to PnP device {}", details.DeviceAdapter.InstanceLuid, details.ID);
+			
+			// Replace the device's adapter details with the matching adapter
+			details.DeviceAdapter = matchingAdapter->second;
+			
+			// Include the device in our results
+			devices.push_back(std::move(details));
+		}
+	}
+	
+	return devices;
+}
+
+vector<wstring> ConfigManagerQuery::GetPresentPciDevices() const
+{
+	// Filter the device list to present devices from the PCI enumerator
+	const wchar_t* enumerator = L"PCI";
+	ULONG flags = CM_GETIDLIST_FILTER_ENUMERATOR | CM_GETIDLIST_FILTER_PRESENT;
+	
+	// Retrieve the device list, retrying if the list grows between determining its size and retrieving it
+	TraceActivity activity("CM_Get_Device_ID_ListW", 0, {}, enumerator);
+	vector<wchar_t> idList;
+	CONFIGRET result = CR_SUCCESS;
+	do
+	{
+		ULONG length = 0;
+		auto error = CheckConfigRet(CM_Get_Device_ID_List_SizeW(&length, enumerator, flags));
+		if (error)
+		{
+			activity.SetError(error);
+			throw error.Wrap(L"CM_Get_Device_ID_List_SizeW failed");
+		}
+		
+		idList.resize(length);
+		result = CM_Get_Device_ID_ListW(enumerator, idList.data(), length, flags);
+	}
+	while (result == CR_BUFFER_SMALL);
+	
+	// Report any errors
+	auto error = CheckConfigRet(result);
+	if (error)
+	{
+		activity.SetError(error);
+		throw error.Wrap(L"CM_Get_Device_ID_ListW failed");
+	}
+	
+	// Split the device list into individual device instance IDs
+	return ParsingHelpers::ExtractMultiStringValue(idList.data(), idList.size() * sizeof(wchar_t));
+}
+
+bool ConfigManagerQuery::ExtractDeviceDetails(const wstring& instanceID, Device& details) const
+{
+	// Locate the device node for the device instance
+	DEVINST devInst = 0;
+	auto error = CheckConfigRet(CM_Locate_DevNodeW(&devInst, const_cast<wchar_t*>(instanceID.c_str()), CM_LOCATE_DEVNODE_NORMAL));
+	if (error) {
+		throw error.Wrap(L"CM_Locate_DevNodeW failed for device " + instanceID);
+	}
+	
+	// Retrieve the DirectX adapter LUID for the device, ignoring devices that do not have one
+	DEVPROPTYPE type = DEVPROP_TYPE_EMPTY;
+	if (!this->GetDeviceProperty(devInst, DEVPKEY_Device_AdapterLuid, type, this->propertyData)) {
+		return false;
+	}
+	if ((type != DEVPROP_TYPE_UINT64 && type != DEVPROP_TYPE_INT64) || this->propertyData.size() != sizeof(int64_t)) {
+		throw CreateError(L"LUID value was not a 64-bit integer for device " + instanceID);
+	}
+	details.DeviceAdapter.InstanceLuid = *reinterpret_cast<const int64_t*>(this->propertyData.data());
+	
+	// Populate the unique PnP device ID, the human-readable description and the vendor of the device
+	details.ID = instanceID;
+	details.Description = this->GetStringProperty(devInst, DEVPKEY_Device_DeviceDesc);
+	details.Vendor = this->GetStringProperty(devInst, DEVPKEY_Device_Manufacturer);
+	
+	// Construct the full path to the registry key for the device's driver
+	wstring driver = this->GetStringProperty(devInst, DEVPKEY_Device_Driver);
+	if (!driver.empty()) {
+		details.DriverRegistryKey = L"HKEY_LOCAL_MACHINE\\SYSTEM\\CurrentControlSet\\Control\\Class\\" + driver;
+	}
+	
+	// Retrieve the first element from the LocationPaths list
+	if (this->GetDeviceProperty(devInst, DEVPKEY_Device_LocationPaths, type, this->propertyData))
+	{
+		// Verify that the LocationPaths list is of the expected type
+		if (type != DEVPROP_TYPE_STRING_LIST) {
+			throw CreateError(L"LocationPaths value was not a list of strings for device " + instanceID);
+		}
+		
+		auto locationPaths = ParsingHelpers::ExtractMultiStringValue(
+			reinterpret_cast<const wchar_t*>(this->propertyData.data()),
+			this->propertyData.size()
+		);
+		if (!locationPaths.empty()) {
+			details.LocationPath = locationPaths[0];
+		}
+	}
+	
+	// Retrieve the NUMA node to which the device is attached, if it reports one
+	if (this->GetDeviceProperty(devInst, DEVPKEY_Device_Numa_Node, type, this->propertyData))
+	{
+		// Verify that the NUMA node is of the expected type
+		if (type != DEVPROP_TYPE_UINT32 || this->propertyData.size() != sizeof(uint32_t)) {
+			throw CreateError(L"NUMA node value was not a 32-bit integer for device " + instanceID);
+		}
+		
+		details.NumaNode = static_cast<int32_t>(*reinterpret_cast<const uint32_t*>(this->propertyData.data()));
+	}
+	
+	return true;
+}
+
+bool ConfigManagerQuery::GetDeviceProperty(DEVINST devInst, const DEVPROPKEY& key, DEVPROPTYPE& type, vector<uint8_t>& data) const
+{
+	// Attempt to retrieve the property using the full capacity of our existing buffer, resizing it and retrying if it is too small
+	data.resize(data.capacity());
+	while (true)
+	{
+		ULONG size = static_cast<ULONG>(data.size());
+		CONFIGRET result = CM_Get_DevNode_PropertyW(devInst, &key, &type, data.data(), &size, 0);
+		if (result == CR_NO_SUCH_VALUE) {
+			return false;
+		}
+		else if (result == CR_BUFFER_SMALL) {
+			data.resize(size);
+		}
+		else
+		{
+			// Report any errors
+			auto error = CheckConfigRet(result);
+			if (error) {
+				throw error.Wrap(L"CM_Get_DevNode_PropertyW failed");
+			}
+			
+			// Trim the buffer to the size of the retrieved data
+			data.resize(size);
+			return true;
+		}
+	}
+}
+
+wstring ConfigManagerQuery::GetStringProperty(DEVINST devInst, const DEVPROPKEY& key) const
+{
+	// Attempt to retrieve the property value
+	DEVPROPTYPE type = DEVPROP_TYPE_EMPTY;
+	if (!this->GetDeviceProperty(devInst, key, type, this->propertyData)) {
+		return L"";
+	}
+	
+	// Verify that the property value is of the expected type
+	if (type != DEVPROP_TYPE_STRING) {
+		throw CreateError(L"device property value was not a string");
+	}
+	
+	// Convert the property data to a string, excluding the trailing NUL terminator
+	const wchar_t* value = reinterpret_cast<const wchar_t*>(this->propertyData.data());
+	size_t length = this->propertyData.size() / sizeof(wchar_t);
+	while (length > 0 && value[length - 1] == L'\0') {
+		length--;
+	}
+	
+	return wstring(value, length);
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include "Adapter.h"
+#include "Device.h"
+#include "DeviceQuery.h"
+#include "MetricsRecorder.h"
+
+using std::map;
+using std::vector;
+using std::wstring;
+
+// Provides functionality for querying the PnP Configuration Manager (cfgmgr32) directly, without the overheads of WMI
+class ConfigManagerQuery : public DeviceQuery
+{
+	public:
+		
+		ConfigManagerQuery(MetricsRecorder& metrics);
+		
+		// Retrieves the device details for the underlying PnP devices associated with the supplied DirectX adapters
+		vector<Device> GetDevicesForAdapters(const map<int64_t, Adapter>& adapters) override;
+		
+		// Extracts the details from a PnP device, returning false if the device is not associated with a DirectX adapter
+		bool ExtractDeviceDetails(const wstring& instanceID, Device& details) const;
+		
+	private:
+		
+		// Retrieves the list of device instance IDs for all present PCI devices
+		vector<wstring> GetPresentPciDevices() const;
+		
+		// Retrieves the raw data for a device property, returning false if the device has no value for the property
+		bool GetDeviceProperty(DEVINST devInst, const DEVPROPKEY& key, DEVPROPTYPE& type, vector<uint8_t>& data) const;
+		
+		// Retrieves the value of a string device property, returning an empty string if the device has no value for the property
+		wstring GetStringProperty(DEVINST devInst, const DEVPROPKEY& key) const;
+		
+		// The metrics recorder used to time our queries
+		MetricsRecorder& metrics;
+		
+		// Our reusable buffer for receiving device property data
+		mutable vector<uint8_t> propertyData;
+};
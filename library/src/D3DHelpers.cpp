@@ -1,6 +1,66 @@
 #include "D3DHelpers.h"
 #include "ErrorHandling.h"
 #include "ObjectHelpers.h"
+#include "TraceLogging.h"
+
+namespace
+{
+	// The component of a device's hardware key path that precedes its device instance ID
+	const wstring EnumKeyComponent = L"\\Enum\\";
+}
+
+wstring QueryPnpKey(D3DKMT_HANDLE adapter, D3DKMT_PNP_KEY_TYPE keyType)
+{
+	// Retrieve the length of the key path, then retrieve the key path itself
+	UINT length = 0;
+	auto query = ObjectHelpers::GetZeroedStruct<D3DKMT_QUERY_PHYSICAL_ADAPTER_PNP_KEY>();
+	query.PhysicalAdapterIndex = 0;
+	query.PnPKeyType = keyType;
+	query.pDest = nullptr;
+	query.pCchDest = &length;
+	QueryAdapterInfo(adapter, KMTQAITYPE_PHYSICALADAPTERPNPKEY, query);
+	
+	vector<wchar_t> path(length + 1, L'\0');
+	query.pDest = path.data();
+	QueryAdapterInfo(adapter, KMTQAITYPE_PHYSICALADAPTERPNPKEY, query);
+	return wstring(path.data());
+}
+
+wstring InstanceIDFromHardwareKey(const wstring& hardwareKey)
+{
+	// Perform a case-insensitive search for the Enum key component
+	for (size_t offset = 0; offset + EnumKeyComponent.size() <= hardwareKey.size(); ++offset)
+	{
+		if (_wcsnicmp(hardwareKey.c_str() + offset, EnumKeyComponent.c_str(), EnumKeyComponent.size()) == 0) {
+			return hardwareKey.substr(offset + EnumKeyComponent.size());
+		}
+	}
+	
+	throw CreateError(L"could not extract a device instance ID from hardware key " + hardwareKey);
+}
+
+unique_adapter_handle OpenAdapterFromLuid(int64_t luid, wstring_view deviceID)
+{
+	auto openAdapter = ObjectHelpers::GetZeroedStruct<D3DKMT_OPENADAPTERFROMLUID>();
+	openAdapter.AdapterLuid = LuidFromInt64(luid);
+	
+	TraceActivity activity("D3DKMTOpenAdapterFromLuid", luid, deviceID);
+	auto error = CheckNtStatus(D3DKMTOpenAdapterFromLuid(&openAdapter));
+	if (error)
+	{
+		activity.SetError(error);
+		throw error.Wrap(L"D3DKMTOpenAdapterFromLuid failed for adapter LUID " + std::to_wstring(luid));
+	}
+	
+	return unique_adapter_handle(openAdapter.hAdapter);
+}
+
+wstring QueryAdapterInstanceID(int64_t luid)
+{
+	// Open a handle to the adapter and extract the device instance ID from the path to the device's hardware key
+	unique_adapter_handle handle = OpenAdapterFromLuid(luid);
+	return InstanceIDFromHardwareKey(QueryPnpKey(handle.get(), D3DKMT_PNP_KEY_HARDWARE));
+}
 
 QueryD3DRegistryInfo::QueryD3DRegistryInfo()
 {
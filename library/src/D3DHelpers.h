@@ -1,5 +1,9 @@
 #pragma once
 
+#include "ErrorHandling.h"
+
+using std::vector;
+using std::wstring;
 using std::wstring_view;
 
 
@@ -14,6 +18,38 @@ inline NTSTATUS CloseAdapter(D3DKMT_HANDLE adapter)
 // Auto-releasing resource wrapper type for DirectX adapter handles
 typedef wil::unique_any<D3DKMT_HANDLE, decltype(&::CloseAdapter), ::CloseAdapter> unique_adapter_handle;
 
+// Opens the DirectX adapter with the specified LUID, throwing an error if it cannot be opened
+// (The optional device instance ID is only used to identify the device in the trace activity for the call)
+unique_adapter_handle OpenAdapterFromLuid(int64_t luid, wstring_view deviceID = {});
+
+// Queries a fixed-size information struct of the specified type from a DirectX adapter, throwing an error if the query fails
+// (Any input fields required by the query type can be populated in the supplied struct, which is otherwise zero-initialised)
+template <typename T> T QueryAdapterInfo(D3DKMT_HANDLE adapter, KMTQUERYADAPTERINFOTYPE type, T info = T())
+{
+	D3DKMT_QUERYADAPTERINFO query;
+	query.hAdapter = adapter;
+	query.Type = type;
+	query.pPrivateDriverData = &info;
+	query.PrivateDriverDataSize = sizeof(T);
+	
+	auto error = CheckNtStatus(D3DKMTQueryAdapterInfo(&query));
+	if (error) {
+		throw error.Wrap(L"D3DKMTQueryAdapterInfo failed for query type " + std::to_wstring(type));
+	}
+	
+	return info;
+}
+
+// Retrieves the kernel registry path for the specified PnP key of a DirectX adapter's physical device
+wstring QueryPnpKey(D3DKMT_HANDLE adapter, D3DKMT_PNP_KEY_TYPE keyType);
+
+// Extracts the device instance ID from the kernel registry path for a device's hardware key
+wstring InstanceIDFromHardwareKey(const wstring& hardwareKey);
+
+// Opens the DirectX adapter with the specified LUID and retrieves the device instance ID of its physical PnP device
+wstring QueryAdapterInstanceID(int64_t luid);
+
+
 
 // Encapsulates a D3DDDI_QUERYREGISTRY_INFO struct, along with its trailing buffer for receiving output data
 class QueryD3DRegistryInfo
@@ -0,0 +1,128 @@
+#include "D3DKMTEnumeration.h"
+#include "ErrorHandling.h"
+#include "ObjectHelpers.h"
+
+using std::pair;
+
+namespace
+{
+	// The NTSTATUS value returned when the buffer supplied to a kernel thunk is too small
+	// (We define this ourselves since including <ntstatus.h> conflicts with the status values defined by <Windows.h>)
+	const NTSTATUS StatusBufferTooSmall = static_cast<NTSTATUS>(0xC0000023L);
+	
+	// Enumerates every adapter known to the kernel, returning each adapter's LUID and an open handle to the adapter
+	vector< pair<int64_t, unique_adapter_handle> > EnumerateKernelAdapters()
+	{
+		// Retrieve the number of adapters and then retrieve the adapters, retrying if the number of adapters grows in between
+		vector<D3DKMT_ADAPTERINFO> adapterInfo;
+		auto enumerate = ObjectHelpers::GetZeroedStruct<D3DKMT_ENUMADAPTERS2>();
+		NTSTATUS status = 0;
+		do
+		{
+			enumerate.pAdapters = nullptr;
+			auto error = CheckNtStatus(D3DKMTEnumAdapters2(&enumerate));
+			if (error) {
+				throw error.Wrap(L"D3DKMTEnumAdapters2 failed to retrieve the number of adapters");
+			}
+			
+			adapterInfo.resize(enumerate.NumAdapters);
+			enumerate.pAdapters = adapterInfo.data();
+			status = D3DKMTEnumAdapters2(&enumerate);
+		}
+		while (status == StatusBufferTooSmall);
+		
+		// Report any errors
+		auto error = CheckNtStatus(status);
+		if (error) {
+			throw error.Wrap(L"D3DKMTEnumAdapters2 failed");
+		}
+		
+		// Take ownership of the adapter handles so they are closed even if we encounter an error when processing an adapter
+		vector< pair<int64_t, unique_adapter_handle> > adapters;
+		for (ULONG index = 0; index < enumerate.NumAdapters; ++index) {
+			adapters.emplace_back(Int64FromLuid(adapterInfo[index].AdapterLuid), unique_adapter_handle(adapterInfo[index].hAdapter));
+		}
+		
+		return adapters;
+	}
+}
+
+bool D3DKMTEnumeration::IsStale() const
+{
+	// If we have not performed enumeration yet then the adapter list is always stale
+	if (!this->haveEnumerated) {
+		return true;
+	}
+	
+	// Compare the LUIDs of the adapters currently known to the kernel to those from our last enumeration operation
+	set<int64_t> current;
+	for (auto const& adapter : EnumerateKernelAdapters()) {
+		current.insert(adapter.first);
+	}
+	
+	return current != this->enumeratedLuids;
+}
+
+vector<Adapter> D3DKMTEnumeration::EnumerateCandidateAdapters(const DeviceFilter& filter)
+{
+	// Enumerate the adapters and extract the details for each one
+	auto adapters = EnumerateKernelAdapters();
+	vector<Adapter> candidates;
+	this->enumeratedLuids.clear();
+	for (auto const& adapter : adapters)
+	{
+		// Skip any adapter we have already seen, since the kernel may report multiple handles for the same adapter
+		if (!this->enumeratedLuids.insert(adapter.first).second) {
+			continue;
+		}
+		
+		candidates.push_back(D3DKMTEnumeration::ExtractAdapterDetails(adapter.second.get(), adapter.first));
+	}
+	
+	this->haveEnumerated = true;
+	return candidates;
+}
+
+Adapter D3DKMTEnumeration::ExtractAdapterDetails(D3DKMT_HANDLE adapter, int64_t luid)
+{
+	Adapter details;
+	details.InstanceLuid = luid;
+	
+	// Retrieve the adapter type flags
+	// (The kernel does not report Direct3D feature support, so we treat any adapter that supports rendering as supporting compute,
+	// and any adapter that supports rendering without being restricted to compute as supporting display)
+	auto adapterType = QueryAdapterInfo<D3DKMT_ADAPTERTYPE>(adapter, KMTQAITYPE_ADAPTERTYPE);
+	details.IsHardware = !adapterType.SoftwareDevice;
+	details.IsDetachable = adapterType.Detachable;
+	details.SupportsCompute = adapterType.RenderSupported;
+	details.SupportsDisplay = adapterType.RenderSupported && !adapterType.ComputeOnly;
+	
+	// Retrieve the PnP hardware ID information for the adapter's physical device
+	auto deviceIDs = QueryAdapterInfo<D3DKMT_QUERY_DEVICE_IDS>(adapter, KMTQAITYPE_PHYSICALADAPTERDEVICEIDS);
+	details.HardwareID.vendorID = deviceIDs.DeviceIds.VendorID;
+	details.HardwareID.deviceID = deviceIDs.DeviceIds.DeviceID;
+	details.HardwareID.subSysID = (deviceIDs.DeviceIds.SubSystemID << 16) | deviceIDs.DeviceIds.SubVendorID;
+	details.HardwareID.revision = deviceIDs.DeviceIds.RevisionID;
+	
+	// Retrieve the memory sizes for the adapter, and approximate DXCore's integrated GPU detection by treating
+	// hybrid integrated adapters and adapters without dedicated video memory as integrated
+	auto segmentSizes = QueryAdapterInfo<D3DKMT_SEGMENTSIZEINFO>(adapter, KMTQAITYPE_GETSEGMENTSIZE);
+	details.DedicatedAdapterMemory = segmentSizes.DedicatedVideoMemorySize;
+	details.SharedSystemMemory = segmentSizes.SharedSystemMemorySize;
+	details.IsIntegrated = adapterType.HybridIntegrated || segmentSizes.DedicatedVideoMemorySize == 0;
+	
+	// Retrieve the kernel-mode driver model version
+	details.KmdModelVersion = static_cast<uint32_t>(QueryAdapterInfo<D3DKMT_DRIVERVERSION>(adapter, KMTQAITYPE_DRIVERVERSION));
+	
+	// Retrieve the version number of the adapter's driver, which not all drivers report
+	try
+	{
+		auto driverVersion = QueryAdapterInfo<D3DKMT_UMD_DRIVER_VERSION>(adapter, KMTQAITYPE_UMD_DRIVER_VERSION);
+		details.DriverVersion = static_cast<uint64_t>(driverVersion.DriverVersion.QuadPart);
+	}
+	catch (const DeviceDiscoveryError& err) {
+		LOG(L"Could not retrieve the driver version for adapter LUID {}: {}", luid, err.message);
+	}
+	
+	return details;
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include "AdapterEnumeration.h"
+#include "D3DHelpers.h"
+
+using std::set;
+using std::vector;
+
+// Enumerates DirectX adapters using the D3DKMT kernel thunks, for environments where DXCore is unavailable (e.g. Server Core and containers)
+// (No stale notifications are available for this backend, so callers must poll `IsStale()` to detect changes to the adapter list)
+class D3DKMTEnumeration : public AdapterEnumeration
+{
+	public:
+		
+		// Determines whether the set of adapters known to the kernel has changed since the last enumeration operation
+		bool IsStale() const override;
+		
+	protected:
+		
+		// Enumerates every adapter known to the kernel, since the kernel provides no means of filtering adapters by capability
+		vector<Adapter> EnumerateCandidateAdapters(const DeviceFilter& filter) override;
+		
+	private:
+		
+		// Extracts the details for an adapter from an open handle to the adapter
+		static Adapter ExtractAdapterDetails(D3DKMT_HANDLE adapter, int64_t luid);
+		
+		// The LUIDs of all of the adapters that were known to the kernel during the last enumeration operation
+		set<int64_t> enumeratedLuids;
+		
+		// Specifies whether we have performed at least one enumeration operation
+		bool haveEnumerated = false;
+};
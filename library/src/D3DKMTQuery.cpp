@@ -0,0 +1,80 @@
+#include "D3DKMTQuery.h"
+#include "D3DHelpers.h"
+#include "ErrorHandling.h"
+
+namespace
+{
+	// The prefix for kernel registry paths under HKEY_LOCAL_MACHINE, and the corresponding Win32 registry path prefix
+	const wstring KernelMachinePrefix = L"\\Registry\\Machine\\";
+	const wstring Win32MachinePrefix = L"HKEY_LOCAL_MACHINE\\";
+	
+	// Converts a kernel registry path under HKEY_LOCAL_MACHINE to a Win32 registry path
+	wstring Win32PathFromKernelPath(const wstring& kernelPath)
+	{
+		if (_wcsnicmp(kernelPath.c_str(), KernelMachinePrefix.c_str(), KernelMachinePrefix.size()) != 0) {
+			throw CreateError(L"unsupported kernel registry path " + kernelPath);
+		}
+		
+		return Win32MachinePrefix + kernelPath.substr(KernelMachinePrefix.size());
+	}
+}
+
+D3DKMTQuery::D3DKMTQuery(MetricsRecorder& metrics) : metrics(metrics), configManager(metrics)
+{}
+
+vector<Device> D3DKMTQuery::GetDevicesForAdapters(const map<int64_t, Adapter>& adapters)
+{
+	// If we don't have any adapters then don't query anything
+	if (adapters.empty())
+	{
+		LOG(L"Empty adapter list provided, skipping D3DKMT device query");
+		return {};
+	}
+	
+	// Query each adapter directly for its underlying PnP device, rather than enumerating PnP devices and matching them to adapters
+	ScopedTimer queryTimer(this->metrics, DiscoveryPhase::DeviceQuery);
+	vector<Device> devices;
+	for (auto const& adapter : adapters)
+	{
+		ScopedTimer timer(this->metrics, DiscoveryPhase::DeviceProperties, adapter.first);
+		devices.push_back(this->GetDeviceForAdapter(adapter.second));
+		LOG(L"Matched adapter LUID {} to PnP device {}", adapter.first, devices.back().ID);
+	}
+	
+	return devices;
+}
+
+Device D3DKMTQuery::GetDeviceForAdapter(const Adapter& adapter) const
+{
+	// Open a handle to the adapter
+	unique_adapter_handle handle = OpenAdapterFromLuid(adapter.InstanceLuid);
+	
+	// Retrieve the device instance ID from the device's hardware key and the driver registry key from the device's software key
+	Device details;
+	details.DeviceAdapter = adapter;
+	details.ID = InstanceIDFromHardwareKey(QueryPnpKey(handle.get(), D3DKMT_PNP_KEY_HARDWARE));
+	details.DriverRegistryKey = Win32PathFromKernelPath(QueryPnpKey(handle.get(), D3DKMT_PNP_KEY_SOFTWARE));
+	
+	// Retrieve the remaining device properties from the Configuration Manager if the device is visible to it
+	// (This is typically not the case inside process-isolated containers, so failures here are not fatal)
+	try
+	{
+		Device pnpDetails;
+		if (this->configManager.ExtractDeviceDetails(details.ID, pnpDetails) && pnpDetails.DeviceAdapter.InstanceLuid == adapter.InstanceLuid)
+		{
+			details.Description = std::move(pnpDetails.Description);
+			details.Vendor = std::move(pnpDetails.Vendor);
+			details.LocationPath = std::move(pnpDetails.LocationPath);
+			details.NumaNode = pnpDetails.NumaNode;
+			return details;
+		}
+	}
+	catch (const DeviceDiscoveryError& err) {
+		LOG(L"Could not retrieve Configuration Manager properties for PnP device {}: {}", details.ID, err.message);
+	}
+	
+	// Fall back to the adapter description reported by the kernel
+	auto registryInfo = QueryAdapterInfo<D3DKMT_ADAPTERREGISTRYINFO>(handle.get(), KMTQAITYPE_ADAPTERREGISTRYINFO);
+	details.Description = registryInfo.AdapterString;
+	return details;
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include "Adapter.h"
+#include "ConfigManagerQuery.h"
+#include "Device.h"
+#include "DeviceQuery.h"
+#include "MetricsRecorder.h"
+
+using std::map;
+using std::vector;
+using std::wstring;
+
+// Retrieves device details by querying each DirectX adapter for its PnP registry keys, without enumerating PCI devices or using WMI
+class D3DKMTQuery : public DeviceQuery
+{
+	public:
+		
+		D3DKMTQuery(MetricsRecorder& metrics);
+		
+		// Retrieves the device details for the underlying PnP devices associated with the supplied DirectX adapters
+		vector<Device> GetDevicesForAdapters(const map<int64_t, Adapter>& adapters) override;
+		
+	private:
+		
+		// Retrieves the device details for the underlying PnP device associated with an individual DirectX adapter
+		Device GetDeviceForAdapter(const Adapter& adapter) const;
+		
+		// The metrics recorder used to time our queries
+		MetricsRecorder& metrics;
+		
+		// Used to retrieve additional device properties when the PnP device is visible to the Configuration Manager
+		ConfigManagerQuery configManager;
+};
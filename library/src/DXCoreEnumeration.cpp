@@ -0,0 +1,240 @@
+#include "DXCoreEnumeration.h"
+#include "ErrorHandling.h"
+
+#include <Windows.Devices.Display.Core.Interop.h>
+
+namespace
+{
+	// Bit flags for the DXCore attributes that we query for each adapter
+	enum AdapterAttributeFlags : uint32_t
+	{
+		D3D11Graphics = 0x1,
+		D3D12Graphics = 0x2,
+		D3D12CoreCompute = 0x4
+	};
+	
+	// Queries each of the attributes we are interested in exactly once and returns them as a combination of AdapterAttributeFlags values
+	uint32_t QueryAdapterAttributes(const com_ptr<IDXCoreAdapter>& adapter)
+	{
+		return
+			(adapter->IsAttributeSupported(DXCORE_ADAPTER_ATTRIBUTE_D3D11_GRAPHICS) ? D3D11Graphics : 0) |
+			(adapter->IsAttributeSupported(DXCORE_ADAPTER_ATTRIBUTE_D3D12_GRAPHICS) ? D3D12Graphics : 0) |
+			(adapter->IsAttributeSupported(DXCORE_ADAPTER_ATTRIBUTE_D3D12_CORE_COMPUTE) ? D3D12CoreCompute : 0);
+	}
+}
+
+DXCoreEnumeration::DXCoreEnumeration(HANDLE staleEvent) : staleEvent(staleEvent)
+{
+	// Create our DXCore adapter factory
+	auto error = CheckHresult(DXCoreCreateAdapterFactory(this->adapterFactory.put()));
+	if (error) {
+		throw error.Wrap(L"DXCoreCreateAdapterFactory failed");
+	}
+}
+
+DXCoreEnumeration::~DXCoreEnumeration() {
+	this->UnregisterStaleNotifications();
+}
+
+vector<Adapter> DXCoreEnumeration::EnumerateCandidateAdapters(const DeviceFilter& filter)
+{
+	// Clear our existing adapter lists
+	this->UnregisterStaleNotifications();
+	this->adapterLists.clear();
+	
+	#define ENUMERATE_ADAPTERS(attribute)\
+	{\
+		GUID attributes[]{ attribute };\
+		this->adapterLists.push_back(nullptr); \
+		auto error = CheckHresult(this->adapterFactory->CreateAdapterList(_countof(attributes), attributes, this->adapterLists.back().put()));\
+		if (error) { \
+			throw error.Wrap(L"IDXCoreAdapterFactory::CreateAdapterList() failed for attribute " + wstring(L#attribute));\
+		}\
+		this->RegisterStaleNotification(this->adapterLists.back());\
+	}
+	
+	// Only create the lists that can contain adapters matching our filter, since any adapter that supports compute appears in the Direct3D 12 Core list
+	bool needDisplayLists = (filter == DeviceFilter::AllDevices || filter == DeviceFilter::DisplaySupported || filter == DeviceFilter::DisplayOnly);
+	bool needComputeList = (filter != DeviceFilter::DisplaySupported && filter != DeviceFilter::DisplayOnly);
+	
+	// Enumerate adapters that support Direct3D 11 and Direct3D 12
+	if (needDisplayLists)
+	{
+		ENUMERATE_ADAPTERS(DXCORE_ADAPTER_ATTRIBUTE_D3D11_GRAPHICS);
+		ENUMERATE_ADAPTERS(DXCORE_ADAPTER_ATTRIBUTE_D3D12_GRAPHICS);
+	}
+	
+	// Enumerate adapters that support Direct3D 12 Core
+	if (needComputeList) {
+		ENUMERATE_ADAPTERS(DXCORE_ADAPTER_ATTRIBUTE_D3D12_CORE_COMPUTE);
+	}
+	
+	#undef ENUMERATE_ADAPTERS
+	
+	// Process each of the enumerated adapters, skipping any adapter we have already seen in a previous list
+	vector<Adapter> candidates;
+	std::set<int64_t> seen;
+	for (auto const& adapters : this->adapterLists)
+	{
+		const uint32_t count = adapters->GetAdapterCount();
+		for (uint32_t index = 0; index < count; ++index)
+		{
+			// Extract the details for the current adapter
+			com_ptr<IDXCoreAdapter> adapter;
+			auto error = CheckHresult(adapters->GetAdapter(index, adapter.put()));
+			if (error) {
+				throw error.Wrap(L"IDXCoreAdapterList::GetAdapter() failed for index " + std::to_wstring(index));
+			}
+			
+			// Extract the LUID for the current adapter so we can skip duplicates before extracting any other properties
+			int64_t luid = DXCoreEnumeration::ExtractAdapterLuid(adapter);
+			if (!seen.insert(luid).second) {
+				continue;
+			}
+			candidates.push_back(this->ExtractAdapterDetails(adapter, luid));
+		}
+	}
+	
+	return candidates;
+}
+
+bool DXCoreEnumeration::IsStale() const
+{
+	// If we have not yet performed enumeration then report that our data is stale
+	if (this->adapterLists.empty())
+	{
+		LOG(L"No adapter lists yet, need to perform enumeration");
+		return true;
+	}
+	
+	// If any of our adapter lists are stale then our data is stale
+	for (auto const& list : this->adapterLists)
+	{
+		if (list->IsStale())
+		{
+			LOG(L"Found stale adapter list");
+			return true;
+		}
+	}
+	
+	return false;
+}
+
+void STDMETHODCALLTYPE DXCoreEnumeration::OnAdapterListStale(DXCoreNotificationType notificationType, IUnknown* object, void* context)
+{
+	// Signal the stale event, which we receive as our callback context
+	if (notificationType == DXCoreNotificationType::AdapterListStale) {
+		SetEvent(static_cast<HANDLE>(context));
+	}
+}
+
+void DXCoreEnumeration::RegisterStaleNotification(const com_ptr<IDXCoreAdapterList>& list)
+{
+	// If we don't have a stale event then don't register any notifications
+	if (this->staleEvent == nullptr) {
+		return;
+	}
+	
+	// Attempt to register for stale notifications for the adapter list
+	// (Failure is not fatal here, since callers can still detect stale lists by calling `IsStale()`)
+	uint32_t cookie = 0;
+	auto error = CheckHresult(this->adapterFactory->RegisterEventNotification(
+		list.get(),
+		DXCoreNotificationType::AdapterListStale,
+		DXCoreEnumeration::OnAdapterListStale,
+		this->staleEvent,
+		&cookie
+	));
+	if (error)
+	{
+		LOG(L"Failed to register for adapter list stale notifications: {}", error.Pretty());
+		return;
+	}
+	
+	this->notificationCookies.push_back(cookie);
+	
+	// If the list became stale before we finished registering then signal the event ourselves, since we may have missed the notification
+	if (list->IsStale()) {
+		SetEvent(this->staleEvent);
+	}
+}
+
+void DXCoreEnumeration::UnregisterStaleNotifications()
+{
+	// Unregister each of our notifications
+	for (auto cookie : this->notificationCookies) {
+		this->adapterFactory->UnregisterEventNotification(cookie);
+	}
+	
+	this->notificationCookies.clear();
+}
+
+int64_t DXCoreEnumeration::ExtractAdapterLuid(const com_ptr<IDXCoreAdapter>& adapter)
+{
+	// Extract the adapter LUID and convert it to an int64_t
+	LUID instanceLuid;
+	auto error = CheckHresult(adapter->GetProperty(DXCoreAdapterProperty::InstanceLuid, &instanceLuid));
+	if (error) {
+		throw error.Wrap(L"IDXCoreAdapter::GetProperty() failed for property InstanceLuid");
+	}
+	
+	return Int64FromLuid(instanceLuid);
+}
+
+Adapter DXCoreEnumeration::ExtractAdapterDetails(const com_ptr<IDXCoreAdapter>& adapter, int64_t luid) const
+{
+	Adapter details;
+	DeviceDiscoveryError error;
+	details.InstanceLuid = luid;
+	
+	// Extract the PnP hardware ID information
+	error = CheckHresult(adapter->GetProperty(DXCoreAdapterProperty::HardwareID, &details.HardwareID));
+	if (error) {
+		throw error.Wrap(L"IDXCoreAdapter::GetProperty() failed for property HardwareID");
+	}
+	
+	// Extract the version number of the adapter's driver
+	error = CheckHresult(adapter->GetProperty(DXCoreAdapterProperty::DriverVersion, &details.DriverVersion));
+	if (error) {
+		throw error.Wrap(L"IDXCoreAdapter::GetProperty() failed for property DriverVersion");
+	}
+	
+	// Extract the kernel-mode driver model version and the memory sizes, which are reported for every adapter
+	error = CheckHresult(adapter->GetProperty(DXCoreAdapterProperty::KmdModelVersion, &details.KmdModelVersion));
+	if (error) {
+		throw error.Wrap(L"IDXCoreAdapter::GetProperty() failed for property KmdModelVersion");
+	}
+	error = CheckHresult(adapter->GetProperty(DXCoreAdapterProperty::DedicatedAdapterMemory, &details.DedicatedAdapterMemory));
+	if (error) {
+		throw error.Wrap(L"IDXCoreAdapter::GetProperty() failed for property DedicatedAdapterMemory");
+	}
+	error = CheckHresult(adapter->GetProperty(DXCoreAdapterProperty::SharedSystemMemory, &details.SharedSystemMemory));
+	if (error) {
+		throw error.Wrap(L"IDXCoreAdapter::GetProperty() failed for property SharedSystemMemory");
+	}
+	
+	// Extract the boolean specifying whether the adapter is a hardware device
+	error = CheckHresult(adapter->GetProperty(DXCoreAdapterProperty::IsHardware, &details.IsHardware));
+	if (error) {
+		throw error.Wrap(L"IDXCoreAdapter::GetProperty() failed for property IsHardware");
+	}
+	
+	// Extract the boolean specifying whether the adapter is an integrated GPU
+	error = CheckHresult(adapter->GetProperty(DXCoreAdapterProperty::IsIntegrated, &details.IsIntegrated));
+	if (error) {
+		throw error.Wrap(L"IDXCoreAdapter::GetProperty() failed for property IsIntegrated");
+	}
+	
+	// Extract the boolean specifying whether the adapter is detachable
+	error = CheckHresult(adapter->GetProperty(DXCoreAdapterProperty::IsDetachable, &details.IsDetachable));
+	if (error) {
+		throw error.Wrap(L"IDXCoreAdapter::GetProperty() failed for property IsDetachable");
+	}
+	
+	// Determine whether the adapter supports display and whether it supports compute
+	uint32_t attributes = QueryAdapterAttributes(adapter);
+	details.SupportsDisplay = (attributes & (D3D11Graphics | D3D12Graphics)) != 0;
+	details.SupportsCompute = (attributes & D3D12CoreCompute) != 0;
+	
+	return details;
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include "AdapterEnumeration.h"
+
+using std::vector;
+using winrt::com_ptr;
+
+// Enumerates DirectX adapters using DXCore, and reports when the adapter lists become stale via DXCore notifications
+class DXCoreEnumeration : public AdapterEnumeration
+{
+	public:
+		
+		// Creates an adapter enumeration object that signals the supplied event whenever any of its adapter lists become stale
+		// (The event handle may be null, in which case no notifications will be registered and only `IsStale()` can be used)
+		DXCoreEnumeration(HANDLE staleEvent);
+		~DXCoreEnumeration();
+		
+		// Determines whether any of our adapter lists are stale and need to be refreshed by performing enumeration again
+		bool IsStale() const override;
+		
+	protected:
+		
+		// Enumerates the adapters from each of the DXCore adapter lists that can contain adapters matching the specified filter
+		vector<Adapter> EnumerateCandidateAdapters(const DeviceFilter& filter) override;
+		
+	private:
+		
+		// The callback that DXCore invokes when one of our adapter lists becomes stale
+		static void STDMETHODCALLTYPE OnAdapterListStale(DXCoreNotificationType notificationType, IUnknown* object, void* context);
+		
+		// Registers for stale notifications for the specified adapter list
+		void RegisterStaleNotification(const com_ptr<IDXCoreAdapterList>& list);
+		
+		// Unregisters all of our existing stale notifications
+		void UnregisterStaleNotifications();
+		
+		// Extracts the LUID from a DXCore adapter object
+		static int64_t ExtractAdapterLuid(const com_ptr<IDXCoreAdapter>& adapter);
+		
+		// Extracts the remaining details from a DXCore adapter object whose LUID has already been extracted
+		Adapter ExtractAdapterDetails(const com_ptr<IDXCoreAdapter>& adapter, int64_t luid) const;
+		
+		// Our DXCore adapter factory
+		com_ptr<IDXCoreAdapterFactory> adapterFactory;
+		
+		// The event that is signalled when any of our adapter lists become stale
+		HANDLE staleEvent;
+		
+		// The cookies for our registered stale notifications
+		vector<uint32_t> notificationCookies;
+		
+		// Our collection of DXCore adapter lists, used for enumerating adapters with various capabilities
+		// (Adapters that appear in multiple lists are only processed once, but we retain every list so we are notified when any of them become stale)
+		vector< com_ptr<IDXCoreAdapterList> > adapterLists;
+};
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "Adapter.h"
+#include "DeviceSnapshot.h"
 
 using std::vector;
 using std::wstring;
@@ -10,11 +11,9 @@ using std::wstring;
 // (For details, see: <https://docs.microsoft.com/en-us/windows-hardware/drivers/display/container-non-dx#driver-modifications-to-registry-and-file-paths>)
 struct RuntimeFile
 {
-	RuntimeFile(wstring SourcePath, wstring DestinationFilename)
+	RuntimeFile(wstring SourcePath, wstring DestinationFilename) :
+		SourcePath(std::move(SourcePath)), DestinationFilename(std::move(DestinationFilename))
 	{
-		this->SourcePath = SourcePath;
-		this->DestinationFilename = DestinationFilename;
-		
 		// If no destination filename was specified then use the filename from the source path
 		if (this->DestinationFilename.empty()) {
 			this->DestinationFilename = std::filesystem::path(this->SourcePath).filename().wstring();
@@ -50,6 +49,12 @@ struct Device
 	// The path to the physical location of the device in the system
 	wstring LocationPath;
 	
+	// The PCIe root complex under which the device is located (derived from the location path), or an empty string if unknown
+	wstring PcieRoot;
+	
+	// The NUMA node to which the device is attached, or DEVICE_NUMA_NODE_UNKNOWN if the device does not report one
+	int32_t NumaNode = DEVICE_NUMA_NODE_UNKNOWN;
+	
 	// The list of additional files that need to be copied from the driver store to the System32 directory in order to use the device with non-DirectX runtimes
 	vector<RuntimeFile> RuntimeFiles;
 	
@@ -1,9 +1,12 @@
 #include "DeviceDiscovery.h"
 #include "DeviceDiscoveryImp.h"
+#include "AllocationCounter.h"
+#include "LogBuffer.h"
 
 #define LIBRARY_VERSION L"0.0.1"
 
 #define INSTANCE (reinterpret_cast<DeviceDiscoveryImp*>(instance))
+#define SNAPSHOT (reinterpret_cast<shared_ptr<const DeviceList>*>(snapshot))
 
 const wchar_t* GetDiscoveryLibraryVersion() {
 	return LIBRARY_VERSION;
@@ -20,8 +23,35 @@ void EnableDiscoveryLogging()
 	spdlog::flush_on(spdlog::level::info);
 }
 
+void EnableDiscoveryLogBuffer(unsigned int capacity) {
+	LogBuffer::Enable(capacity);
+}
+
+int DrainDiscoveryLog(char* buffer, unsigned int size) {
+	return LogBuffer::Drain(buffer, size);
+}
+
+unsigned long long GetDiscoveryAllocationCount()
+{
+#ifdef DISCOVERY_COUNT_ALLOCATIONS
+	return AllocationCounter::GetCount();
+#else
+	return 0;
+#endif
+}
+
 DeviceDiscoveryInstance CreateDeviceDiscoveryInstance() {
-	return new DeviceDiscoveryImp();
+	return new DeviceDiscoveryImp(DiscoveryBackend::Wmi);
+}
+
+DeviceDiscoveryInstance CreateDeviceDiscoveryInstanceWithBackend(int backend)
+{
+	// Verify that the requested backend is valid
+	if (backend != DISCOVERYBACKEND_WMI && backend != DISCOVERYBACKEND_CONFIGMANAGER && backend != DISCOVERYBACKEND_D3DKMT) {
+		return nullptr;
+	}
+	
+	return new DeviceDiscoveryImp(static_cast<DiscoveryBackend>(backend));
 }
 
 void DestroyDeviceDiscoveryInstance(DeviceDiscoveryInstance instance) {
@@ -36,6 +66,10 @@ int DeviceDiscovery_IsRefreshRequired(DeviceDiscoveryInstance instance) {
 	return INSTANCE->IsRefreshRequired();
 }
 
+void* DeviceDiscovery_GetRefreshEventHandle(DeviceDiscoveryInstance instance) {
+	return INSTANCE->GetRefreshEventHandle();
+}
+
 int DeviceDiscovery_DiscoverDevices(DeviceDiscoveryInstance instance, int filter, int includeIntegrated, int includeDetachable)
 {
 	bool success = INSTANCE->DiscoverDevices(static_cast<DeviceFilter>(filter), includeIntegrated, includeDetachable);
@@ -74,6 +108,30 @@ const wchar_t* DeviceDiscovery_GetDeviceVendor(DeviceDiscoveryInstance instance,
 	return INSTANCE->GetDeviceVendor(device);
 }
 
+const wchar_t* DeviceDiscovery_GetDevicePcieRoot(DeviceDiscoveryInstance instance, unsigned int device) {
+	return INSTANCE->GetDevicePcieRoot(device);
+}
+
+int DeviceDiscovery_GetDeviceNumaNode(DeviceDiscoveryInstance instance, unsigned int device) {
+	return INSTANCE->GetDeviceNumaNode(device);
+}
+
+long long DeviceDiscovery_GetDeviceDriverVersion(DeviceDiscoveryInstance instance, unsigned int device) {
+	return INSTANCE->GetDeviceDriverVersion(device);
+}
+
+int DeviceDiscovery_GetDeviceKmdModelVersion(DeviceDiscoveryInstance instance, unsigned int device) {
+	return INSTANCE->GetDeviceKmdModelVersion(device);
+}
+
+long long DeviceDiscovery_GetDeviceDedicatedMemory(DeviceDiscoveryInstance instance, unsigned int device) {
+	return INSTANCE->GetDeviceDedicatedMemory(device);
+}
+
+long long DeviceDiscovery_GetDeviceSharedMemory(DeviceDiscoveryInstance instance, unsigned int device) {
+	return INSTANCE->GetDeviceSharedMemory(device);
+}
+
 int DeviceDiscovery_GetNumRuntimeFiles(DeviceDiscoveryInstance instance, unsigned int device) {
 	return INSTANCE->GetNumRuntimeFiles(device);
 }
@@ -113,3 +171,57 @@ int DeviceDiscovery_DoesDeviceSupportDisplay(DeviceDiscoveryInstance instance, u
 int DeviceDiscovery_DoesDeviceSupportCompute(DeviceDiscoveryInstance instance, unsigned int device) {
 	return INSTANCE->DoesDeviceSupportCompute(device);
 }
+
+const wchar_t* DeviceDiscovery_GetDeviceString(DeviceDiscoveryInstance instance, unsigned int device, int property, unsigned int* length) {
+	return INSTANCE->GetDeviceString(device, static_cast<DeviceStringProperty>(property), length);
+}
+
+const wchar_t* DeviceDiscovery_GetRuntimeFileString(DeviceDiscoveryInstance instance, unsigned int device, unsigned int file, int property, unsigned int* length) {
+	return INSTANCE->GetRuntimeFileString(device, file, static_cast<RuntimeFileStringProperty>(property), length);
+}
+
+int DeviceDiscovery_GetSnapshot(DeviceDiscoveryInstance instance, void* buffer, unsigned int size) {
+	return INSTANCE->GetSnapshot(buffer, size);
+}
+
+int DeviceDiscovery_SetCacheFile(DeviceDiscoveryInstance instance, const wchar_t* path) {
+	return INSTANCE->SetCacheFile(path);
+}
+
+int DeviceDiscovery_GetMetrics(DeviceDiscoveryInstance instance, DiscoveryMetricsRecord* records, unsigned int count) {
+	return INSTANCE->GetMetrics(records, count);
+}
+
+int DeviceDiscovery_GetDeviceUsage(DeviceDiscoveryInstance instance, DeviceUsageRecord* records, unsigned int count) {
+	return INSTANCE->GetDeviceUsage(records, count);
+}
+
+int DeviceDiscovery_CheckDeviceHealth(DeviceDiscoveryInstance instance, DeviceHealthRecord* records, unsigned int count) {
+	return INSTANCE->CheckDeviceHealth(records, count);
+}
+
+DeviceDiscoverySnapshot DeviceDiscovery_AcquireSnapshot(DeviceDiscoveryInstance instance) {
+	return INSTANCE->AcquireSnapshot();
+}
+
+DeviceDiscoverySnapshot DeviceDiscovery_AcquireFilteredSnapshot(DeviceDiscoveryInstance instance, int filter, int includeIntegrated, int includeDetachable) {
+	return INSTANCE->AcquireFilteredSnapshot(static_cast<DeviceFilter>(filter), includeIntegrated, includeDetachable);
+}
+
+void DeviceDiscovery_ReleaseSnapshot(DeviceDiscoverySnapshot snapshot) {
+	delete SNAPSHOT;
+}
+
+unsigned int DeviceDiscoverySnapshot_GetNumDevices(DeviceDiscoverySnapshot snapshot) {
+	return static_cast<unsigned int>((*SNAPSHOT)->Devices.size());
+}
+
+const void* DeviceDiscoverySnapshot_GetData(DeviceDiscoverySnapshot snapshot, unsigned int* size)
+{
+	const vector<uint8_t>& data = (*SNAPSHOT)->Snapshot;
+	if (size != nullptr) {
+		*size = static_cast<unsigned int>(data.size());
+	}
+	
+	return data.data();
+}
@@ -1,60 +1,240 @@
 #include "DeviceDiscoveryImp.h"
+#include "ConfigManagerQuery.h"
+#include "D3DKMTEnumeration.h"
+#include "D3DKMTQuery.h"
+#include "DXCoreEnumeration.h"
 #include "ErrorHandling.h"
 #include "RegistryQuery.h"
+#include "SnapshotSerialiser.h"
+#include "TopologyHelpers.h"
+#include "TraceLogging.h"
+#include "WmiQuery.h"
 
+#include <algorithm>
+#include <cstring>
 #include <roapi.h>
 #include <stdexcept>
 
 #define RETURN_ERROR(sentinel, message) this->SetLastErrorMessage(message); return sentinel
 #define RETURN_SUCCESS(value) this->SetLastErrorMessage(L""); return value
 
-#define VERIFY_DEVICE(sentinel) try { this->ValidateRequestedDevice(device); } catch (const DeviceDiscoveryError& err) { RETURN_ERROR(sentinel, err.message); }
+#define VERIFY_DEVICE(sentinel) shared_ptr<const DeviceList> list; try { list = this->ValidateRequestedDevice(device); } catch (const DeviceDiscoveryError& err) { RETURN_ERROR(sentinel, err.message); }
 #define VERIFY_FILE() if (file >= files.size()) { RETURN_ERROR(nullptr, L"requested runtime file index is invalid: " + std::to_wstring(file)); }
 
+thread_local wstring DeviceDiscoveryImp::lastError;
+
+DeviceDiscoveryImp::DeviceDiscoveryImp(DiscoveryBackend backend) : backend(backend)
+{
+	// The D3DKMT backend has no means of receiving stale notifications, so we leave the refresh event null to indicate that callers need to poll
+	if (this->backend == DiscoveryBackend::D3DKMT)
+	{
+		LOG(L"Refresh notifications are unavailable for the D3DKMT discovery backend");
+		return;
+	}
+	
+	// Create the auto-reset event that our adapter enumeration object will signal when the adapter list becomes stale
+	// (If event creation fails then the handle remains null and callers will need to fall back to polling `IsRefreshRequired()`)
+	if (!this->refreshEvent.try_create(wil::EventOptions::None, nullptr)) {
+		LOG(L"Failed to create the refresh event, refresh notifications will be unavailable");
+	}
+}
+
 const wchar_t* DeviceDiscoveryImp::GetLastErrorMessage() const {
 	return this->lastError.c_str();
 }
 
-bool DeviceDiscoveryImp::IsRefreshRequired()
+void* DeviceDiscoveryImp::GetRefreshEventHandle() const {
+	return this->refreshEvent.get();
+}
+
+int DeviceDiscoveryImp::IsRefreshRequired()
 {
 	// Make sure WinRT is initialised for the calling thread
 	Windows::Foundation::Initialize(RO_INIT_MULTITHREADED);
+	std::lock_guard<std::mutex> lock(this->discoveryMutex);
 	
-	// We require a refresh if we have no data or we have stale data
-	return (this->HaveDevices()) ? this->enumeration->IsStale() : true;
+	try
+	{
+		// We require a refresh if we have no data, we have stale data, or our data was loaded from the cache and needs to be revalidated
+		// (Checking for stale data can fail for backends that query the adapter list directly, so errors must not propagate to the caller)
+		bool required = (this->HaveDevices()) ? (this->revalidationRequired || this->enumeration->IsStale()) : true;
+		RETURN_SUCCESS(required ? 1 : 0);
+	}
+	catch (const DeviceDiscoveryError& err) {
+		RETURN_ERROR(-1, err.Pretty());
+	}
+	catch (const std::runtime_error& err) {
+		RETURN_ERROR(-1, winrt::to_hstring(err.what()));
+	}
 }
 
 bool DeviceDiscoveryImp::DiscoverDevices(DeviceFilter filter, bool includeIntegrated, bool includeDetachable)
 {
 	// Make sure WinRT is initialised for the calling thread
 	Windows::Foundation::Initialize(RO_INIT_MULTITHREADED);
+	std::lock_guard<std::mutex> lock(this->discoveryMutex);
+	
+	// Trace the entire discovery operation
+	TraceActivity activity("DiscoverDevices");
 	
 	try
 	{
-		// If this is the first time we're performing device discovery then create our helper objects
+		// Time the entire discovery operation
+		ScopedTimer timer(this->metrics, DiscoveryPhase::DiscoverDevices);
+		
+		// If this is the first time we're performing device discovery then create the adapter enumeration object for our selected backend
 		if (!this->HaveDevices())
 		{
-			this->enumeration = std::make_unique<AdapterEnumeration>();
-			this->wmi = std::make_unique<WmiQuery>();
+			if (this->backend == DiscoveryBackend::D3DKMT) {
+				this->enumeration = std::make_unique<D3DKMTEnumeration>();
+			}
+			else {
+				this->enumeration = std::make_unique<DXCoreEnumeration>(this->refreshEvent.get());
+			}
 		}
 		
 		// Enumerate the DirectX adapters that meet the supplied filtering criteria
-		this->enumeration->EnumerateAdapters(filter, includeIntegrated, includeDetachable);
+		{
+			ScopedTimer timer(this->metrics, DiscoveryPhase::EnumerateAdapters);
+			TraceActivity enumerationActivity("EnumerateAdapters");
+			this->enumeration->EnumerateAdapters(filter, includeIntegrated, includeDetachable);
+		}
+		
+		// Discard the per-device metrics for any adapters that have been removed
+		for (auto luid : this->enumeration->GetAdapterChanges().Removed) {
+			this->metrics.RemoveDevice(luid);
+		}
+		
+		// If our existing device details were loaded from the cache then query all adapters again to revalidate them,
+		// otherwise carry over the existing device details for any adapters that are unchanged since the previous enumeration
+		// (Carried over devices are identified by their index in our existing list, and are only copied into the new list once all queries have succeeded)
+		const AdapterChanges& changes = this->enumeration->GetAdapterChanges();
+		map<int64_t, Adapter> pending = changes.Added;
+		shared_ptr<const DeviceList> previous = this->CurrentList();
+		const vector<Device> noDevices;
+		const vector<Device>& existingDevices = (previous) ? previous->Devices : noDevices;
+		vector< std::pair<size_t, Adapter> > carried;
+		vector<Device> fromCache;
+		if (this->revalidationRequired)
+		{
+			LOG(L"Revalidating device details that were loaded from the discovery cache");
+			pending.insert(changes.Unchanged.begin(), changes.Unchanged.end());
+		}
+		else
+		{
+			for (auto const& adapter : changes.Unchanged)
+			{
+				// If we have no existing details for the adapter (e.g. because a previous discovery operation failed) then query them again
+				auto existing = std::find_if(existingDevices.begin(), existingDevices.end(), [&adapter](const Device& device) {
+					return device.DeviceAdapter.InstanceLuid == adapter.first;
+				});
+				if (existing == existingDevices.end())
+				{
+					pending.insert(adapter);
+					continue;
+				}
+				
+				// Record the existing device along with its refreshed adapter details
+				carried.push_back({ static_cast<size_t>(existing - existingDevices.begin()), adapter.second });
+			}
+		}
+		
+		// If this is our first discovery operation then use any valid cached details for the newly-added adapters
+		size_t numCached = 0;
+		if (this->cache && !this->cacheConsulted)
+		{
+			this->cacheConsulted = true;
+			map<int64_t, Device> cached = this->cache->Load();
+			for (auto adapter = pending.begin(); adapter != pending.end();)
+			{
+				auto entry = cached.find(adapter->first);
+				if (entry == cached.end() || !DiscoveryCache::IsValidFor(entry->second, adapter->second))
+				{
+					++adapter;
+					continue;
+				}
+				
+				// Use the cached details, refreshing the adapter details from the live adapter
+				fromCache.push_back(std::move(entry->second));
+				fromCache.back().DeviceAdapter = adapter->second;
+				adapter = pending.erase(adapter);
+				numCached++;
+			}
+		}
+		
+		// If this is the first time we need to query device details then create the device query object for our selected backend
+		// (This is deferred so discovery operations that are satisfied entirely by the cache don't pay the cost of connecting to WMI)
+		if (!pending.empty() && !this->deviceQuery)
+		{
+			LOG(L"Using discovery backend: {}", DiscoveryBackendName(this->backend));
+			if (this->backend == DiscoveryBackend::ConfigManager) {
+				this->deviceQuery = std::make_unique<ConfigManagerQuery>(this->metrics);
+			}
+			else if (this->backend == DiscoveryBackend::D3DKMT) {
+				this->deviceQuery = std::make_unique<D3DKMTQuery>(this->metrics);
+			}
+			else {
+				this->deviceQuery = std::make_unique<WmiQuery>(this->metrics);
+			}
+		}
+		
+		// Retrieve the PnP device details for each of the newly-added adapters
+		vector<Device> added = (this->deviceQuery) ? this->deviceQuery->GetDevicesForAdapters(pending) : vector<Device>();
 		
-		// Retrieve the PnP device details from WMI for each of the enumerated adapters
-		this->devices = this->wmi->GetDevicesForAdapters(this->enumeration->GetUniqueAdapters());
+		// Retrieve the driver details from the registry for each of the newly-added devices
+		RegistryQuery::FillDriverDetailsForDevices(added, this->metrics, this->runtimeFiles);
 		
-		// Retrieve the driver details from the registry for each of the devices
-		for (auto& device : this->devices) {
-			RegistryQuery::FillDriverDetails(device);
+		// Assemble the new device list, copying the details for carried over devices (since published lists are immutable) and moving those for cached and newly-added devices
+		auto list = std::make_shared<DeviceList>();
+		vector<Device>& devices = list->Devices;
+		devices.reserve(carried.size() + fromCache.size() + added.size());
+		for (auto& entry : carried)
+		{
+			devices.push_back(existingDevices[entry.first]);
+			devices.back().DeviceAdapter = entry.second;
+		}
+		for (auto& device : fromCache) {
+			devices.push_back(std::move(device));
+		}
+		for (auto& device : added)
+		{
+			// Derive the PCIe root complex from the location path
+			device.PcieRoot = TopologyHelpers::GetPcieRoot(device.LocationPath);
+			devices.push_back(std::move(device));
+		}
+		
+		// Discard any cached runtime files for driver registry keys that are no longer used by any device in the new list
+		this->runtimeFiles.Prune(devices);
+		
+		// Serialise the new list so snapshot requests don't need to repeat the work, and then publish it in place of our existing list
+		// (Any snapshot handles for the existing list keep it alive until they are released)
+		list->Snapshot = SnapshotSerialiser::Serialise(devices);
+		shared_ptr<const DeviceList> published(std::move(list));
+		std::atomic_store(&this->current, published);
+		
+		// If we used any cached details then request a refresh so they are revalidated, otherwise update the cache with our live details
+		this->revalidationRequired = (numCached > 0);
+		if (this->revalidationRequired)
+		{
+			LOG(L"Used cached device details for {} adapters, requesting a refresh to revalidate them", numCached);
+			if (this->refreshEvent) {
+				SetEvent(this->refreshEvent.get());
+			}
+		}
+		else if (this->cache) {
+			this->cache->Save(published->Devices);
 		}
 		
 		RETURN_SUCCESS(true);
 	}
-	catch (const DeviceDiscoveryError& err) {
+	catch (const DeviceDiscoveryError& err)
+	{
+		activity.SetError(err);
 		RETURN_ERROR(false, err.Pretty());
 	}
-	catch (const std::runtime_error& err) {
+	catch (const std::runtime_error& err)
+	{
+		activity.SetResult(E_FAIL);
 		RETURN_ERROR(false, winrt::to_hstring(err.what()));
 	}
 }
@@ -62,11 +242,12 @@ bool DeviceDiscoveryImp::DiscoverDevices(DeviceFilter filter, bool includeIntegr
 int DeviceDiscoveryImp::GetNumDevices()
 {
 	// Verify that we have a device list
-	if (!this->HaveDevices()) {
+	shared_ptr<const DeviceList> list = this->CurrentList();
+	if (!list) {
 		RETURN_ERROR(-1, L"attempted to retrieve device count before performing device discovery");
 	}
 	
-	RETURN_SUCCESS(this->devices.size());
+	RETURN_SUCCESS(static_cast<int>(list->Devices.size()));
 }
 
 long long DeviceDiscoveryImp::GetDeviceAdapterLUID(unsigned int device)
@@ -75,7 +256,7 @@ long long DeviceDiscoveryImp::GetDeviceAdapterLUID(unsigned int device)
 	VERIFY_DEVICE(-1);
 	
 	// Retrieve the adapter LUID of the specified device
-	RETURN_SUCCESS(this->devices[device].DeviceAdapter.InstanceLuid);
+	RETURN_SUCCESS(list->Devices[device].DeviceAdapter.InstanceLuid);
 }
 
 const wchar_t* DeviceDiscoveryImp::GetDeviceID(unsigned int device)
@@ -84,7 +265,7 @@ const wchar_t* DeviceDiscoveryImp::GetDeviceID(unsigned int device)
 	VERIFY_DEVICE(nullptr);
 	
 	// Retrieve the ID of the specified device
-	RETURN_SUCCESS(this->devices[device].ID.c_str());
+	RETURN_SUCCESS(list->Devices[device].ID.c_str());
 }
 
 const wchar_t* DeviceDiscoveryImp::GetDeviceDescription(unsigned int device)
@@ -93,7 +274,7 @@ const wchar_t* DeviceDiscoveryImp::GetDeviceDescription(unsigned int device)
 	VERIFY_DEVICE(nullptr);
 	
 	// Retrieve the human-readable description of the specified device
-	RETURN_SUCCESS(this->devices[device].Description.c_str());
+	RETURN_SUCCESS(list->Devices[device].Description.c_str());
 }
 
 const wchar_t* DeviceDiscoveryImp::GetDeviceDriverRegistryKey(unsigned int device)
@@ -102,7 +283,7 @@ const wchar_t* DeviceDiscoveryImp::GetDeviceDriverRegistryKey(unsigned int devic
 	VERIFY_DEVICE(nullptr);
 	
 	// Retrieve the path of the registry key with the driver details for the specified device
-	RETURN_SUCCESS(this->devices[device].DriverRegistryKey.c_str());
+	RETURN_SUCCESS(list->Devices[device].DriverRegistryKey.c_str());
 }
 
 const wchar_t* DeviceDiscoveryImp::GetDeviceDriverStorePath(unsigned int device)
@@ -111,7 +292,7 @@ const wchar_t* DeviceDiscoveryImp::GetDeviceDriverStorePath(unsigned int device)
 	VERIFY_DEVICE(nullptr);
 	
 	// Retrieve the absolute path to the driver store directory for the specified device
-	RETURN_SUCCESS(this->devices[device].DriverStorePath.c_str());
+	RETURN_SUCCESS(list->Devices[device].DriverStorePath.c_str());
 }
 
 const wchar_t* DeviceDiscoveryImp::GetDeviceLocationPath(unsigned int device)
@@ -120,7 +301,7 @@ const wchar_t* DeviceDiscoveryImp::GetDeviceLocationPath(unsigned int device)
 	VERIFY_DEVICE(nullptr);
 	
 	// Retrieve the physical location path of the specified device
-	RETURN_SUCCESS(this->devices[device].LocationPath.c_str());
+	RETURN_SUCCESS(list->Devices[device].LocationPath.c_str());
 }
 
 const wchar_t* DeviceDiscoveryImp::GetDeviceVendor(unsigned int device)
@@ -129,7 +310,61 @@ const wchar_t* DeviceDiscoveryImp::GetDeviceVendor(unsigned int device)
 	VERIFY_DEVICE(nullptr);
 	
 	// Retrieve the vendor of the specified device
-	RETURN_SUCCESS(this->devices[device].Vendor.c_str());
+	RETURN_SUCCESS(list->Devices[device].Vendor.c_str());
+}
+
+const wchar_t* DeviceDiscoveryImp::GetDevicePcieRoot(unsigned int device)
+{
+	// Verify that the requested device exists
+	VERIFY_DEVICE(nullptr);
+	
+	// Retrieve the PCIe root complex of the specified device
+	RETURN_SUCCESS(list->Devices[device].PcieRoot.c_str());
+}
+
+int DeviceDiscoveryImp::GetDeviceNumaNode(unsigned int device)
+{
+	// Verify that the requested device exists
+	VERIFY_DEVICE(-1);
+	
+	// Retrieve the NUMA node of the specified device
+	RETURN_SUCCESS(list->Devices[device].NumaNode);
+}
+
+long long DeviceDiscoveryImp::GetDeviceDriverVersion(unsigned int device)
+{
+	// Verify that the requested device exists
+	VERIFY_DEVICE(-1);
+	
+	// Retrieve the driver version of the specified device
+	RETURN_SUCCESS(static_cast<long long>(list->Devices[device].DeviceAdapter.DriverVersion));
+}
+
+int DeviceDiscoveryImp::GetDeviceKmdModelVersion(unsigned int device)
+{
+	// Verify that the requested device exists
+	VERIFY_DEVICE(-1);
+	
+	// Retrieve the kernel-mode driver model version of the specified device
+	RETURN_SUCCESS(static_cast<int>(list->Devices[device].DeviceAdapter.KmdModelVersion));
+}
+
+long long DeviceDiscoveryImp::GetDeviceDedicatedMemory(unsigned int device)
+{
+	// Verify that the requested device exists
+	VERIFY_DEVICE(-1);
+	
+	// Retrieve the dedicated adapter memory size of the specified device
+	RETURN_SUCCESS(static_cast<long long>(list->Devices[device].DeviceAdapter.DedicatedAdapterMemory));
+}
+
+long long DeviceDiscoveryImp::GetDeviceSharedMemory(unsigned int device)
+{
+	// Verify that the requested device exists
+	VERIFY_DEVICE(-1);
+	
+	// Retrieve the shared system memory size of the specified device
+	RETURN_SUCCESS(static_cast<long long>(list->Devices[device].DeviceAdapter.SharedSystemMemory));
 }
 
 int DeviceDiscoveryImp::GetNumRuntimeFiles(unsigned int device)
@@ -138,7 +373,7 @@ int DeviceDiscoveryImp::GetNumRuntimeFiles(unsigned int device)
 	VERIFY_DEVICE(-1);
 	
 	// Retrieve the number of additional runtime files for the device
-	RETURN_SUCCESS(this->devices[device].RuntimeFiles.size());
+	RETURN_SUCCESS(static_cast<int>(list->Devices[device].RuntimeFiles.size()));
 }
 
 const wchar_t* DeviceDiscoveryImp::GetRuntimeFileSource(unsigned int device, unsigned int file)
@@ -147,7 +382,7 @@ const wchar_t* DeviceDiscoveryImp::GetRuntimeFileSource(unsigned int device, uns
 	VERIFY_DEVICE(nullptr);
 	
 	// Verify that the requested file entry exists
-	const vector<RuntimeFile>& files = this->devices[device].RuntimeFiles;
+	const vector<RuntimeFile>& files = list->Devices[device].RuntimeFiles;
 	VERIFY_FILE();
 	
 	// Retrieve the source path for the file
@@ -160,7 +395,7 @@ const wchar_t* DeviceDiscoveryImp::GetRuntimeFileDestination(unsigned int device
 	VERIFY_DEVICE(nullptr);
 	
 	// Verify that the requested file entry exists
-	const vector<RuntimeFile>& files = this->devices[device].RuntimeFiles;
+	const vector<RuntimeFile>& files = list->Devices[device].RuntimeFiles;
 	VERIFY_FILE();
 	
 	// Retrieve the destination filename for the file
@@ -173,7 +408,7 @@ int DeviceDiscoveryImp::GetNumRuntimeFilesWow64(unsigned int device)
 	VERIFY_DEVICE(-1);
 	
 	// Retrieve the number of additional SysWOW64 runtime files for the device
-	RETURN_SUCCESS(this->devices[device].RuntimeFilesWow64.size());
+	RETURN_SUCCESS(static_cast<int>(list->Devices[device].RuntimeFilesWow64.size()));
 }
 
 const wchar_t* DeviceDiscoveryImp::GetRuntimeFileSourceWow64(unsigned int device, unsigned int file)
@@ -182,7 +417,7 @@ const wchar_t* DeviceDiscoveryImp::GetRuntimeFileSourceWow64(unsigned int device
 	VERIFY_DEVICE(nullptr);
 	
 	// Verify that the requested file entry exists
-	const vector<RuntimeFile>& files = this->devices[device].RuntimeFilesWow64;
+	const vector<RuntimeFile>& files = list->Devices[device].RuntimeFilesWow64;
 	VERIFY_FILE();
 	
 	// Retrieve the source path for the file
@@ -195,7 +430,7 @@ const wchar_t* DeviceDiscoveryImp::GetRuntimeFileDestinationWow64(unsigned int d
 	VERIFY_DEVICE(nullptr);
 	
 	// Verify that the requested file entry exists
-	const vector<RuntimeFile>& files = this->devices[device].RuntimeFilesWow64;
+	const vector<RuntimeFile>& files = list->Devices[device].RuntimeFilesWow64;
 	VERIFY_FILE();
 	
 	// Retrieve the destination filename for the file
@@ -208,7 +443,7 @@ int DeviceDiscoveryImp::IsDeviceIntegrated(unsigned int device)
 	VERIFY_DEVICE(-1);
 	
 	// Determine whether the specified device is an integrated GPU
-	RETURN_SUCCESS(this->devices[device].DeviceAdapter.IsIntegrated);
+	RETURN_SUCCESS(list->Devices[device].DeviceAdapter.IsIntegrated);
 }
 
 int DeviceDiscoveryImp::IsDeviceDetachable(unsigned int device)
@@ -217,7 +452,7 @@ int DeviceDiscoveryImp::IsDeviceDetachable(unsigned int device)
 	VERIFY_DEVICE(-1);
 	
 	// Determine whether the specified device is detachable
-	RETURN_SUCCESS(this->devices[device].DeviceAdapter.IsDetachable);
+	RETURN_SUCCESS(list->Devices[device].DeviceAdapter.IsDetachable);
 }
 
 int DeviceDiscoveryImp::DoesDeviceSupportDisplay(unsigned int device)
@@ -226,7 +461,7 @@ int DeviceDiscoveryImp::DoesDeviceSupportDisplay(unsigned int device)
 	VERIFY_DEVICE(-1);
 	
 	// Determine whether the specified device supports display
-	RETURN_SUCCESS(this->devices[device].DeviceAdapter.SupportsDisplay);
+	RETURN_SUCCESS(list->Devices[device].DeviceAdapter.SupportsDisplay);
 }
 
 int DeviceDiscoveryImp::DoesDeviceSupportCompute(unsigned int device)
@@ -235,26 +470,234 @@ int DeviceDiscoveryImp::DoesDeviceSupportCompute(unsigned int device)
 	VERIFY_DEVICE(-1);
 	
 	// Determine whether the specified device supports compute
-	RETURN_SUCCESS(this->devices[device].DeviceAdapter.SupportsCompute);
+	RETURN_SUCCESS(list->Devices[device].DeviceAdapter.SupportsCompute);
+}
+
+const wchar_t* DeviceDiscoveryImp::GetDeviceString(unsigned int device, DeviceStringProperty property, unsigned int* length)
+{
+	// Verify that the requested device exists
+	VERIFY_DEVICE(nullptr);
+	
+	// Select the requested string property of the specified device
+	const Device& details = list->Devices[device];
+	const wstring* value = nullptr;
+	switch (property)
+	{
+		case DeviceStringProperty::ID:
+			value = &details.ID;
+			break;
+			
+		case DeviceStringProperty::Description:
+			value = &details.Description;
+			break;
+			
+		case DeviceStringProperty::DriverRegistryKey:
+			value = &details.DriverRegistryKey;
+			break;
+			
+		case DeviceStringProperty::DriverStorePath:
+			value = &details.DriverStorePath;
+			break;
+			
+		case DeviceStringProperty::LocationPath:
+			value = &details.LocationPath;
+			break;
+			
+		case DeviceStringProperty::Vendor:
+			value = &details.Vendor;
+			break;
+			
+		case DeviceStringProperty::PcieRoot:
+			value = &details.PcieRoot;
+			break;
+			
+		default:
+			RETURN_ERROR(nullptr, L"requested device string property is invalid: " + std::to_wstring(static_cast<int>(property)));
+	}
+	
+	// Report the length of the string so the caller doesn't need to scan it for the NUL terminator
+	if (length != nullptr) {
+		*length = static_cast<unsigned int>(value->size());
+	}
+	
+	RETURN_SUCCESS(value->c_str());
+}
+
+const wchar_t* DeviceDiscoveryImp::GetRuntimeFileString(unsigned int device, unsigned int file, RuntimeFileStringProperty property, unsigned int* length)
+{
+	// Verify that the requested device exists
+	VERIFY_DEVICE(nullptr);
+	
+	// Verify that the requested property is valid
+	bool wow64 = (property == RuntimeFileStringProperty::SourceWow64 || property == RuntimeFileStringProperty::DestinationWow64);
+	bool source = (property == RuntimeFileStringProperty::Source || property == RuntimeFileStringProperty::SourceWow64);
+	if (!wow64 && !source && property != RuntimeFileStringProperty::Destination) {
+		RETURN_ERROR(nullptr, L"requested runtime file string property is invalid: " + std::to_wstring(static_cast<int>(property)));
+	}
+	
+	// Verify that the requested file entry exists
+	const Device& details = list->Devices[device];
+	const vector<RuntimeFile>& files = (wow64) ? details.RuntimeFilesWow64 : details.RuntimeFiles;
+	VERIFY_FILE();
+	
+	// Select the requested path and report its length so the caller doesn't need to scan it for the NUL terminator
+	const wstring& value = (source) ? files[file].SourcePath : files[file].DestinationFilename;
+	if (length != nullptr) {
+		*length = static_cast<unsigned int>(value.size());
+	}
+	
+	RETURN_SUCCESS(value.c_str());
+}
+
+int DeviceDiscoveryImp::GetSnapshot(void* buffer, unsigned int size)
+{
+	// Verify that we have a device list
+	if (!this->HaveDevices()) {
+		RETURN_ERROR(-1, L"attempted to retrieve device snapshot before performing device discovery");
+	}
+	
+	// Only copy the snapshot if the supplied buffer is large enough to hold it, otherwise just report the required size
+	shared_ptr<const DeviceList> list = this->CurrentList();
+	if (buffer != nullptr && size >= list->Snapshot.size()) {
+		memcpy(buffer, list->Snapshot.data(), list->Snapshot.size());
+	}
+	
+	RETURN_SUCCESS(static_cast<int>(list->Snapshot.size()));
+}
+
+int DeviceDiscoveryImp::SetCacheFile(const wchar_t* path)
+{
+	std::lock_guard<std::mutex> lock(this->discoveryMutex);
+	
+	// The cache file can only be set before device discovery is first performed, since that is the only time it is read
+	if (this->HaveDevices()) {
+		RETURN_ERROR(-1, L"attempted to set the discovery cache file after performing device discovery");
+	}
+	
+	// An empty path disables the cache
+	if (path == nullptr || wstring(path).empty()) {
+		this->cache.reset();
+	}
+	else {
+		this->cache = std::make_unique<DiscoveryCache>(path);
+	}
+	
+	RETURN_SUCCESS(0);
+}
+
+int DeviceDiscoveryImp::GetMetrics(DiscoveryMetricsRecord* records, unsigned int count)
+{
+	// Only copy the metrics if the supplied array is large enough to hold them, otherwise just report the required number of records
+	vector<DiscoveryMetricsRecord> metrics = this->metrics.GetRecords();
+	if (records != nullptr && count >= metrics.size()) {
+		std::copy(metrics.begin(), metrics.end(), records);
+	}
+	
+	RETURN_SUCCESS(static_cast<int>(metrics.size()));
+}
+
+int DeviceDiscoveryImp::GetDeviceUsage(DeviceUsageRecord* records, unsigned int count)
+{
+	// Verify that we have a device list
+	if (!this->HaveDevices()) {
+		RETURN_ERROR(-1, L"attempted to sample device usage before performing device discovery");
+	}
+	
+	// Only sample usage if the supplied array is large enough to hold a record for every device, since sampling resets the utilisation interval
+	shared_ptr<const DeviceList> list = this->CurrentList();
+	if (records == nullptr || count < list->Devices.size()) {
+		RETURN_SUCCESS(static_cast<int>(list->Devices.size()));
+	}
+	
+	// Sample the usage of each device and copy the records, which may omit devices whose statistics could not be queried
+	std::lock_guard<std::mutex> lock(this->samplingMutex);
+	vector<DeviceUsageRecord> usage = this->usage.Sample(list->Devices);
+	std::copy(usage.begin(), usage.end(), records);
+	RETURN_SUCCESS(static_cast<int>(usage.size()));
+}
+
+int DeviceDiscoveryImp::CheckDeviceHealth(DeviceHealthRecord* records, unsigned int count)
+{
+	// Verify that we have a device list
+	if (!this->HaveDevices()) {
+		RETURN_ERROR(-1, L"attempted to check device health before performing device discovery");
+	}
+	
+	// Only check health if the supplied array is large enough to hold a record for every device, since checking updates the stored reset counts
+	shared_ptr<const DeviceList> list = this->CurrentList();
+	if (records == nullptr || count < list->Devices.size()) {
+		RETURN_SUCCESS(static_cast<int>(list->Devices.size()));
+	}
+	
+	// Check the health of each device and copy the records
+	std::lock_guard<std::mutex> lock(this->samplingMutex);
+	vector<DeviceHealthRecord> health = this->health.CheckHealth(list->Devices);
+	std::copy(health.begin(), health.end(), records);
+	RETURN_SUCCESS(static_cast<int>(health.size()));
+}
+
+shared_ptr<const DeviceList>* DeviceDiscoveryImp::AcquireSnapshot()
+{
+	// Verify that we have a device list
+	shared_ptr<const DeviceList> list = this->CurrentList();
+	if (!list) {
+		RETURN_ERROR(nullptr, L"attempted to acquire device snapshot before performing device discovery");
+	}
+	
+	// The handle holds its own reference to the list, so the list outlives any subsequent device discovery until the handle is released
+	RETURN_SUCCESS(new shared_ptr<const DeviceList>(std::move(list)));
+}
+
+shared_ptr<const DeviceList>* DeviceDiscoveryImp::AcquireFilteredSnapshot(DeviceFilter filter, bool includeIntegrated, bool includeDetachable)
+{
+	// Verify that we have a device list
+	shared_ptr<const DeviceList> list = this->CurrentList();
+	if (!list) {
+		RETURN_ERROR(nullptr, L"attempted to acquire filtered device snapshot before performing device discovery");
+	}
+	
+	// Select the devices whose adapters match the supplied filtering criteria, using the same criteria as adapter enumeration
+	auto filtered = std::make_shared<DeviceList>();
+	for (auto const& device : list->Devices)
+	{
+		if (AdapterEnumeration::MatchesFilter(device.DeviceAdapter, filter, includeIntegrated, includeDetachable)) {
+			filtered->Devices.push_back(device);
+		}
+	}
+	
+	// If every device matches then share the existing list rather than serialising an identical copy
+	if (filtered->Devices.size() == list->Devices.size()) {
+		RETURN_SUCCESS(new shared_ptr<const DeviceList>(std::move(list)));
+	}
+	
+	filtered->Snapshot = SnapshotSerialiser::Serialise(filtered->Devices);
+	RETURN_SUCCESS(new shared_ptr<const DeviceList>(std::move(filtered)));
+}
+
+shared_ptr<const DeviceList> DeviceDiscoveryImp::CurrentList() const {
+	return std::atomic_load(&this->current);
 }
 
 bool DeviceDiscoveryImp::HaveDevices() const {
-	return (this->enumeration && this->wmi);
+	return (this->CurrentList() != nullptr);
 }
 
 void DeviceDiscoveryImp::SetLastErrorMessage(std::wstring_view message) {
 	this->lastError = message;
 }
 
-void DeviceDiscoveryImp::ValidateRequestedDevice(unsigned int device)
+shared_ptr<const DeviceList> DeviceDiscoveryImp::ValidateRequestedDevice(unsigned int device) const
 {
 	// Verify that we have a device list
-	if (!this->HaveDevices()) {
+	shared_ptr<const DeviceList> list = this->CurrentList();
+	if (!list) {
 		throw CreateError(L"attempted to retrieve device details before performing device discovery");
 	}
 	
-	// Verify that the specified device index is valid
-	if (device >= this->GetNumDevices()) {
+	// Verify that the specified device index is valid for that same list, since a concurrent device discovery may publish a different one
+	if (device >= list->Devices.size()) {
 		throw CreateError(L"requested device index is invalid: " + std::to_wstring(device));
 	}
+	
+	return list;
 }
@@ -2,9 +2,21 @@
 
 #include "AdapterEnumeration.h"
 #include "Device.h"
+#include "DeviceList.h"
 #include "DeviceFilter.h"
-#include "WmiQuery.h"
+#include "DeviceQuery.h"
+#include "DiscoveryCache.h"
+#include "HealthMonitor.h"
+#include "MetricsRecorder.h"
+#include "RuntimeFileCache.h"
+#include "UsageSampler.h"
+#include "DiscoveryBackend.h"
+#include "StringProperty.h"
 
+#include <mutex>
+
+using std::map;
+using std::shared_ptr;
 using std::wstring;
 using std::wstring_view;
 using std::unique_ptr;
@@ -14,9 +26,10 @@ class DeviceDiscoveryImp
 {
 	public:
 		
-		DeviceDiscoveryImp() {}
+		DeviceDiscoveryImp(DiscoveryBackend backend);
 		const wchar_t* GetLastErrorMessage() const;
-		bool IsRefreshRequired();
+		void* GetRefreshEventHandle() const;
+		int IsRefreshRequired();
 		bool DiscoverDevices(DeviceFilter filter, bool includeIntegrated, bool includeDetachable);
 		int GetNumDevices();
 		long long GetDeviceAdapterLUID(unsigned int device);
@@ -26,6 +39,12 @@ class DeviceDiscoveryImp
 		const wchar_t* GetDeviceDriverStorePath(unsigned int device);
 		const wchar_t* GetDeviceLocationPath(unsigned int device);
 		const wchar_t* GetDeviceVendor(unsigned int device);
+		const wchar_t* GetDevicePcieRoot(unsigned int device);
+		int GetDeviceNumaNode(unsigned int device);
+		long long GetDeviceDriverVersion(unsigned int device);
+		int GetDeviceKmdModelVersion(unsigned int device);
+		long long GetDeviceDedicatedMemory(unsigned int device);
+		long long GetDeviceSharedMemory(unsigned int device);
 		int GetNumRuntimeFiles(unsigned int device);
 		const wchar_t* GetRuntimeFileSource(unsigned int device, unsigned int file);
 		const wchar_t* GetRuntimeFileDestination(unsigned int device, unsigned int file);
@@ -36,16 +55,43 @@ class DeviceDiscoveryImp
 		int IsDeviceDetachable(unsigned int device);
 		int DoesDeviceSupportDisplay(unsigned int device);
 		int DoesDeviceSupportCompute(unsigned int device);
+		const wchar_t* GetDeviceString(unsigned int device, DeviceStringProperty property, unsigned int* length);
+		const wchar_t* GetRuntimeFileString(unsigned int device, unsigned int file, RuntimeFileStringProperty property, unsigned int* length);
+		int GetSnapshot(void* buffer, unsigned int size);
+		int SetCacheFile(const wchar_t* path);
+		int GetMetrics(DiscoveryMetricsRecord* records, unsigned int count);
+		int GetDeviceUsage(DeviceUsageRecord* records, unsigned int count);
+		int CheckDeviceHealth(DeviceHealthRecord* records, unsigned int count);
+		shared_ptr<const DeviceList>* AcquireSnapshot();
+		shared_ptr<const DeviceList>* AcquireFilteredSnapshot(DeviceFilter filter, bool includeIntegrated, bool includeDetachable);
 		
 	private:
 		
+		shared_ptr<const DeviceList> CurrentList() const;
 		bool HaveDevices() const;
 		void SetLastErrorMessage(wstring_view message);
-		void ValidateRequestedDevice(unsigned int device);
+		shared_ptr<const DeviceList> ValidateRequestedDevice(unsigned int device) const;
+		
+		// The most recently published device list, which is only ever accessed via the atomic shared_ptr functions
+		shared_ptr<const DeviceList> current;
 		
-		vector<Device> devices;
-		wstring lastError;
+		// The error message for the last operation performed by the calling thread
+		static thread_local wstring lastError;
 		
+		// Serialises device discovery operations, and sampling operations that update per-device state, against other calls that do the same
+		std::mutex discoveryMutex;
+		std::mutex samplingMutex;
+		
+		DiscoveryBackend backend;
+		wil::unique_event_nothrow refreshEvent;
+		MetricsRecorder metrics;
+		UsageSampler usage;
+		HealthMonitor health;
 		unique_ptr<AdapterEnumeration> enumeration;
-		unique_ptr<WmiQuery> wmi;
+		unique_ptr<DeviceQuery> deviceQuery;
+		RuntimeFileCache runtimeFiles;
+		
+		unique_ptr<DiscoveryCache> cache;
+		bool cacheConsulted = false;
+		bool revalidationRequired = false;
 };
@@ -0,0 +1,16 @@
+#pragma once
+
+#include "Device.h"
+
+using std::vector;
+
+// An immutable device list produced by a single device discovery operation
+// (Lists are shared between the DeviceDiscovery instance and any snapshot handles acquired by clients, and are never modified once published)
+struct DeviceList
+{
+	// The discovered devices
+	vector<Device> Devices;
+	
+	// The serialised snapshot of the devices, in the format described in DeviceSnapshot.h
+	vector<uint8_t> Snapshot;
+};
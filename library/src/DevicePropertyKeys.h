@@ -0,0 +1,9 @@
+#pragma once
+
+#include <devpropdef.h>
+
+// Device property key for retrieving the DirectX adapter LUID
+const DEVPROPKEY DEVPKEY_Device_AdapterLuid = {
+	{ 0x60b193cb, 0x5276, 0x4d0f, { 0x96, 0xfc, 0xf1, 0x73, 0xab, 0xad, 0x3e, 0xc6 } },
+	2
+};
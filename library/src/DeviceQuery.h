@@ -0,0 +1,18 @@
+#pragma once
+
+#include "Adapter.h"
+#include "Device.h"
+
+using std::map;
+using std::vector;
+
+// Interface for backends that retrieve the details of the underlying PnP devices associated with DirectX adapters
+class DeviceQuery
+{
+	public:
+		
+		virtual ~DeviceQuery() {}
+		
+		// Retrieves the device details for the underlying PnP devices associated with the supplied DirectX adapters
+		virtual vector<Device> GetDevicesForAdapters(const map<int64_t, Adapter>& adapters) = 0;
+};
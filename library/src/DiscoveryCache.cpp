@@ -0,0 +1,203 @@
+#include "DiscoveryCache.h"
+#include "ErrorHandling.h"
+#include "ObjectHelpers.h"
+#include "SnapshotSerialiser.h"
+
+// Cache files use the following layout, with all integers stored in little-endian byte order and no padding between fields:
+// 
+// Header:
+// - uint32 magic (CacheMagic)
+// - uint32 version (CacheVersion)
+// - uint32 total size of the file in bytes, including the header
+// - uint32 number of entries
+// 
+// Each entry:
+// - uint32 PnP vendor ID, device ID, subsystem ID and revision of the adapter
+// - uint64 driver version of the adapter
+// - the device details, serialised using the per-device format described in DeviceSnapshot.h
+namespace
+{
+	// The magic number at the start of every cache file (the ASCII characters "DXDC" when read as little-endian bytes)
+	const uint32_t CacheMagic = 0x43445844;
+	
+	// The version number of the cache file format, which must be incremented whenever the format or the snapshot format changes
+	const uint32_t CacheVersion = 3;
+	
+	// The size of the fixed header at the start of a cache file, in bytes
+	const size_t CacheHeaderSize = 16;
+	
+	// The size of the fixed adapter details at the start of each cache entry, in bytes
+	const size_t CacheEntryHeaderSize = (sizeof(uint32_t) * 4) + sizeof(uint64_t);
+}
+
+DiscoveryCache::DiscoveryCache(const wstring& path) : path(path)
+{}
+
+map<int64_t, Device> DiscoveryCache::Load()
+{
+	// Attempt to open the cache file
+	wil::unique_hfile file(CreateFileW(this->path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr));
+	if (!file)
+	{
+		LOG(L"Discovery cache file could not be opened, ignoring: {}", this->path);
+		return {};
+	}
+	
+	// Ignore files that are too small to contain a header
+	LARGE_INTEGER size;
+	if (!GetFileSizeEx(file.get(), &size) || size.QuadPart < 0 || static_cast<ULONGLONG>(size.QuadPart) < CacheHeaderSize)
+	{
+		LOG(L"Discovery cache file is empty or truncated, ignoring: {}", this->path);
+		return {};
+	}
+	
+	// Map the file into memory so we can parse it in place without copying its contents
+	wil::unique_handle mapping(CreateFileMappingW(file.get(), nullptr, PAGE_READONLY, 0, 0, nullptr));
+	if (!mapping)
+	{
+		LOG(L"Failed to create file mapping for discovery cache file: {}", CheckWin32(GetLastError()).message);
+		return {};
+	}
+	wil::unique_mapview_ptr<uint8_t> view(reinterpret_cast<uint8_t*>(MapViewOfFile(mapping.get(), FILE_MAP_READ, 0, 0, 0)));
+	if (!view)
+	{
+		LOG(L"Failed to map view of discovery cache file: {}", CheckWin32(GetLastError()).message);
+		return {};
+	}
+	
+	// Parse the cache entries
+	try
+	{
+		size_t fileSize = static_cast<size_t>(size.QuadPart);
+		map<int64_t, Device> devices = this->Parse(view.get(), fileSize);
+		this->contents.assign(view.get(), view.get() + fileSize);
+		LOG(L"Loaded discovery cache entries for adapter LUIDs: {}", FMT(ObjectHelpers::GetMappingKeys(devices)));
+		return devices;
+	}
+	catch (const DeviceDiscoveryError& err)
+	{
+		LOG(L"Discovery cache file is invalid, ignoring: {}", err.Pretty());
+		return {};
+	}
+}
+
+void DiscoveryCache::Save(const vector<Device>& devices)
+{
+	// Compute the total size of the cache file so we only need to allocate the buffer once
+	size_t totalSize = CacheHeaderSize;
+	for (auto const& device : devices) {
+		totalSize += CacheEntryHeaderSize + SnapshotSerialiser::DeviceSize(device);
+	}
+	
+	// Write the header
+	vector<uint8_t> buffer;
+	buffer.reserve(totalSize);
+	SnapshotSerialiser::AppendInteger<uint32_t>(buffer, CacheMagic);
+	SnapshotSerialiser::AppendInteger<uint32_t>(buffer, CacheVersion);
+	SnapshotSerialiser::AppendInteger<uint32_t>(buffer, static_cast<uint32_t>(totalSize));
+	SnapshotSerialiser::AppendInteger<uint32_t>(buffer, static_cast<uint32_t>(devices.size()));
+	
+	// Write an entry for each device
+	for (auto const& device : devices)
+	{
+		const Adapter& adapter = device.DeviceAdapter;
+		SnapshotSerialiser::AppendInteger<uint32_t>(buffer, adapter.HardwareID.vendorID);
+		SnapshotSerialiser::AppendInteger<uint32_t>(buffer, adapter.HardwareID.deviceID);
+		SnapshotSerialiser::AppendInteger<uint32_t>(buffer, adapter.HardwareID.subSysID);
+		SnapshotSerialiser::AppendInteger<uint32_t>(buffer, adapter.HardwareID.revision);
+		SnapshotSerialiser::AppendInteger<uint64_t>(buffer, adapter.DriverVersion);
+		SnapshotSerialiser::AppendDevice(buffer, device);
+	}
+	
+	// Don't rewrite the cache file if its contents would be unchanged, since most discovery operations find exactly the same devices
+	if (buffer == this->contents)
+	{
+		LOG(L"Discovery cache entries are unchanged, not rewriting {}", this->path);
+		return;
+	}
+	
+	// Write the data to a temporary file, so readers never observe a partially-written cache file
+	wstring temporaryPath = this->path + L".tmp";
+	wil::unique_hfile file(CreateFileW(temporaryPath.c_str(), GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr));
+	if (!file)
+	{
+		LOG(L"Failed to create temporary discovery cache file {}: {}", temporaryPath, CheckWin32(GetLastError()).message);
+		return;
+	}
+	DWORD bytesWritten = 0;
+	if (!WriteFile(file.get(), buffer.data(), static_cast<DWORD>(buffer.size()), &bytesWritten, nullptr) || bytesWritten != buffer.size())
+	{
+		LOG(L"Failed to write temporary discovery cache file {}: {}", temporaryPath, CheckWin32(GetLastError()).message);
+		file.reset();
+		DeleteFileW(temporaryPath.c_str());
+		return;
+	}
+	file.reset();
+	
+	// Replace the existing cache file with the temporary file
+	if (!MoveFileExW(temporaryPath.c_str(), this->path.c_str(), MOVEFILE_REPLACE_EXISTING))
+	{
+		LOG(L"Failed to replace discovery cache file {}: {}", this->path, CheckWin32(GetLastError()).message);
+		DeleteFileW(temporaryPath.c_str());
+		return;
+	}
+	
+	this->contents = std::move(buffer);
+	LOG(L"Saved discovery cache entries for {} devices to {}", devices.size(), this->path);
+}
+
+bool DiscoveryCache::IsValidFor(const Device& cached, const Adapter& adapter)
+{
+	// Verify that the adapter's hardware and driver are identical to those of the cached adapter
+	const Adapter& cachedAdapter = cached.DeviceAdapter;
+	if (cachedAdapter.InstanceLuid != adapter.InstanceLuid ||
+	    cachedAdapter.HardwareID.vendorID != adapter.HardwareID.vendorID ||
+	    cachedAdapter.HardwareID.deviceID != adapter.HardwareID.deviceID ||
+	    cachedAdapter.HardwareID.subSysID != adapter.HardwareID.subSysID ||
+	    cachedAdapter.HardwareID.revision != adapter.HardwareID.revision ||
+	    cachedAdapter.DriverVersion != adapter.DriverVersion) {
+		return false;
+	}
+	
+	// Verify that the cached driver store directory still exists
+	std::error_code error;
+	return !cached.DriverStorePath.empty() && std::filesystem::is_directory(cached.DriverStorePath, error);
+}
+
+map<int64_t, Device> DiscoveryCache::Parse(const uint8_t* data, size_t size) const
+{
+	// Validate the header fields
+	SnapshotReader reader(data, size);
+	uint32_t magic = reader.ReadInteger<uint32_t>();
+	uint32_t version = reader.ReadInteger<uint32_t>();
+	uint32_t totalSize = reader.ReadInteger<uint32_t>();
+	uint32_t numEntries = reader.ReadInteger<uint32_t>();
+	if (magic != CacheMagic) {
+		throw CreateError(L"invalid magic number");
+	}
+	if (version != CacheVersion) {
+		throw CreateError(L"unsupported cache file version " + std::to_wstring(version));
+	}
+	if (totalSize != size) {
+		throw CreateError(L"file size does not match the size specified in the header");
+	}
+	
+	// Parse each of the entries
+	map<int64_t, Device> devices;
+	for (uint32_t index = 0; index < numEntries; ++index)
+	{
+		DXCoreHardwareID hardwareID;
+		hardwareID.vendorID = reader.ReadInteger<uint32_t>();
+		hardwareID.deviceID = reader.ReadInteger<uint32_t>();
+		hardwareID.subSysID = reader.ReadInteger<uint32_t>();
+		hardwareID.revision = reader.ReadInteger<uint32_t>();
+		uint64_t driverVersion = reader.ReadInteger<uint64_t>();
+		
+		Device device = reader.ReadDevice();
+		device.DeviceAdapter.HardwareID = hardwareID;
+		device.DeviceAdapter.DriverVersion = driverVersion;
+		devices.insert(std::make_pair(device.DeviceAdapter.InstanceLuid, std::move(device)));
+	}
+	
+	return devices;
+}
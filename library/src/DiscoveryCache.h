@@ -0,0 +1,37 @@
+#pragma once
+
+#include "Device.h"
+
+using std::map;
+using std::vector;
+using std::wstring;
+
+// Persists the details of discovered devices to a file on disk, so they can be reused when the library is next loaded
+// (Cached details are only considered valid for adapters with an identical LUID, PnP hardware ID and driver version)
+class DiscoveryCache
+{
+	public:
+		DiscoveryCache(const wstring& path);
+		
+		// Loads the cached device details from the cache file, keyed by adapter LUID
+		// (Returns an empty map if the cache file does not exist or is invalid)
+		map<int64_t, Device> Load();
+		
+		// Replaces the contents of the cache file with the supplied device details, unless they are identical to the contents we last loaded or saved
+		// (Failures are logged but not reported, since the cache is purely an optimisation)
+		void Save(const vector<Device>& devices);
+		
+		// Determines whether cached device details are still valid for the specified live adapter
+		static bool IsValidFor(const Device& cached, const Adapter& adapter);
+		
+	private:
+		
+		// Parses the contents of a cache file
+		map<int64_t, Device> Parse(const uint8_t* data, size_t size) const;
+		
+		// The path to the cache file
+		wstring path;
+		
+		// The contents of the cache file when we last loaded or saved it, so we can avoid rewriting it when nothing has changed
+		vector<uint8_t> contents;
+};
@@ -1,9 +1,17 @@
+#include "TraceLogging.h"
+
 BOOL APIENTRY DllMain(HINSTANCE hModule, DWORD dwReason, PVOID lpReserved)
 {
 	if (dwReason == DLL_PROCESS_ATTACH)
 	{
 		// Disable logging by default
 		spdlog::set_level(spdlog::level::off);
+		
+		// Register our TraceLogging provider so ETW sessions can capture our activity events
+		TraceLoggingRegister(DiscoveryTraceProvider);
+	}
+	else if (dwReason == DLL_PROCESS_DETACH) {
+		TraceLoggingUnregister(DiscoveryTraceProvider);
 	}
 	
 	return TRUE;
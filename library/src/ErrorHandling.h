@@ -15,14 +15,14 @@ using std::wstring_view;
 class DeviceDiscoveryError
 {
 	public:
-		inline DeviceDiscoveryError() : message(L""), file(L""), function(L""), line(0) {}
+		inline DeviceDiscoveryError() : message(L""), file(L""), function(L""), line(0), code(S_OK) {}
 		
-		inline DeviceDiscoveryError(wstring_view message, wstring_view file, wstring_view function, size_t line) :
-			message(message), file(file), function(function), line(line)
+		inline DeviceDiscoveryError(wstring_view message, wstring_view file, wstring_view function, size_t line, HRESULT code = S_OK) :
+			message(message), file(file), function(function), line(line), code(code)
 		{}
 		
 		inline DeviceDiscoveryError(wstring_view message, const DeviceDiscoveryError& inner) :
-			file(inner.file), function(inner.function), line(inner.line)
+			file(inner.file), function(inner.function), line(inner.line), code(inner.code)
 		{
 			this->message = wstring(message) + L": " + inner.message;
 		}
@@ -56,6 +56,9 @@ class DeviceDiscoveryError
 		wstring file;
 		wstring function;
 		size_t line;
+		
+		// The HRESULT for errors that were created from a Win32 error code or an HRESULT, or S_OK for all other errors
+		HRESULT code;
 };
 
 
@@ -74,7 +77,7 @@ namespace ErrorHandling
 			return DeviceDiscoveryError(L"", file, function, line);
 		}
 		catch (const winrt::hresult_error& err) {
-			return DeviceDiscoveryError(err.message(), file, function, line);
+			return DeviceDiscoveryError(err.message(), file, function, line, err.code());
 		}
 	}
 	
@@ -88,15 +91,33 @@ namespace ErrorHandling
 			return DeviceDiscoveryError(L"", file, function, line);
 		}
 		catch (const winrt::hresult_error& err) {
-			return DeviceDiscoveryError(err.message(), file, function, line);
+			return DeviceDiscoveryError(err.message(), file, function, line, err.code());
 		}
 	}
 	
+	// Returns an error object representing the supplied PnP Configuration Manager status code
+	inline DeviceDiscoveryError ErrorForConfigRet(CONFIGRET result, wstring_view file, wstring_view function, size_t line)
+	{
+		if (result != CR_SUCCESS)
+		{
+			return DeviceDiscoveryError(
+				ErrorForWin32(CM_MapCrToWin32Err(result, ERROR_GEN_FAILURE), file, function, line).message +
+					fmt::format(L" (CONFIGRET 0x{:0>8X})", static_cast<uint32_t>(result)),
+				file,
+				function,
+				line
+			);
+		}
+		
+		return DeviceDiscoveryError(L"", file, function, line);
+	}
+	
 	// Convenience macros for automatically filling out error file, function and line details
 	#define CreateError(message) DeviceDiscoveryError(message, __WFILE__, __WFUNCTION__, __LINE__)
 	#define CheckNtStatus(status) ErrorHandling::ErrorForNtStatus(status, __WFILE__, __WFUNCTION__, __LINE__)
 	#define CheckHresult(status) ErrorHandling::ErrorForHresult(status, __WFILE__, __WFUNCTION__, __LINE__)
 	#define CheckWin32(status) ErrorHandling::ErrorForWin32(status, __WFILE__, __WFUNCTION__, __LINE__)
+	#define CheckConfigRet(status) ErrorHandling::ErrorForConfigRet(status, __WFILE__, __WFUNCTION__, __LINE__)
 	
 	// Catches a winrt::hresult_error object and converts it to a DeviceDiscoveryError object
 	#define CatchHresult(error, operation) try { operation; error = DeviceDiscoveryError(); } catch (const winrt::hresult_error & err) { error = CreateError(err.message()); }
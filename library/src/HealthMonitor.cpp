@@ -0,0 +1,75 @@
+#include "HealthMonitor.h"
+#include "D3DHelpers.h"
+#include "ErrorHandling.h"
+#include "ObjectHelpers.h"
+
+vector<DeviceHealthRecord> HealthMonitor::CheckHealth(const vector<Device>& devices)
+{
+	// Check each device in turn, carrying over only the reset counts for devices that are still present
+	vector<DeviceHealthRecord> records;
+	map<int64_t, ULONG> current;
+	for (auto const& device : devices)
+	{
+		int64_t luid = device.DeviceAdapter.InstanceLuid;
+		auto previous = this->resetCounts.find(luid);
+		DeviceHealthRecord record = HealthMonitor::CheckDevice(luid, (previous != this->resetCounts.end()) ? &previous->second : nullptr);
+		
+		// Log any unhealthy devices
+		if (record.Health != DEVICEHEALTH_HEALTHY) {
+			LOG(L"Health check for adapter LUID {} reported {}", luid, DeviceHealthName(static_cast<DeviceHealth>(record.Health)));
+		}
+		
+		// Only update the reset count if we were able to query it, so that resets are still detected once a removed adapter reappears
+		if (record.Health != DEVICEHEALTH_REMOVED) {
+			current[luid] = record.ResetCount;
+		}
+		else if (previous != this->resetCounts.end()) {
+			current[luid] = previous->second;
+		}
+		
+		records.push_back(record);
+	}
+	
+	this->resetCounts = std::move(current);
+	return records;
+}
+
+DeviceHealthRecord HealthMonitor::CheckDevice(int64_t luid, const ULONG* previousResets)
+{
+	DeviceHealthRecord record = {};
+	record.AdapterLuid = luid;
+	record.Health = DEVICEHEALTH_HEALTHY;
+	
+	// Attempt to open the DirectX adapter for the device, treating failure as an indication that the device has been removed
+	auto adapterDetails = ObjectHelpers::GetZeroedStruct<D3DKMT_OPENADAPTERFROMLUID>();
+	adapterDetails.AdapterLuid = LuidFromInt64(luid);
+	if (CheckNtStatus(D3DKMTOpenAdapterFromLuid(&adapterDetails)))
+	{
+		record.Health = DEVICEHEALTH_REMOVED;
+		record.ResetCount = (previousResets != nullptr) ? *previousResets : 0;
+		return record;
+	}
+	
+	// Ensure we automatically close the adapter handle when we finish
+	unique_adapter_handle adapter(adapterDetails.hAdapter);
+	
+	// Retrieve the number of TDR driver resets that have been detected for the adapter
+	auto statistics = ObjectHelpers::GetZeroedStruct<D3DKMT_QUERYSTATISTICS>();
+	statistics.Type = D3DKMT_QUERYSTATISTICS_ADAPTER;
+	statistics.AdapterLuid = adapterDetails.AdapterLuid;
+	if (CheckNtStatus(D3DKMTQueryStatistics(&statistics)))
+	{
+		// An adapter that can be opened but not queried is in the process of being reset or removed
+		record.Health = DEVICEHEALTH_RESET;
+		record.ResetCount = (previousResets != nullptr) ? *previousResets : 0;
+		return record;
+	}
+	
+	// Report a reset if the count has increased since the previous health check
+	record.ResetCount = statistics.QueryResult.AdapterInformation.TdrDetectedCount;
+	if (previousResets != nullptr && record.ResetCount != *previousResets) {
+		record.Health = DEVICEHEALTH_RESET;
+	}
+	
+	return record;
+}
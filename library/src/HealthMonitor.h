@@ -0,0 +1,24 @@
+#pragma once
+
+#include "Device.h"
+#include "DeviceHealth.h"
+
+using std::map;
+using std::vector;
+
+// Checks the health of devices by opening their adapters and monitoring their TDR driver reset counts
+class HealthMonitor
+{
+	public:
+		
+		// Checks the health of each of the supplied devices, returning a record for every device
+		vector<DeviceHealthRecord> CheckHealth(const vector<Device>& devices);
+		
+	private:
+		
+		// Checks the health of an individual device, given the reset count from its previous health check (if any)
+		static DeviceHealthRecord CheckDevice(int64_t luid, const ULONG* previousResets);
+		
+		// The reset count from the previous health check of each device, keyed by adapter LUID
+		map<int64_t, ULONG> resetCounts;
+};
@@ -0,0 +1,131 @@
+#include "LogBuffer.h"
+
+#include <algorithm>
+#include <cstring>
+#include <spdlog/pattern_formatter.h>
+
+namespace
+{
+	// The pattern for structured log messages, which consist of tab-separated timestamp, level, source location, function and message fields
+	const char* StructuredPattern = "%Y-%m-%dT%T.%e%z\t%l\t%s:%#\t%!\t%v";
+	
+	// Each structured message is terminated by a NUL character rather than a newline, since messages may contain newlines
+	const char* StructuredTerminator = "\0";
+	
+	// The sink for our ring buffer, if it has been enabled (this is only ever accessed via the atomic shared_ptr functions)
+	std::shared_ptr<LogBufferSink> activeSink;
+}
+
+LogBufferSink::LogBufferSink(size_t capacity) : capacity(std::max<size_t>(capacity, 1)), oldest(0), count(0), dropped(0) {
+	this->messages.reserve(this->capacity);
+}
+
+size_t LogBufferSink::Drain(char* buffer, size_t size)
+{
+	std::lock_guard<std::mutex> lock(this->mutex_);
+	size_t offset = 0;
+	
+	// Report how many messages were dropped since the last drain operation, if any
+	if (this->dropped > 0)
+	{
+		spdlog::memory_buf_t formatted;
+		fmt::format_to(std::back_inserter(formatted), "\t{}\t\t\t{} log messages were overwritten before they could be drained", spdlog::level::to_string_view(spdlog::level::warn), this->dropped);
+		formatted.push_back('\0');
+		if (!LogBufferSink::CopyMessage(formatted, buffer, size, offset, true)) {
+			return offset;
+		}
+		this->dropped = 0;
+	}
+	
+	// Copy the oldest messages until we run out of messages or space, always copying at least one message so an oversized message cannot stall the buffer
+	while (this->count > 0)
+	{
+		spdlog::memory_buf_t formatted;
+		this->formatter_->format(this->messages[this->oldest], formatted);
+		if (!LogBufferSink::CopyMessage(formatted, buffer, size, offset, offset == 0)) {
+			break;
+		}
+		
+		this->oldest = (this->oldest + 1) % this->capacity;
+		this->count--;
+	}
+	
+	return offset;
+}
+
+void LogBufferSink::sink_it_(const spdlog::details::log_msg& message)
+{
+	// If the buffer has not yet reached capacity then append the message
+	if (this->messages.size() < this->capacity)
+	{
+		this->messages.emplace_back(message);
+		this->count++;
+		return;
+	}
+	
+	// Store the message in the next free slot, overwriting the oldest message if the buffer is full
+	size_t slot = (this->oldest + this->count) % this->capacity;
+	this->messages[slot] = spdlog::details::log_msg_buffer(message);
+	if (this->count < this->capacity) {
+		this->count++;
+	}
+	else
+	{
+		this->oldest = (this->oldest + 1) % this->capacity;
+		this->dropped++;
+	}
+}
+
+void LogBufferSink::flush_()
+{}
+
+bool LogBufferSink::CopyMessage(const spdlog::memory_buf_t& formatted, char* buffer, size_t size, size_t& offset, bool truncate)
+{
+	// If the message does not fit then only copy it if truncation was requested, retaining space for its NUL terminator
+	size_t length = formatted.size();
+	if (offset + length > size)
+	{
+		if (!truncate || offset >= size) {
+			return false;
+		}
+		
+		length = size - offset;
+		memcpy(buffer + offset, formatted.data(), length - 1);
+		buffer[offset + length - 1] = '\0';
+		offset += length;
+		return true;
+	}
+	
+	memcpy(buffer + offset, formatted.data(), length);
+	offset += length;
+	return true;
+}
+
+void LogBuffer::Enable(size_t capacity)
+{
+	// Create the sink for our ring buffer, using the structured format for messages
+	auto sink = std::make_shared<LogBufferSink>(capacity);
+	sink->set_formatter(std::make_unique<spdlog::pattern_formatter>(
+		StructuredPattern,
+		spdlog::pattern_time_type::local,
+		std::string(StructuredTerminator, 1)
+	));
+	
+	// Replace the default logger with one that writes only to our ring buffer, without flushing after each message
+	auto logger = std::make_shared<spdlog::logger>("directx-device-discovery", sink);
+	logger->set_level(spdlog::level::info);
+	spdlog::set_default_logger(logger);
+	std::atomic_store(&activeSink, sink);
+}
+
+int LogBuffer::Drain(char* buffer, size_t size)
+{
+	// Verify that the ring buffer has been enabled
+	auto sink = std::atomic_load(&activeSink);
+	if (!sink) {
+		return -1;
+	}
+	
+	// Drain as many messages as will fit, treating a NULL buffer as having no space
+	return static_cast<int>(sink->Drain(buffer, (buffer != nullptr) ? size : 0));
+}
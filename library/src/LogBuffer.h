@@ -0,0 +1,47 @@
+#pragma once
+
+#include <spdlog/details/log_msg_buffer.h>
+#include <spdlog/sinks/base_sink.h>
+#include <mutex>
+
+using std::vector;
+
+// An spdlog sink that retains log messages in a fixed-capacity in-memory ring buffer until they are drained by the host process
+// (When the buffer is full the oldest messages are overwritten, so logging never performs I/O, never blocks on a reader and never grows without bound)
+class LogBufferSink : public spdlog::sinks::base_sink<std::mutex>
+{
+	public:
+		LogBufferSink(size_t capacity);
+		
+		// Formats and removes as many of the oldest buffered messages as will fit in the supplied buffer, returning the number of bytes written
+		// (Each message is terminated by a NUL character, and a message that is larger than the entire buffer is truncated rather than retained forever)
+		size_t Drain(char* buffer, size_t size);
+		
+	protected:
+		void sink_it_(const spdlog::details::log_msg& message) override;
+		void flush_() override;
+		
+	private:
+		
+		// Copies a formatted message into the output buffer if it fits, returning false if it does not
+		static bool CopyMessage(const spdlog::memory_buf_t& formatted, char* buffer, size_t size, size_t& offset, bool truncate);
+		
+		// The buffered messages, which are stored in a circular fashion starting at the index of the oldest message
+		vector<spdlog::details::log_msg_buffer> messages;
+		size_t capacity;
+		size_t oldest;
+		size_t count;
+		
+		// The number of messages that have been overwritten before they could be drained since the last drain operation
+		size_t dropped;
+};
+
+// Provides functionality for routing the library's log output to an in-memory ring buffer
+namespace LogBuffer
+{
+	// Replaces the default logger with one that writes structured messages to a ring buffer with the specified capacity
+	void Enable(size_t capacity);
+	
+	// Drains buffered messages into the supplied buffer, returning the number of bytes written, or -1 if the ring buffer has not been enabled
+	int Drain(char* buffer, size_t size);
+}
@@ -0,0 +1,70 @@
+#include "MetricsRecorder.h"
+
+#include <algorithm>
+
+void MetricsRecorder::Record(DiscoveryPhase phase, nanoseconds duration, int64_t luid)
+{
+	std::lock_guard<std::mutex> lock(this->mutex);
+	
+	// Update the aggregated record for the phase
+	uint64_t durationNs = static_cast<uint64_t>(std::max<int64_t>(duration.count(), 0));
+	int phaseID = static_cast<int>(phase);
+	auto& aggregated = this->aggregated[phaseID];
+	aggregated.Phase = phaseID;
+	MetricsRecorder::AddTiming(aggregated, durationNs);
+	
+	// Update the per-device record for the phase if a device was specified
+	if (luid != 0)
+	{
+		auto& device = this->devices[luid][phaseID];
+		device.AdapterLuid = luid;
+		device.Phase = phaseID;
+		MetricsRecorder::AddTiming(device, durationNs);
+	}
+}
+
+void MetricsRecorder::RemoveDevice(int64_t luid)
+{
+	std::lock_guard<std::mutex> lock(this->mutex);
+	this->devices.erase(luid);
+}
+
+vector<DiscoveryMetricsRecord> MetricsRecorder::GetRecords() const
+{
+	std::lock_guard<std::mutex> lock(this->mutex);
+	
+	// Flatten our records, placing the aggregated records first
+	vector<DiscoveryMetricsRecord> flattened;
+	for (auto const& phase : this->aggregated) {
+		flattened.push_back(phase.second);
+	}
+	for (auto const& device : this->devices)
+	{
+		for (auto const& phase : device.second) {
+			flattened.push_back(phase.second);
+		}
+	}
+	
+	return flattened;
+}
+
+void MetricsRecorder::AddTiming(DiscoveryMetricsRecord& record, uint64_t duration)
+{
+	record.MinNanoseconds = (record.Count == 0) ? duration : std::min(record.MinNanoseconds, duration);
+	record.MaxNanoseconds = std::max(record.MaxNanoseconds, duration);
+	record.LastNanoseconds = duration;
+	record.TotalNanoseconds += duration;
+	record.Count++;
+}
+
+ScopedTimer::ScopedTimer(MetricsRecorder& metrics, DiscoveryPhase phase, int64_t luid) :
+	metrics(metrics), phase(phase), luid(luid), start(steady_clock::now())
+{}
+
+ScopedTimer::~ScopedTimer() {
+	this->metrics.Record(this->phase, std::chrono::duration_cast<nanoseconds>(steady_clock::now() - this->start), this->luid);
+}
+
+void ScopedTimer::SetAdapterLuid(int64_t luid) {
+	this->luid = luid;
+}
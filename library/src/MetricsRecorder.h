@@ -0,0 +1,61 @@
+#pragma once
+
+#include "DiscoveryMetrics.h"
+
+#include <chrono>
+#include <mutex>
+
+using std::map;
+using std::vector;
+using std::chrono::nanoseconds;
+using std::chrono::steady_clock;
+
+// Records timing metrics for each discovery phase, both aggregated across all devices and for individual devices
+// (All methods are thread-safe, since some phases are timed on worker threads)
+class MetricsRecorder
+{
+	public:
+		
+		// Records a timing for the specified phase, and also records it for the specified device if a non-zero adapter LUID is supplied
+		void Record(DiscoveryPhase phase, nanoseconds duration, int64_t luid = 0);
+		
+		// Discards the per-device metrics for the specified device (e.g. when the device is removed)
+		void RemoveDevice(int64_t luid);
+		
+		// Retrieves the metrics records for all phases, with aggregated records first and per-device records ordered by adapter LUID
+		vector<DiscoveryMetricsRecord> GetRecords() const;
+		
+	private:
+		
+		// Adds a timing to the specified record
+		static void AddTiming(DiscoveryMetricsRecord& record, uint64_t duration);
+		
+		// The aggregated metrics records, keyed by phase
+		map<int, DiscoveryMetricsRecord> aggregated;
+		
+		// The per-device metrics records, keyed by adapter LUID and then by phase
+		map< int64_t, map<int, DiscoveryMetricsRecord> > devices;
+		
+		// Protects our records from concurrent access
+		mutable std::mutex mutex;
+};
+
+// Times the scope in which it is declared and records the timing when it is destroyed
+class ScopedTimer
+{
+	public:
+		ScopedTimer(MetricsRecorder& metrics, DiscoveryPhase phase, int64_t luid = 0);
+		~ScopedTimer();
+		
+		ScopedTimer(const ScopedTimer& other) = delete;
+		ScopedTimer& operator=(const ScopedTimer& other) = delete;
+		
+		// Sets the adapter LUID of the device that the timing relates to, for phases where the LUID is not known until the phase completes
+		void SetAdapterLuid(int64_t luid);
+		
+	private:
+		MetricsRecorder& metrics;
+		DiscoveryPhase phase;
+		int64_t luid;
+		steady_clock::time_point start;
+};
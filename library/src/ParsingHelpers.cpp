@@ -0,0 +1,73 @@
+#include "ParsingHelpers.h"
+
+#include <cwchar>
+#include <limits>
+
+vector<wstring> ParsingHelpers::ExtractMultiStringValue(const wchar_t* data, size_t numBytes)
+{
+	vector<wstring> strings;
+	
+	// Count the strings up front so the list is allocated only once
+	size_t upperBound = numBytes / sizeof(wchar_t);
+	size_t numStrings = 0;
+	for (size_t offset = 0; offset < upperBound;)
+	{
+		// Determine the length of the next string without reading beyond the end of the data, and stop if it's empty
+		size_t length = wcsnlen(data + offset, upperBound - offset);
+		if (length == 0) { break; }
+		
+		numStrings++;
+		offset += length + 1;
+	}
+	strings.reserve(numStrings);
+	
+	// Construct each string in place, since the lengths have already been validated
+	size_t offset = 0;
+	for (size_t index = 0; index < numStrings; ++index)
+	{
+		size_t length = wcsnlen(data + offset, upperBound - offset);
+		strings.emplace_back(data + offset, length);
+		offset += length + 1;
+	}
+	
+	return strings;
+}
+
+int64_t ParsingHelpers::ParseLuidString(wstring_view value)
+{
+	// Skip any leading whitespace, as std::stoll did when LUIDs were parsed through an intermediate narrow string
+	size_t offset = 0;
+	while (offset < value.size() && iswspace(value[offset])) {
+		offset++;
+	}
+	
+	// Determine whether the value is negative (LUIDs with the high bit set are represented as signed values)
+	bool negative = false;
+	if (offset < value.size() && (value[offset] == L'-' || value[offset] == L'+'))
+	{
+		negative = (value[offset] == L'-');
+		offset++;
+	}
+	
+	// Accumulate the digits, ignoring any trailing characters and rejecting values that overflow a 64-bit integer
+	// (The magnitude is accumulated as an unsigned value so the minimum signed value can be represented)
+	uint64_t limit = negative ? (static_cast<uint64_t>(std::numeric_limits<int64_t>::max()) + 1) : std::numeric_limits<int64_t>::max();
+	uint64_t magnitude = 0;
+	size_t firstDigit = offset;
+	for (; offset < value.size() && value[offset] >= L'0' && value[offset] <= L'9'; ++offset)
+	{
+		uint64_t digit = value[offset] - L'0';
+		if (magnitude > (limit - digit) / 10) {
+			throw CreateError(L"LUID value is out of range for a 64-bit integer: " + wstring(value));
+		}
+		
+		magnitude = (magnitude * 10) + digit;
+	}
+	
+	// Verify that at least one digit was present
+	if (offset == firstDigit) {
+		throw CreateError(L"LUID value is not a decimal integer: " + wstring(value));
+	}
+	
+	return negative ? static_cast<int64_t>(0 - magnitude) : static_cast<int64_t>(magnitude);
+}
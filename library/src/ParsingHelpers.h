@@ -0,0 +1,19 @@
+#pragma once
+
+#include "ErrorHandling.h"
+
+using std::vector;
+using std::wstring;
+using std::wstring_view;
+
+// Provides functionality for parsing the raw string data returned by the registry, PnP Configuration Manager and WMI
+// (These functions have no dependencies on system state, so they can be exercised directly by the parser benchmark)
+namespace ParsingHelpers
+{
+	// Extracts the individual strings of a REG_MULTI_SZ registry value or a DEVPROP_TYPE_STRING_LIST device property
+	// (Parsing stops at the first empty string or at the end of the supplied data, even if the final string is not NUL-terminated)
+	vector<wstring> ExtractMultiStringValue(const wchar_t* data, size_t numBytes);
+	
+	// Parses the decimal string representation of an adapter LUID, as reported by WMI, throwing an error if it is malformed
+	int64_t ParseLuidString(wstring_view value);
+}
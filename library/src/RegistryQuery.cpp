@@ -2,6 +2,9 @@
 #include "D3DHelpers.h"
 #include "ErrorHandling.h"
 #include "ObjectHelpers.h"
+#include "ParsingHelpers.h"
+#include "ThreadingHelpers.h"
+#include "TraceLogging.h"
 
 #include <algorithm>
 #include <Windows.h>
@@ -11,26 +14,42 @@ map< wstring, vector<wstring> > RegistryQuery::EnumerateMultiStringValues(unique
 {
 	map< wstring, vector<wstring> > values;
 	
-	LSTATUS result = ERROR_SUCCESS;
-	for (int i = 0; ; ++i)
+	// Size our buffers up front to accommodate the longest value name and the largest value data under the key
+	DWORD maxNameLength = 0;
+	DWORD maxDataSize = 0;
+	auto error = CheckWin32(RegQueryInfoKeyW(key.get(), nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, &maxNameLength, &maxDataSize, nullptr, nullptr));
+	if (error) {
+		throw error.Wrap(L"RegQueryInfoKeyW failed");
+	}
+	
+	// Receives the name of each enumerated value (the maximum name length excludes the NUL terminator)
+	vector<wchar_t> valueName(maxNameLength + 1);
+	
+	// Receives the data of each enumerated value
+	vector<uint8_t> valueData(std::max<DWORD>(maxDataSize, sizeof(wchar_t)));
+	
+	DWORD index = 0;
+	while (true)
 	{
 		// Receives the type of the enumerated value
 		DWORD valueType = 0;
 		
-		// Receives the name of the enumerated value
-		DWORD nameBufsize = 256;
-		auto valueName = std::make_unique<wchar_t[]>(nameBufsize);
-		
-		// Receives the data of the enumerated value
-		DWORD dataBufsize = 1024;
-		auto valueData = std::make_unique<uint8_t[]>(dataBufsize);
-		
 		// Retrieve the next value and check to see if we have processed all available values
-		result = RegEnumValueW(key.get(), i, valueName.get(), &nameBufsize, nullptr, &valueType, valueData.get(), &dataBufsize);
+		DWORD nameLength = static_cast<DWORD>(valueName.size());
+		DWORD dataSize = static_cast<DWORD>(valueData.size());
+		LSTATUS result = RegEnumValueW(key.get(), index, valueName.data(), &nameLength, nullptr, &valueType, valueData.data(), &dataSize);
 		if (result == ERROR_NO_MORE_ITEMS) {
 			break;
 		}
 		
+		// If the value was modified after we sized our buffers then grow them and retry the same value
+		if (result == ERROR_MORE_DATA)
+		{
+			valueName.resize(valueName.size() * 2);
+			valueData.resize(std::max<size_t>(dataSize, valueData.size() * 2));
+			continue;
+		}
+		
 		// Report any errors
 		auto error = CheckWin32(result);
 		if (error) {
@@ -38,39 +57,20 @@ map< wstring, vector<wstring> > RegistryQuery::EnumerateMultiStringValues(unique
 		}
 		
 		// Verify that the value data is of type REG_MULTI_SZ
-		wstring name = wstring(valueName.get(), nameBufsize);
+		wstring name = wstring(valueName.data(), nameLength);
 		if (valueType != REG_MULTI_SZ) {
 			throw CreateError(L"enumerated value was not of type REG_MULTI_SZ: " + name);
 		}
 		
 		// Parse the value data and add it to our mapping
-		auto strings = RegistryQuery::ExtractMultiStringValue((wchar_t*)(valueData.get()), dataBufsize);
-		values.insert(std::make_pair(name, strings));
+		auto strings = ParsingHelpers::ExtractMultiStringValue(reinterpret_cast<const wchar_t*>(valueData.data()), dataSize);
+		values.insert(std::make_pair(std::move(name), std::move(strings)));
+		index++;
 	}
 	
 	return values;
 }
 
-vector<wstring> RegistryQuery::ExtractMultiStringValue(const wchar_t* data, size_t numBytes)
-{
-	vector<wstring> strings;
-	
-	size_t offset = 0;
-	size_t upperBound = numBytes / sizeof(wchar_t);
-	while (offset < upperBound)
-	{
-		// Extract the next string and check that it's not empty
-		wstring nextString(data + offset);
-		if (nextString.size() == 0) { break; }
-		
-		// Add the string to our list and proceed to the next one
-		strings.push_back(nextString);
-		offset += strings.back().size() + 1;
-	}
-	
-	return strings;
-}
-
 unique_hkey RegistryQuery::OpenKeyFromString(wstring_view key)
 {
 	// Our list of supported root keys
@@ -109,67 +109,75 @@ unique_hkey RegistryQuery::OpenKeyFromString(wstring_view key)
 	return keyHandle;
 }
 
-void RegistryQuery::ProcessRuntimeFiles(Device& device, wstring_view key, bool isWow64)
+vector<RuntimeFile> RegistryQuery::EnumerateRuntimeFiles(const Device& device, wstring_view key)
 {
+	vector<RuntimeFile> files;
+	TraceActivity activity("EnumerateRuntimeFiles", device.DeviceAdapter.InstanceLuid, device.ID, key);
+	
 	try
 	{
-		// Determine whether we are adding runtime files to the device's System32 list or SysWOW64 list
-		auto& list = (isWow64) ? device.RuntimeFilesWow64 : device.RuntimeFiles;
-		
 		// Attempt to open the specified registry key and enumerate its REG_MULTI_SZ values
 		unique_hkey registryKey = RegistryQuery::OpenKeyFromString(device.DriverRegistryKey + L"\\" + wstring(key));
-		auto files = RegistryQuery::EnumerateMultiStringValues(registryKey);
-		for (const auto& pair : files)
+		auto values = RegistryQuery::EnumerateMultiStringValues(registryKey);
+		for (const auto& pair : values)
 		{
-			if (!pair.second.empty())
-			{
-				// Construct a RuntimeFile from the string values
-				RuntimeFile newFile(pair.second[0], ((pair.second.size() == 2) ? pair.second[1] : L""));
-				
-				// Check whether the destination filename for the runtime file clashes with an existing file
-				auto existing = std::find_if(list.begin(), list.end(), [newFile](RuntimeFile f) {
-					return f.DestinationFilename == newFile.DestinationFilename;
-				});
-				
-				// Only add the new runtime file to the list if there's no clash
-				if (existing == list.end()) {
-					list.push_back(newFile);
-				}
-				else {
-					LOG(L"{}: ignoring runtime file with duplicate destination filename {}", key, newFile.DestinationFilename);
-				}
+			// Construct a RuntimeFile from the string values
+			if (!pair.second.empty()) {
+				files.emplace_back(pair.second[0], ((pair.second.size() == 2) ? pair.second[1] : L""));
 			}
 		}
 	}
-	catch (const DeviceDiscoveryError& err) {
+	catch (const DeviceDiscoveryError& err)
+	{
+		activity.SetError(err);
 		LOG(L"Could not enumerate runtime files for the {} key: {}", key, err.message);
 	}
+	
+	return files;
 }
 
-void RegistryQuery::FillDriverDetails(Device& device)
+void RegistryQuery::MergeRuntimeFiles(Device& device, vector<RuntimeFile>&& files, wstring_view key, bool isWow64)
 {
-	// Log the device ID to provide context for any subsequent log messages and errors
-	LOG(L"Querying device driver registry details for device {}", device.ID);
+	// Determine whether we are adding runtime files to the device's System32 list or SysWOW64 list
+	auto& list = (isWow64) ? device.RuntimeFilesWow64 : device.RuntimeFiles;
 	
-	// Attempt to open the DirectX adapter for the device
-	auto adapterDetails = ObjectHelpers::GetZeroedStruct<D3DKMT_OPENADAPTERFROMLUID>();
-	adapterDetails.AdapterLuid = LuidFromInt64(device.DeviceAdapter.InstanceLuid);
-	auto error = CheckNtStatus(D3DKMTOpenAdapterFromLuid(&adapterDetails));
-	if (error)
+	for (auto& newFile : files)
 	{
-		throw error.Wrap(
-			L"D3DKMTOpenAdapterFromLuid failed to open adapter with LUID " +
-			std::to_wstring(device.DeviceAdapter.InstanceLuid)
-		);
+		// Check whether the destination filename for the runtime file clashes with an existing file
+		auto existing = std::find_if(list.begin(), list.end(), [&newFile](const RuntimeFile& f) {
+			return f.DestinationFilename == newFile.DestinationFilename;
+		});
+		
+		// Only add the new runtime file to the list if there's no clash
+		if (existing == list.end()) {
+			list.push_back(std::move(newFile));
+		}
+		else {
+			LOG(L"{}: ignoring runtime file with duplicate destination filename {}", key, newFile.DestinationFilename);
+		}
 	}
+}
+
+void RegistryQuery::ProcessRuntimeFiles(Device& device, wstring_view key, bool isWow64) {
+	RegistryQuery::MergeRuntimeFiles(device, RegistryQuery::EnumerateRuntimeFiles(device, key), key, isWow64);
+}
+
+bool RegistryQuery::FillDriverStorePath(Device& device)
+{
+	// Log the device ID to provide context for any subsequent log messages and errors
+	LOG(L"Querying device driver registry details for device {}", device.ID);
 	
-	// Ensure we automatically close the adapter handle when we finish
-	unique_adapter_handle adapter(adapterDetails.hAdapter);
+	// Attempt to open the DirectX adapter for the device
+	// (The returned handle is closed automatically when we finish)
+	unique_adapter_handle adapter = OpenAdapterFromLuid(device.DeviceAdapter.InstanceLuid, device.ID);
 	
 	// Retrieve the path to the driver store directory for the adapter
 	QueryD3DRegistryInfo queryDriverStore;
 	queryDriverStore.SetFilesystemQuery(D3DDDI_QUERYREGISTRY_DRIVERSTOREPATH);
-	queryDriverStore.PerformQuery(adapter);
+	{
+		TraceActivity activity("PerformQuery", device.DeviceAdapter.InstanceLuid, device.ID, L"D3DDDI_QUERYREGISTRY_DRIVERSTOREPATH");
+		queryDriverStore.PerformQuery(adapter);
+	}
 	device.DriverStorePath = wstring(queryDriverStore.RegistryInfo->OutputString);
 	
 	// If the driver store path begins with the "\SystemRoot" prefix then expand it
@@ -185,14 +193,94 @@ void RegistryQuery::FillDriverDetails(Device& device)
 	{
 		// We have no way of enumerating the CopyToVmWhenNewer subkey inside a container, so stop processing here
 		LOG(L"Running inside a container, skipping runtime file enumeration");
-		return;
+		return false;
+	}
+	
+	return true;
+}
+
+void RegistryQuery::FillDriverDetails(Device& device)
+{
+	// Retrieve the driver store path and then retrieve the lists of additional runtime files for System32 and SysWOW64
+	if (RegistryQuery::FillDriverStorePath(device))
+	{
+		for (auto const& key : RuntimeFileKeys) {
+			RegistryQuery::ProcessRuntimeFiles(device, key.Name, key.IsWow64);
+		}
+	}
+}
+
+void RegistryQuery::FillDriverDetailsForDevices(vector<Device>& devices, MetricsRecorder& metrics, RuntimeFileCache& cache)
+{
+	// Retrieve the driver store path for each device in parallel, capturing any errors so they only affect the device that encountered them
+	vector<DeviceDiscoveryError> errors(devices.size());
+	vector<uint8_t> haveRuntimeFiles(devices.size(), 0);
+	vector<nanoseconds> durations(devices.size());
+	ThreadingHelpers::ParallelFor(devices.size(), [&](size_t index)
+	{
+		auto start = steady_clock::now();
+		try {
+			haveRuntimeFiles[index] = RegistryQuery::FillDriverStorePath(devices[index]);
+		}
+		catch (const DeviceDiscoveryError& err) {
+			errors[index] = err;
+		}
+		durations[index] = std::chrono::duration_cast<nanoseconds>(steady_clock::now() - start);
+	});
+	
+	// Make sure the runtime file cache is watching the driver registry key for each device before we read from it
+	vector<const Device*> cacheable;
+	for (size_t device = 0; device < devices.size(); ++device)
+	{
+		if (!errors[device] && haveRuntimeFiles[device]) {
+			cacheable.push_back(&devices[device]);
+		}
 	}
+	cache.Prepare(cacheable);
+	
+	// Enumerate each of the runtime file registry keys for each device in parallel, unless their runtime files are already cached
+	const size_t numKeys = std::size(RuntimeFileKeys);
+	vector< vector<RuntimeFile> > files(devices.size() * numKeys);
+	vector<nanoseconds> keyDurations(files.size());
+	ThreadingHelpers::ParallelFor(files.size(), [&](size_t index)
+	{
+		size_t device = index / numKeys;
+		if (!errors[device] && haveRuntimeFiles[device])
+		{
+			auto start = steady_clock::now();
+			const wchar_t* key = RuntimeFileKeys[index % numKeys].Name;
+			if (!cache.Lookup(devices[device], key, files[index]))
+			{
+				files[index] = RegistryQuery::EnumerateRuntimeFiles(devices[device], key);
+				cache.Store(devices[device], key, files[index]);
+			}
+			keyDurations[index] = std::chrono::duration_cast<nanoseconds>(steady_clock::now() - start);
+		}
+	});
 	
-	// Retrieve the list of additional runtime files that need to be copied to the System32 directory
-	RegistryQuery::ProcessRuntimeFiles(device, L"CopyToVmOverwrite", false);
-	RegistryQuery::ProcessRuntimeFiles(device, L"CopyToVmWhenNewer", false);
+	// Merge the runtime files for each device in key order, so the results are identical to those of serial processing
+	for (size_t device = 0; device < devices.size(); ++device)
+	{
+		for (size_t key = 0; key < numKeys; ++key)
+		{
+			RegistryQuery::MergeRuntimeFiles(devices[device], std::move(files[(device * numKeys) + key]), RuntimeFileKeys[key].Name, RuntimeFileKeys[key].IsWow64);
+			durations[device] += keyDurations[(device * numKeys) + key];
+		}
+		
+		// Record the total time spent retrieving the driver details for the device, irrespective of whether the work was performed concurrently
+		metrics.Record(DiscoveryPhase::DriverDetails, durations[device], devices[device].DeviceAdapter.InstanceLuid);
+	}
 	
-	// Retrieve the list of additional runtime files that need to be copied to the SysWOW64 directory
-	RegistryQuery::ProcessRuntimeFiles(device, L"CopyToVmOverwriteWow64", true);
-	RegistryQuery::ProcessRuntimeFiles(device, L"CopyToVmWhenNewerWow64", true);
+	// Discard any devices whose driver details could not be retrieved, rather than failing the entire discovery operation
+	size_t index = 0;
+	auto removed = std::remove_if(devices.begin(), devices.end(), [&errors, &index](const Device& device)
+	{
+		const DeviceDiscoveryError& error = errors[index++];
+		if (error) {
+			LOG(L"Ignoring device {} because its driver details could not be retrieved: {}", device.ID, error.Pretty());
+		}
+		
+		return static_cast<bool>(error);
+	});
+	devices.erase(removed, devices.end());
 }
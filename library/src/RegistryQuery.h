@@ -1,6 +1,8 @@
 #pragma once
 
 #include "Device.h"
+#include "MetricsRecorder.h"
+#include "RuntimeFileCache.h"
 
 using std::map;
 using std::vector;
@@ -14,15 +16,45 @@ namespace RegistryQuery
 	// Enumerates the values of the supplied registry key and parses their data as REG_MULTI_SZ
 	map< wstring, vector<wstring> > EnumerateMultiStringValues(unique_hkey& key);
 	
-	// Extracts the individual strings of a REG_MULTI_SZ registry value
-	vector<wstring> ExtractMultiStringValue(const wchar_t* data, size_t numBytes);
-	
 	// Parses a registry key path and opens it using the appropriate root key
 	unique_hkey OpenKeyFromString(wstring_view key);
 	
+	// Represents a registry key under a device's driver registry key that lists additional runtime files
+	struct RuntimeFileKey
+	{
+		// The name of the registry key
+		const wchar_t* Name;
+		
+		// Specifies whether the runtime files need to be copied to the SysWOW64 directory rather than the System32 directory
+		bool IsWow64;
+	};
+	
+	// The registry keys that list additional runtime files, in the order in which they are processed
+	inline const RuntimeFileKey RuntimeFileKeys[] =
+	{
+		{ L"CopyToVmOverwrite", false },
+		{ L"CopyToVmWhenNewer", false },
+		{ L"CopyToVmOverwriteWow64", true },
+		{ L"CopyToVmWhenNewerWow64", true }
+	};
+	
+	// Retrieves the runtime files for a device as listed under the specified registry key, returning an empty list if the key cannot be enumerated
+	vector<RuntimeFile> EnumerateRuntimeFiles(const Device& device, wstring_view key);
+	
+	// Merges the supplied runtime files into the device's System32 or SysWOW64 list, ignoring any files whose destination filenames clash with existing files
+	void MergeRuntimeFiles(Device& device, vector<RuntimeFile>&& files, wstring_view key, bool isWow64);
+	
 	// Enumerates the runtime files for a device as listed under the specified registry key
 	void ProcessRuntimeFiles(Device& device, wstring_view key, bool isWow64);
 	
+	// Retrieves the driver store path for the supplied PnP device, and returns false if runtime files cannot be enumerated (e.g. inside a container)
+	bool FillDriverStorePath(Device& device);
+	
 	// Queries the registry to retrieve driver-related details for the supplied PnP device
 	void FillDriverDetails(Device& device);
+	
+	// Queries the registry to retrieve driver-related details for the supplied PnP devices in parallel,
+	// removing any devices whose details cannot be retrieved rather than failing for the entire list
+	// (Runtime file lists are retrieved from the supplied cache where possible, and stored in it otherwise)
+	void FillDriverDetailsForDevices(vector<Device>& devices, MetricsRecorder& metrics, RuntimeFileCache& cache);
 }
@@ -0,0 +1,116 @@
+#include "RuntimeFileCache.h"
+#include "ErrorHandling.h"
+#include "RegistryQuery.h"
+
+void RuntimeFileCache::Prepare(const vector<const Device*>& devices)
+{
+	std::lock_guard<std::mutex> lock(this->mutex);
+	for (const Device* device : devices) {
+		this->PrepareEntry(*device);
+	}
+}
+
+void RuntimeFileCache::Prune(const vector<Device>& devices)
+{
+	std::lock_guard<std::mutex> lock(this->mutex);
+	
+	// Discard the entries for any driver registry keys that are no longer used by any of our devices
+	std::set<wstring> keys;
+	for (auto const& device : devices) {
+		keys.insert(device.DriverRegistryKey);
+	}
+	for (auto entry = this->entries.begin(); entry != this->entries.end();)
+	{
+		if (keys.count(entry->first) == 0)
+		{
+			LOG(L"Discarding cached runtime files for driver registry key {} since it no longer belongs to any device", entry->first);
+			entry = this->entries.erase(entry);
+		}
+		else {
+			++entry;
+		}
+	}
+}
+
+void RuntimeFileCache::PrepareEntry(const Device& device)
+{
+	// If we already have a valid entry for the driver registry key then there is nothing to do
+	auto existing = this->entries.find(device.DriverRegistryKey);
+	if (existing != this->entries.end())
+	{
+		if (RuntimeFileCache::IsValidFor(existing->second, device)) {
+			return;
+		}
+		
+		LOG(L"Discarding stale cached runtime files for driver registry key {}", device.DriverRegistryKey);
+		this->entries.erase(existing);
+	}
+	
+	try
+	{
+		// Open the driver registry key and register for notifications when it or any of its subkeys are modified
+		// (The notification is thread agnostic, since it is typically registered from a worker thread that exits before the next discovery operation)
+		Entry entry;
+		entry.DriverVersion = device.DeviceAdapter.DriverVersion;
+		entry.DriverStorePath = device.DriverStorePath;
+		entry.DriverKey = RegistryQuery::OpenKeyFromString(device.DriverRegistryKey);
+		if (!entry.Changed.try_create(wil::EventOptions::ManualReset, nullptr)) {
+			throw CreateError(L"failed to create change notification event");
+		}
+		
+		auto error = CheckWin32(RegNotifyChangeKeyValue(
+			entry.DriverKey.get(),
+			TRUE,
+			REG_NOTIFY_CHANGE_NAME | REG_NOTIFY_CHANGE_LAST_SET | REG_NOTIFY_THREAD_AGNOSTIC,
+			entry.Changed.get(),
+			TRUE
+		));
+		if (error) {
+			throw error.Wrap(L"RegNotifyChangeKeyValue failed");
+		}
+		
+		this->entries.insert(std::make_pair(device.DriverRegistryKey, std::move(entry)));
+	}
+	catch (const DeviceDiscoveryError& err) {
+		LOG(L"Could not cache runtime files for driver registry key {}: {}", device.DriverRegistryKey, err.message);
+	}
+}
+
+bool RuntimeFileCache::Lookup(const Device& device, wstring_view key, vector<RuntimeFile>& files)
+{
+	std::lock_guard<std::mutex> lock(this->mutex);
+	
+	// Verify that we have a valid entry for the driver registry key
+	auto entry = this->entries.find(device.DriverRegistryKey);
+	if (entry == this->entries.end() || !RuntimeFileCache::IsValidFor(entry->second, device)) {
+		return false;
+	}
+	
+	// Retrieve the cached runtime files for the specified key, if we have them
+	auto cached = entry->second.Files.find(key);
+	if (cached == entry->second.Files.end()) {
+		return false;
+	}
+	
+	files = cached->second;
+	return true;
+}
+
+void RuntimeFileCache::Store(const Device& device, wstring_view key, const vector<RuntimeFile>& files)
+{
+	std::lock_guard<std::mutex> lock(this->mutex);
+	
+	// Only store the runtime files if we have a valid entry that will notify us when they change
+	auto entry = this->entries.find(device.DriverRegistryKey);
+	if (entry != this->entries.end() && RuntimeFileCache::IsValidFor(entry->second, device)) {
+		entry->second.Files.insert_or_assign(wstring(key), files);
+	}
+}
+
+bool RuntimeFileCache::IsValidFor(const Entry& entry, const Device& device)
+{
+	return
+		entry.DriverVersion == device.DeviceAdapter.DriverVersion &&
+		entry.DriverStorePath == device.DriverStorePath &&
+		!entry.Changed.is_signaled();
+}
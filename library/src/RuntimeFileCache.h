@@ -0,0 +1,61 @@
+#pragma once
+
+#include "Device.h"
+
+#include <mutex>
+
+using std::map;
+using std::vector;
+using std::wstring;
+using std::wstring_view;
+using wil::unique_hkey;
+
+// Caches the runtime files listed under each driver registry key, so devices whose drivers have not changed don't need to re-enumerate them
+// (Entries are discarded when the driver version or driver store path changes, or when the driver registry key is modified)
+class RuntimeFileCache
+{
+	public:
+		
+		// Ensures we have a valid entry for each device's driver registry key, discarding any stale entries and registering for change notifications
+		// (This must be called before the runtime file keys are enumerated, so changes made during enumeration are not missed)
+		void Prepare(const vector<const Device*>& devices);
+		
+		// Discards the entries for any driver registry keys that are not used by the supplied devices, so the cache doesn't grow without bound
+		// (This must be called with the full device list produced by each discovery, including devices whose details were carried over)
+		void Prune(const vector<Device>& devices);
+		
+		// Retrieves the cached runtime files for the specified key under the device's driver registry key, returning false if none are cached
+		bool Lookup(const Device& device, wstring_view key, vector<RuntimeFile>& files);
+		
+		// Stores the runtime files for the specified key under the device's driver registry key, if we have a valid entry for it
+		void Store(const Device& device, wstring_view key, const vector<RuntimeFile>& files);
+		
+	private:
+		
+		// Represents the cached runtime files for a single driver registry key
+		struct Entry
+		{
+			// The driver version and driver store path that the cached runtime files are valid for
+			uint64_t DriverVersion = 0;
+			wstring DriverStorePath;
+			
+			// The open driver registry key and the event that is signalled when the key or any of its subkeys are modified
+			unique_hkey DriverKey;
+			wil::unique_event_nothrow Changed;
+			
+			// The cached runtime files, keyed by runtime file registry key name
+			map< wstring, vector<RuntimeFile>, std::less<> > Files;
+		};
+		
+		// Ensures we have a valid entry for a single device's driver registry key (our mutex must be held by the caller)
+		void PrepareEntry(const Device& device);
+		
+		// Determines whether an entry is still valid for the specified device
+		static bool IsValidFor(const Entry& entry, const Device& device);
+		
+		// Our cache entries, keyed by driver registry key
+		map<wstring, Entry> entries;
+		
+		// Serialises access to our entries, since runtime file keys are enumerated in parallel
+		std::mutex mutex;
+};
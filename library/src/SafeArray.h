@@ -54,6 +54,11 @@ class SafeArrayIterator
 			return this->reinterpretedArray + this->numElements;
 		}
 		
+		// Returns the number of elements in the array
+		size_t size() const {
+			return static_cast<size_t>(this->numElements);
+		}
+		
 	private:
 		SAFEARRAY* array;
 		T* reinterpretedArray;
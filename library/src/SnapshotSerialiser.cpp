@@ -0,0 +1,193 @@
+#include "SnapshotSerialiser.h"
+#include "DeviceSnapshot.h"
+#include "ErrorHandling.h"
+
+namespace
+{
+	// Appends a length-prefixed UTF-16 string to a snapshot buffer
+	void AppendString(vector<uint8_t>& buffer, const wstring& value)
+	{
+		SnapshotSerialiser::AppendInteger<uint32_t>(buffer, static_cast<uint32_t>(value.size()));
+		size_t offset = buffer.size();
+		size_t numBytes = value.size() * sizeof(wchar_t);
+		buffer.resize(offset + numBytes);
+		memcpy(buffer.data() + offset, value.data(), numBytes);
+	}
+	
+	// Appends a count-prefixed list of runtime files to a snapshot buffer
+	void AppendRuntimeFiles(vector<uint8_t>& buffer, const vector<RuntimeFile>& files)
+	{
+		SnapshotSerialiser::AppendInteger<uint32_t>(buffer, static_cast<uint32_t>(files.size()));
+		for (auto const& file : files)
+		{
+			AppendString(buffer, file.SourcePath);
+			AppendString(buffer, file.DestinationFilename);
+		}
+	}
+	
+	// Computes the serialised size of a length-prefixed UTF-16 string
+	size_t StringSize(const wstring& value) {
+		return sizeof(uint32_t) + (value.size() * sizeof(wchar_t));
+	}
+	
+	// Computes the serialised size of a count-prefixed list of runtime files
+	size_t RuntimeFilesSize(const vector<RuntimeFile>& files)
+	{
+		size_t size = sizeof(uint32_t);
+		for (auto const& file : files) {
+			size += StringSize(file.SourcePath) + StringSize(file.DestinationFilename);
+		}
+		
+		return size;
+	}
+	
+	// Computes the bit flags for the boolean properties of a device
+	uint32_t DeviceFlags(const Device& device)
+	{
+		const Adapter& adapter = device.DeviceAdapter;
+		return
+			(adapter.IsIntegrated ? DEVICESNAPSHOT_FLAG_INTEGRATED : 0) |
+			(adapter.IsDetachable ? DEVICESNAPSHOT_FLAG_DETACHABLE : 0) |
+			(adapter.SupportsDisplay ? DEVICESNAPSHOT_FLAG_SUPPORTS_DISPLAY : 0) |
+			(adapter.SupportsCompute ? DEVICESNAPSHOT_FLAG_SUPPORTS_COMPUTE : 0);
+	}
+}
+
+void SnapshotSerialiser::AppendDevice(vector<uint8_t>& buffer, const Device& device)
+{
+	AppendInteger<int64_t>(buffer, device.DeviceAdapter.InstanceLuid);
+	AppendInteger<uint32_t>(buffer, DeviceFlags(device));
+	AppendInteger<int32_t>(buffer, device.NumaNode);
+	AppendInteger<uint64_t>(buffer, device.DeviceAdapter.DriverVersion);
+	AppendInteger<uint64_t>(buffer, device.DeviceAdapter.DedicatedAdapterMemory);
+	AppendInteger<uint64_t>(buffer, device.DeviceAdapter.SharedSystemMemory);
+	AppendInteger<uint32_t>(buffer, device.DeviceAdapter.KmdModelVersion);
+	AppendString(buffer, device.ID);
+	AppendString(buffer, device.Description);
+	AppendString(buffer, device.DriverRegistryKey);
+	AppendString(buffer, device.DriverStorePath);
+	AppendString(buffer, device.LocationPath);
+	AppendString(buffer, device.Vendor);
+	AppendString(buffer, device.PcieRoot);
+	AppendRuntimeFiles(buffer, device.RuntimeFiles);
+	AppendRuntimeFiles(buffer, device.RuntimeFilesWow64);
+}
+
+size_t SnapshotSerialiser::DeviceSize(const Device& device)
+{
+	return sizeof(int64_t) + sizeof(uint32_t) + sizeof(int32_t) + (sizeof(uint64_t) * 3) + sizeof(uint32_t) +
+		StringSize(device.ID) +
+		StringSize(device.Description) +
+		StringSize(device.DriverRegistryKey) +
+		StringSize(device.DriverStorePath) +
+		StringSize(device.LocationPath) +
+		StringSize(device.Vendor) +
+		StringSize(device.PcieRoot) +
+		RuntimeFilesSize(device.RuntimeFiles) +
+		RuntimeFilesSize(device.RuntimeFilesWow64);
+}
+
+vector<uint8_t> SnapshotSerialiser::Serialise(const vector<Device>& devices)
+{
+	// Compute the total size of the snapshot so we only need to allocate the buffer once
+	size_t totalSize = DEVICESNAPSHOT_HEADER_SIZE;
+	for (auto const& device : devices) {
+		totalSize += DeviceSize(device);
+	}
+	
+	// Write the header
+	vector<uint8_t> buffer;
+	buffer.reserve(totalSize);
+	AppendInteger<uint32_t>(buffer, DEVICESNAPSHOT_MAGIC);
+	AppendInteger<uint32_t>(buffer, DEVICESNAPSHOT_VERSION);
+	AppendInteger<uint32_t>(buffer, static_cast<uint32_t>(totalSize));
+	AppendInteger<uint32_t>(buffer, static_cast<uint32_t>(devices.size()));
+	
+	// Write the details for each device
+	for (auto const& device : devices) {
+		AppendDevice(buffer, device);
+	}
+	
+	return buffer;
+}
+
+SnapshotReader::SnapshotReader(const uint8_t* data, size_t size) : data(data), size(size), offset(0)
+{}
+
+wstring SnapshotReader::ReadString()
+{
+	// Read the length of the string and verify that the buffer contains the full string
+	size_t length = this->ReadInteger<uint32_t>();
+	size_t numBytes = length * sizeof(wchar_t);
+	this->Require(numBytes);
+	
+	// Copy the string data
+	wstring value(length, L'\0');
+	memcpy(value.data(), this->data + this->offset, numBytes);
+	this->offset += numBytes;
+	return value;
+}
+
+Device SnapshotReader::ReadDevice()
+{
+	Device device;
+	
+	// Read the adapter LUID and the boolean properties of the adapter
+	device.DeviceAdapter.InstanceLuid = this->ReadInteger<int64_t>();
+	uint32_t flags = this->ReadInteger<uint32_t>();
+	device.DeviceAdapter.IsHardware = true;
+	device.DeviceAdapter.IsIntegrated = (flags & DEVICESNAPSHOT_FLAG_INTEGRATED) != 0;
+	device.DeviceAdapter.IsDetachable = (flags & DEVICESNAPSHOT_FLAG_DETACHABLE) != 0;
+	device.DeviceAdapter.SupportsDisplay = (flags & DEVICESNAPSHOT_FLAG_SUPPORTS_DISPLAY) != 0;
+	device.DeviceAdapter.SupportsCompute = (flags & DEVICESNAPSHOT_FLAG_SUPPORTS_COMPUTE) != 0;
+	device.NumaNode = this->ReadInteger<int32_t>();
+	
+	// Read the driver version, memory sizes and kernel-mode driver model version of the adapter
+	device.DeviceAdapter.DriverVersion = this->ReadInteger<uint64_t>();
+	device.DeviceAdapter.DedicatedAdapterMemory = this->ReadInteger<uint64_t>();
+	device.DeviceAdapter.SharedSystemMemory = this->ReadInteger<uint64_t>();
+	device.DeviceAdapter.KmdModelVersion = this->ReadInteger<uint32_t>();
+	
+	// Read the device properties
+	device.ID = this->ReadString();
+	device.Description = this->ReadString();
+	device.DriverRegistryKey = this->ReadString();
+	device.DriverStorePath = this->ReadString();
+	device.LocationPath = this->ReadString();
+	device.Vendor = this->ReadString();
+	device.PcieRoot = this->ReadString();
+	device.RuntimeFiles = this->ReadRuntimeFiles();
+	device.RuntimeFilesWow64 = this->ReadRuntimeFiles();
+	
+	return device;
+}
+
+size_t SnapshotReader::Remaining() const {
+	return this->size - this->offset;
+}
+
+vector<RuntimeFile> SnapshotReader::ReadRuntimeFiles()
+{
+	// Read the number of files and verify that it is plausible, since each file requires at least two string lengths
+	size_t numFiles = this->ReadInteger<uint32_t>();
+	this->Require(numFiles * sizeof(uint32_t) * 2);
+	
+	// Read the details for each file
+	vector<RuntimeFile> files;
+	files.reserve(numFiles);
+	for (size_t index = 0; index < numFiles; ++index)
+	{
+		wstring sourcePath = this->ReadString();
+		wstring destinationFilename = this->ReadString();
+		files.emplace_back(std::move(sourcePath), std::move(destinationFilename));
+	}
+	
+	return files;
+}
+
+void SnapshotReader::Require(size_t numBytes) const
+{
+	if (this->Remaining() < numBytes) {
+		throw CreateError(L"snapshot data is truncated at offset " + std::to_wstring(this->offset));
+	}
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include "Device.h"
+
+#include <cstring>
+
+using std::vector;
+using std::wstring;
+
+// Provides functionality for serialising device lists into the snapshot format described in DeviceSnapshot.h
+namespace SnapshotSerialiser
+{
+	// Appends the bytes of an integer value to a buffer
+	// (All of our supported platforms are little-endian, so the in-memory representation matches the snapshot format)
+	template <typename T> void AppendInteger(vector<uint8_t>& buffer, T value)
+	{
+		size_t offset = buffer.size();
+		buffer.resize(offset + sizeof(T));
+		memcpy(buffer.data() + offset, &value, sizeof(T));
+	}
+	
+	// Appends the serialised details of an individual device to a buffer
+	void AppendDevice(vector<uint8_t>& buffer, const Device& device);
+	
+	// Computes the serialised size of an individual device, in bytes
+	size_t DeviceSize(const Device& device);
+	
+	// Serialises the supplied list of devices into a snapshot buffer
+	vector<uint8_t> Serialise(const vector<Device>& devices);
+}
+
+// Reads values sequentially from a buffer that uses the snapshot encoding, throwing an error if the buffer is truncated
+class SnapshotReader
+{
+	public:
+		SnapshotReader(const uint8_t* data, size_t size);
+		
+		// Reads an integer value from the buffer
+		template <typename T> T ReadInteger()
+		{
+			this->Require(sizeof(T));
+			T value;
+			memcpy(&value, this->data + this->offset, sizeof(T));
+			this->offset += sizeof(T);
+			return value;
+		}
+		
+		// Reads a length-prefixed UTF-16 string from the buffer
+		wstring ReadString();
+		
+		// Reads the serialised details of an individual device from the buffer
+		Device ReadDevice();
+		
+		// Returns the number of bytes that have not yet been read
+		size_t Remaining() const;
+		
+	private:
+		
+		// Reads a count-prefixed list of runtime files from the buffer
+		vector<RuntimeFile> ReadRuntimeFiles();
+		
+		// Throws an error if fewer than the specified number of bytes remain in the buffer
+		void Require(size_t numBytes) const;
+		
+		const uint8_t* data;
+		size_t size;
+		size_t offset;
+};
@@ -0,0 +1,83 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <mutex>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+namespace ThreadingHelpers {
+
+
+// The maximum number of worker threads used by ParallelFor, since our workloads are dominated by kernel and registry calls rather than computation
+const size_t MaxWorkerThreads = 8;
+
+// Invokes the supplied function once for each index in the range [0, count), distributing the invocations across a small set of worker threads.
+// Returns once all invocations have completed. If any invocation throws then no further indices are claimed, and once all of the workers have
+// stopped the first exception is rethrown on the calling thread, so callers that need the results for every index should capture errors themselves.
+template <typename Function>
+void ParallelFor(size_t count, const Function& function)
+{
+	// Determine how many worker threads to use, and avoid spawning threads altogether when there is only a single work item
+	size_t numThreads = std::min({ count, MaxWorkerThreads, std::max<size_t>(std::thread::hardware_concurrency(), 1) });
+	if (numThreads <= 1)
+	{
+		for (size_t index = 0; index < count; ++index) {
+			function(index);
+		}
+		
+		return;
+	}
+	
+	// Each worker repeatedly claims the next unprocessed index until all indices have been processed or an invocation has thrown
+	// (Exceptions must not escape a worker thread, so we capture the first one and rethrow it on the calling thread once all workers have stopped)
+	std::atomic<size_t> nextIndex(0);
+	std::exception_ptr firstError;
+	std::mutex errorMutex;
+	auto worker = [&nextIndex, &firstError, &errorMutex, &function, count]()
+	{
+		try
+		{
+			for (size_t index = nextIndex++; index < count; index = nextIndex++) {
+				function(index);
+			}
+		}
+		catch (...)
+		{
+			std::lock_guard<std::mutex> lock(errorMutex);
+			if (!firstError) {
+				firstError = std::current_exception();
+			}
+			
+			nextIndex = count;
+		}
+	};
+	
+	// Run the workers on our additional threads and on the calling thread, then wait for the additional threads to complete
+	// (If a thread cannot be created then we simply proceed with the workers we have, since the calling thread alone can process every index)
+	std::vector<std::thread> threads;
+	threads.reserve(numThreads - 1);
+	for (size_t thread = 1; thread < numThreads; ++thread)
+	{
+		try {
+			threads.emplace_back(worker);
+		}
+		catch (const std::system_error&) {
+			break;
+		}
+	}
+	worker();
+	for (auto& thread : threads) {
+		thread.join();
+	}
+	
+	// Propagate the first exception thrown by any of the workers
+	if (firstError) {
+		std::rethrow_exception(firstError);
+	}
+}
+
+
+} // namespace ThreadingHelpers
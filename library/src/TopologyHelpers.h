@@ -0,0 +1,17 @@
+#pragma once
+
+#include <string>
+
+namespace TopologyHelpers {
+
+
+// Extracts the PCIe root complex component from a device location path (e.g. "PCIROOT(0)" for "PCIROOT(0)#PCI(0100)#PCI(0000)"),
+// returning an empty string if the location path does not start with a PCIe root
+inline std::wstring GetPcieRoot(const std::wstring& locationPath)
+{
+	std::wstring root = locationPath.substr(0, locationPath.find(L'#'));
+	return (_wcsnicmp(root.c_str(), L"PCIROOT(", 8) == 0) ? root : L"";
+}
+
+
+} // namespace TopologyHelpers
@@ -0,0 +1,132 @@
+#include "TraceLogging.h"
+
+#include <exception>
+#include <winmeta.h>
+
+TRACELOGGING_DEFINE_PROVIDER(
+	DiscoveryTraceProvider,
+	"TensorWorks.DirectXDeviceDiscovery",
+	(0x50c384e6, 0xa7b6, 0x5dc8, 0x2e, 0xb2, 0x08, 0x8c, 0x9e, 0x63, 0x7f, 0xfc)
+);
+
+TraceActivity::TraceActivity(const char* operation, int64_t luid, wstring_view deviceID, wstring_view detail) :
+	operation(operation), luid(luid), result(S_OK), resultSet(false), uncaughtExceptions(std::uncaught_exceptions()), activityID(GUID_NULL),
+	previousActivityID(GUID_NULL), attached(false), active(false)
+{
+	// Don't do anything if no trace session is listening to our provider
+	if (!TraceLoggingProviderEnabled(DiscoveryTraceProvider, WINEVENT_LEVEL_INFO, 0)) {
+		return;
+	}
+	
+	// Generate a unique ID for the activity and make it the calling thread's current activity, retrieving the thread's previous activity
+	// ID so we can relate our activity to it and restore it when we stop
+	EventActivityIdControl(EVENT_ACTIVITY_CTRL_CREATE_ID, &this->activityID);
+	this->previousActivityID = this->activityID;
+	EventActivityIdControl(EVENT_ACTIVITY_CTRL_GET_SET_ID, &this->previousActivityID);
+	this->attached = true;
+	
+	// Emit the start event
+	TraceLoggingWriteActivity(
+		DiscoveryTraceProvider,
+		"DiscoveryActivity",
+		&this->activityID,
+		(IsEqualGUID(this->previousActivityID, GUID_NULL) ? nullptr : &this->previousActivityID),
+		TraceLoggingLevel(WINEVENT_LEVEL_INFO),
+		TraceLoggingOpcode(WINEVENT_OPCODE_START),
+		TraceLoggingString(operation, "Operation"),
+		TraceLoggingInt64(luid, "AdapterLuid"),
+		TraceLoggingCountedWideString(deviceID.data(), static_cast<USHORT>(deviceID.size()), "DeviceID"),
+		TraceLoggingCountedWideString(detail.data(), static_cast<USHORT>(detail.size()), "Detail")
+	);
+	
+	this->active = true;
+}
+
+TraceActivity::TraceActivity(TraceActivity&& other) noexcept :
+	operation(other.operation), luid(other.luid), result(other.result), resultSet(other.resultSet),
+	uncaughtExceptions(other.uncaughtExceptions), activityID(other.activityID), previousActivityID(other.previousActivityID),
+	attached(other.attached), active(other.active)
+{
+	other.active = false;
+}
+
+TraceActivity& TraceActivity::operator=(TraceActivity&& other) noexcept
+{
+	if (this != &other)
+	{
+		// Complete our existing activity before taking ownership of the other one
+		this->Stop();
+		this->operation = other.operation;
+		this->luid = other.luid;
+		this->result = other.result;
+		this->resultSet = other.resultSet;
+		this->uncaughtExceptions = other.uncaughtExceptions;
+		this->activityID = other.activityID;
+		this->previousActivityID = other.previousActivityID;
+		this->attached = other.attached;
+		this->active = other.active;
+		other.active = false;
+	}
+	
+	return *this;
+}
+
+TraceActivity::~TraceActivity() {
+	this->Stop();
+}
+
+void TraceActivity::SetResult(HRESULT result)
+{
+	this->result = result;
+	this->resultSet = true;
+}
+
+void TraceActivity::SetError(const DeviceDiscoveryError& error) {
+	this->SetResult(FAILED(error.code) ? error.code : E_FAIL);
+}
+
+void TraceActivity::SetAdapterLuid(int64_t luid) {
+	this->luid = luid;
+}
+
+void TraceActivity::Detach()
+{
+	if (!this->attached) {
+		return;
+	}
+	
+	// Restore the calling thread's previous activity ID, so the activity no longer parents events emitted by the thread
+	GUID previousActivityID = this->previousActivityID;
+	EventActivityIdControl(EVENT_ACTIVITY_CTRL_SET_ID, &previousActivityID);
+	this->attached = false;
+}
+
+void TraceActivity::Stop()
+{
+	if (!this->active) {
+		return;
+	}
+	
+	// If we are being unwound by an exception and no explicit result was set then report a generic failure
+	HRESULT result = this->result;
+	if (!this->resultSet && std::uncaught_exceptions() > this->uncaughtExceptions) {
+		result = E_FAIL;
+	}
+	
+	// Emit the stop event
+	TraceLoggingWriteActivity(
+		DiscoveryTraceProvider,
+		"DiscoveryActivity",
+		&this->activityID,
+		nullptr,
+		TraceLoggingLevel(WINEVENT_LEVEL_INFO),
+		TraceLoggingOpcode(WINEVENT_OPCODE_STOP),
+		TraceLoggingString(this->operation, "Operation"),
+		TraceLoggingInt64(this->luid, "AdapterLuid"),
+		TraceLoggingHResult(result, "HResult")
+	);
+	
+	// Restore the calling thread's previous activity ID
+	this->Detach();
+	this->active = false;
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include "ErrorHandling.h"
+
+#include <Windows.h>
+#include <TraceLoggingProvider.h>
+
+using std::wstring_view;
+
+// The TraceLogging provider for the device discovery library, which emits start/stop activity events for each discovery phase
+// (Provider name "TensorWorks.DirectXDeviceDiscovery", GUID {50c384e6-a7b6-5dc8-2eb2-088c9e637ffc}, which is derived from the name by the standard ETW name hash)
+TRACELOGGING_DECLARE_PROVIDER(DiscoveryTraceProvider);
+
+// Emits a start event for an activity when it is constructed and the matching stop event when it is destroyed
+// (If no ETW session has enabled our provider then the activity does nothing, so an idle trace costs a single check per activity)
+// While an activity is in progress it is the calling thread's current activity, so events and activities started by the same thread
+// are related to it, and the thread's previous activity ID is restored when it stops. Activities must therefore be stopped on the
+// thread that started them, in the reverse order to which they were started, unless they have been detached from the thread.
+class TraceActivity
+{
+	public:
+		TraceActivity(const char* operation, int64_t luid = 0, wstring_view deviceID = {}, wstring_view detail = {});
+		TraceActivity(TraceActivity&& other) noexcept;
+		TraceActivity& operator=(TraceActivity&& other) noexcept;
+		~TraceActivity();
+		
+		TraceActivity(const TraceActivity& other) = delete;
+		TraceActivity& operator=(const TraceActivity& other) = delete;
+		
+		// Sets the HRESULT that will be reported in the stop event
+		// (If no result is set and the activity is destroyed while an exception is propagating then E_FAIL is reported instead of S_OK)
+		void SetResult(HRESULT result);
+		
+		// Sets the result that will be reported in the stop event from the HRESULT of an error, or E_FAIL if the error has no HRESULT
+		void SetError(const DeviceDiscoveryError& error);
+		
+		// Sets the adapter LUID that will be reported in the stop event, for activities where the LUID is not known until they complete
+		void SetAdapterLuid(int64_t luid);
+		
+		// Restores the calling thread's previous activity ID while the activity remains in progress, for asynchronous operations whose
+		// activities outlive the scope that started them and would otherwise be treated as the parent of unrelated sibling operations
+		void Detach();
+		
+	private:
+		
+		// Emits the stop event if the activity is active and then marks it as inactive
+		void Stop();
+		
+		const char* operation;
+		int64_t luid;
+		HRESULT result;
+		bool resultSet;
+		int uncaughtExceptions;
+		GUID activityID;
+		GUID previousActivityID;
+		bool attached;
+		bool active;
+};
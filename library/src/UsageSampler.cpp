@@ -0,0 +1,112 @@
+#include "UsageSampler.h"
+#include "ErrorHandling.h"
+#include "ObjectHelpers.h"
+
+#include <algorithm>
+
+namespace
+{
+	// Performs a D3DKMT statistics query of the specified type against the adapter with the specified LUID
+	D3DKMT_QUERYSTATISTICS QueryStatistics(int64_t luid, D3DKMT_QUERYSTATISTICS_TYPE type, ULONG id)
+	{
+		auto query = ObjectHelpers::GetZeroedStruct<D3DKMT_QUERYSTATISTICS>();
+		query.Type = type;
+		query.AdapterLuid = LuidFromInt64(luid);
+		
+		// Specify the segment or node being queried, where applicable
+		if (type == D3DKMT_QUERYSTATISTICS_SEGMENT) {
+			query.QuerySegment.SegmentId = id;
+		}
+		else if (type == D3DKMT_QUERYSTATISTICS_NODE) {
+			query.QueryNode.NodeId = id;
+		}
+		
+		auto error = CheckNtStatus(D3DKMTQueryStatistics(&query));
+		if (error) {
+			throw error.Wrap(L"D3DKMTQueryStatistics failed for adapter LUID " + std::to_wstring(luid));
+		}
+		
+		return query;
+	}
+}
+
+vector<DeviceUsageRecord> UsageSampler::Sample(const vector<Device>& devices)
+{
+	// Sample each device in turn, carrying over only the engine samples for devices that are still present
+	vector<DeviceUsageRecord> records;
+	map<int64_t, EngineSample> current;
+	for (auto const& device : devices)
+	{
+		int64_t luid = device.DeviceAdapter.InstanceLuid;
+		EngineSample engines;
+		try
+		{
+			DeviceUsageRecord record = UsageSampler::SampleDevice(luid, engines);
+			
+			// Compute the utilisation of the busiest engine since the previous sample, if we have one with a matching engine count
+			auto previousSample = this->previous.find(luid);
+			if (previousSample != this->previous.end() && previousSample->second.RunningTimes.size() == engines.RunningTimes.size())
+			{
+				// Running times are reported in 100-nanosecond units
+				int64_t elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(engines.Timestamp - previousSample->second.Timestamp).count() / 100;
+				if (elapsed > 0)
+				{
+					int64_t busiest = 0;
+					for (size_t engine = 0; engine < engines.RunningTimes.size(); ++engine) {
+						busiest = std::max(busiest, engines.RunningTimes[engine] - previousSample->second.RunningTimes[engine]);
+					}
+					
+					record.EngineUtilisation = std::clamp(static_cast<double>(busiest) / static_cast<double>(elapsed), 0.0, 1.0);
+				}
+			}
+			
+			records.push_back(record);
+			current.insert(std::make_pair(luid, std::move(engines)));
+		}
+		catch (const DeviceDiscoveryError& err) {
+			LOG(L"Failed to sample usage for adapter LUID {}: {}", luid, err.message);
+		}
+	}
+	
+	this->previous = std::move(current);
+	return records;
+}
+
+DeviceUsageRecord UsageSampler::SampleDevice(int64_t luid, EngineSample& engines)
+{
+	DeviceUsageRecord record = {};
+	record.AdapterLuid = luid;
+	record.EngineUtilisation = DEVICEUSAGE_UTILISATION_UNKNOWN;
+	
+	// Determine the number of memory segments and engines (nodes) for the adapter
+	D3DKMT_QUERYSTATISTICS adapter = QueryStatistics(luid, D3DKMT_QUERYSTATISTICS_ADAPTER, 0);
+	ULONG numSegments = adapter.QueryResult.AdapterInformation.NbSegments;
+	ULONG numNodes = adapter.QueryResult.AdapterInformation.NodeCount;
+	
+	// Accumulate the usage for each memory segment, distinguishing between dedicated and shared (aperture) segments
+	for (ULONG segment = 0; segment < numSegments; ++segment)
+	{
+		D3DKMT_QUERYSTATISTICS query = QueryStatistics(luid, D3DKMT_QUERYSTATISTICS_SEGMENT, segment);
+		const auto& info = query.QueryResult.SegmentInformation;
+		if (info.Aperture)
+		{
+			record.SharedMemoryUsed += info.BytesResident;
+			record.SharedMemoryTotal += info.CommitLimit;
+		}
+		else
+		{
+			record.DedicatedMemoryUsed += info.BytesResident;
+			record.DedicatedMemoryTotal += info.CommitLimit;
+		}
+	}
+	
+	// Retrieve the cumulative running time for each engine
+	engines.Timestamp = steady_clock::now();
+	for (ULONG node = 0; node < numNodes; ++node)
+	{
+		D3DKMT_QUERYSTATISTICS query = QueryStatistics(luid, D3DKMT_QUERYSTATISTICS_NODE, node);
+		engines.RunningTimes.push_back(query.QueryResult.NodeInformation.GlobalInformation.RunningTime.QuadPart);
+	}
+	
+	return record;
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include "Device.h"
+#include "DeviceUsage.h"
+
+#include <chrono>
+
+using std::map;
+using std::vector;
+using std::chrono::steady_clock;
+
+// Samples the memory usage and engine utilisation of devices using D3DKMT query statistics
+class UsageSampler
+{
+	public:
+		
+		// Samples the usage of each of the supplied devices, omitting any devices whose statistics cannot be queried
+		vector<DeviceUsageRecord> Sample(const vector<Device>& devices);
+		
+	private:
+		
+		// The engine running times from a previous sample of a device
+		struct EngineSample
+		{
+			steady_clock::time_point Timestamp;
+			vector<int64_t> RunningTimes;
+		};
+		
+		// Samples the memory usage of an individual device and retrieves the cumulative running time of each of its engines
+		static DeviceUsageRecord SampleDevice(int64_t luid, EngineSample& engines);
+		
+		// The engine running times from the previous sample of each device, keyed by adapter LUID
+		map<int64_t, EngineSample> previous;
+};
@@ -0,0 +1,121 @@
+#include "WmiConnection.h"
+#include "ErrorHandling.h"
+
+#include <mutex>
+
+using std::weak_ptr;
+
+namespace
+{
+	// The mutex that protects the shared connection
+	std::mutex sharedConnectionMutex;
+	
+	// The shared connection, which is released once all of the WmiQuery objects that use it have been destroyed
+	weak_ptr<WmiConnection> sharedConnection;
+}
+
+WmiConnection::WmiConnection()
+{
+	// Create a reusable error object
+	DeviceDiscoveryError error;
+	
+	// Create our IWbemLocator instance
+	CatchHresult(error, this->wbemLocator = winrt::create_instance<IWbemLocator>(CLSID_WbemLocator));
+	if (error) {
+		throw error.Wrap(L"failed to create an IWbemLocator instance");
+	}
+	
+	// Connect to the WMI service and retrieve a service proxy object
+	error = CheckHresult(this->wbemLocator->ConnectServer(
+		wil::make_bstr(L"ROOT\\CIMV2").get(),
+		nullptr,
+		nullptr,
+		nullptr,
+		WBEM_FLAG_CONNECT_USE_MAX_WAIT,
+		nullptr,
+		nullptr,
+		this->wbemServices.put()
+	));
+	if (error) {
+		throw error.Wrap(L"failed to connect to the WMI service");
+	}
+	
+	// Set the security level for the service proxy
+	error = CheckHresult(CoSetProxyBlanket(
+		this->wbemServices.get(),
+		RPC_C_AUTHN_WINNT,
+		RPC_C_AUTHZ_NONE,
+		nullptr,
+		RPC_C_AUTHN_LEVEL_CALL,
+		RPC_C_IMP_LEVEL_IMPERSONATE,
+		nullptr,
+		EOAC_NONE
+	));
+	if (error) {
+		throw error.Wrap(L"failed to set the security level for the WMI service proxy");
+	}
+	
+	// Retrieve the CIM class definition for the Win32_PnPEntity class
+	error = CheckHresult(this->wbemServices->GetObject(
+		wil::make_bstr(L"Win32_PnPEntity").get(),
+		0,
+		nullptr,
+		this->pnpEntityClass.put(),
+		nullptr
+	));
+	if (error) {
+		throw error.Wrap(L"failed to retrieve the CIM class definition for the Win32_PnPEntity class");
+	}
+	
+	// Retrieve the input parameters class for the `GetDeviceProperties` method of the CIM class definition
+	error = CheckHresult(this->pnpEntityClass->GetMethod(L"GetDeviceProperties", 0, this->inputParameters.put(), nullptr));
+	if (error) {
+		throw error.Wrap(L"failed to retrieve the input parameters class for Win32_PnPEntity::GetDeviceProperties");
+	}
+}
+
+shared_ptr<WmiConnection> WmiConnection::Acquire()
+{
+	std::lock_guard<std::mutex> lock(sharedConnectionMutex);
+	
+	// Reuse the existing shared connection if there is one
+	shared_ptr<WmiConnection> connection = sharedConnection.lock();
+	if (connection) {
+		return connection;
+	}
+	
+	// Establish a new connection and share it
+	LOG(L"Establishing a new connection to the WMI service");
+	connection = std::make_shared<WmiConnection>();
+	sharedConnection = connection;
+	return connection;
+}
+
+void WmiConnection::Invalidate(const shared_ptr<WmiConnection>& connection)
+{
+	std::lock_guard<std::mutex> lock(sharedConnectionMutex);
+	
+	// Only discard the shared connection if it is the connection that was lost
+	if (sharedConnection.lock() == connection)
+	{
+		LOG(L"Discarding the shared connection to the WMI service");
+		sharedConnection.reset();
+	}
+}
+
+bool WmiConnection::IsDisconnectError(HRESULT code)
+{
+	return
+		code == RPC_E_DISCONNECTED ||
+		code == WBEM_E_TRANSPORT_FAILURE ||
+		code == HRESULT_FROM_WIN32(RPC_S_SERVER_UNAVAILABLE) ||
+		code == HRESULT_FROM_WIN32(RPC_S_CALL_FAILED);
+}
+
+const com_ptr<IWbemServices>& WmiConnection::GetServices() const {
+	return this->wbemServices;
+}
+
+const com_ptr<IWbemClassObject>& WmiConnection::GetInputParameters() const {
+	return this->inputParameters;
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+using std::shared_ptr;
+using winrt::com_ptr;
+
+// Represents a connection to the WMI service, along with the CIM class objects that we retrieve from it
+// (Connections are shared by all WmiQuery objects in the process, since establishing a connection is expensive)
+class WmiConnection
+{
+	public:
+		
+		// Establishes a new connection to the WMI service (callers should typically use `Acquire()` instead)
+		WmiConnection();
+		
+		// Retrieves the shared connection to the WMI service, establishing a new connection if no shared connection exists
+		static shared_ptr<WmiConnection> Acquire();
+		
+		// Discards the specified connection so that subsequent calls to `Acquire()` will establish a new connection
+		// (This has no effect if the shared connection has already been replaced with a different connection)
+		static void Invalidate(const shared_ptr<WmiConnection>& connection);
+		
+		// Determines whether the specified HRESULT indicates that the connection to the WMI service has been lost
+		static bool IsDisconnectError(HRESULT code);
+		
+		// Retrieves the service proxy object for the WMI service
+		const com_ptr<IWbemServices>& GetServices() const;
+		
+		// Retrieves the input parameters class for the `GetDeviceProperties` method of the Win32_PnPEntity class
+		const com_ptr<IWbemClassObject>& GetInputParameters() const;
+		
+	private:
+		
+		// Our COM objects for communicating with WMI
+		com_ptr<IWbemLocator> wbemLocator;
+		com_ptr<IWbemServices> wbemServices;
+		com_ptr<IWbemClassObject> pnpEntityClass;
+		com_ptr<IWbemClassObject> inputParameters;
+};
@@ -1,21 +1,24 @@
 #include "WmiQuery.h"
+#include "D3DHelpers.h"
+#include "DevicePropertyKeys.h"
 #include "ErrorHandling.h"
+#include "ParsingHelpers.h"
 #include "SafeArray.h"
 
-#include <devpropdef.h>
 #include <fmt/core.h>
 
 using std::set;
+using std::wstring_view;
 using wil::unique_variant;
 using winrt::hstring;
 
 namespace
 {
-	// Device property key for retrieving the DirectX adapter LUID
-	const DEVPROPKEY DEVPKEY_Device_AdapterLuid = {
-		{ 0x60b193cb, 0x5276, 0x4d0f, { 0x96, 0xfc, 0xf1, 0x73, 0xab, 0xad, 0x3e, 0xc6 } },
-		2
-	};
+	// The maximum number of PnP devices retrieved from WMI in each enumeration round-trip
+	const ULONG EnumerationBatchSize = 16;
+	
+	// The maximum amount of time that we wait for WMI to return results, in milliseconds
+	const long WmiTimeoutMilliseconds = 30000;
 	
 	// Formats a DEVPROPKEY as a string in the form "{00000000-0000-0000-0000-000000000000} 0"
 	wstring DevPropKeyToString(const DEVPROPKEY& key)
@@ -37,6 +40,28 @@ namespace
 		);
 	}
 	
+	// Returns a view of the contents of a BSTR, so the string can be copied directly rather than via an intermediate hstring
+	wstring_view BstrView(BSTR value) {
+		return wstring_view(value, SysStringLen(value));
+	}
+	
+	// Escapes a string for use as a quoted key value in a WMI object path
+	wstring EscapeObjectPathValue(wstring_view value)
+	{
+		wstring escaped;
+		escaped.reserve(value.size() * 2);
+		for (wchar_t c : value)
+		{
+			if (c == L'\\' || c == L'"') {
+				escaped += L'\\';
+			}
+			
+			escaped += c;
+		}
+		
+		return escaped;
+	}
+	
 	// Formats a PnP hardware ID for use in a WQL query
 	wstring FormatHardwareID(const DXCoreHardwareID& dxHardwareID)
 	{
@@ -53,67 +78,13 @@ namespace
 	}
 }
 
-WmiQuery::WmiQuery()
+WmiQuery::WmiQuery(MetricsRecorder& metrics) : metrics(metrics)
 {
-	// Create a reusable error object
-	DeviceDiscoveryError error;
-	
 	// Generate the string identifier for the DEVPKEY_Device_AdapterLuid device property key
 	this->devPropKeyLUID = DevPropKeyToString(DEVPKEY_Device_AdapterLuid);
 	
-	// Create our IWbemLocator instance
-	CatchHresult(error, this->wbemLocator = winrt::create_instance<IWbemLocator>(CLSID_WbemLocator));
-	if (error) {
-		throw error.Wrap(L"failed to create an IWbemLocator instance");
-	}
-	
-	// Connect to the WMI service and retrieve a service proxy object
-	error = CheckHresult(this->wbemLocator->ConnectServer(
-		wil::make_bstr(L"ROOT\\CIMV2").get(),
-		nullptr,
-		nullptr,
-		nullptr,
-		0,
-		nullptr,
-		nullptr,
-		this->wbemServices.put()
-	));
-	if (error) {
-		throw error.Wrap(L"failed to connect to the WMI service");
-	}
-	
-	// Set the security level for the service proxy
-	error = CheckHresult(CoSetProxyBlanket(
-		this->wbemServices.get(),
-		RPC_C_AUTHN_WINNT,
-		RPC_C_AUTHZ_NONE,
-		nullptr,
-		RPC_C_AUTHN_LEVEL_CALL,
-		RPC_C_IMP_LEVEL_IMPERSONATE,
-		nullptr,
-		EOAC_NONE
-	));
-	if (error) {
-		throw error.Wrap(L"failed to set the security level for the WMI service proxy");
-	}
-	
-	// Retrieve the CIM class definition for the Win32_PnPEntity class
-	error = CheckHresult(this->wbemServices->GetObject(
-		wil::make_bstr(L"Win32_PnPEntity").get(),
-		0,
-		nullptr,
-		this->pnpEntityClass.put(),
-		nullptr
-	));
-	if (error) {
-		throw error.Wrap(L"failed to retrieve the CIM class definition for the Win32_PnPEntity class");
-	}
-	
-	// Retrieve the input parameters class for the `GetDeviceProperties` method of the CIM class definition
-	error = CheckHresult(this->pnpEntityClass->GetMethod(L"GetDeviceProperties", 0, this->inputParameters.put(), nullptr));
-	if (error) {
-		throw error.Wrap(L"failed to retrieve the input parameters class for Win32_PnPEntity::GetDeviceProperties");
-	}
+	// Retrieve the shared connection to the WMI service
+	this->connection = WmiConnection::Acquire();
 }
 
 vector<Device> WmiQuery::GetDevicesForAdapters(const map<int64_t, Adapter>& adapters)
@@ -125,76 +96,227 @@ vector<Device> WmiQuery::GetDevicesForAdapters(const map<int64_t, Adapter>& adap
 		return {};
 	}
 	
-	// Gather the unique PnP hardware IDs from the DirectX adapters for use in our WQL query string
-	set<wstring> hardwareIDs;
-	for (auto const& adapter : adapters) {
-		hardwareIDs.insert(FormatHardwareID(adapter.second.HardwareID));
+	// Query the devices, establishing a new connection and retrying once if the connection to the WMI service has been lost
+	try {
+		return this->QueryDevices(adapters);
 	}
-	
-	// Build the WQL query string to retrieve the PnP devices associated with the adapters
-	wstring query = L"SELECT * FROM Win32_PnPEntity WHERE Present = TRUE AND (";
-	int index = 0;
-	int last = hardwareIDs.size() - 1;
-	for (auto const& id : hardwareIDs)
+	catch (const DeviceDiscoveryError& err)
 	{
-		query += L"DeviceID LIKE \"" + id + L"\"" + ((index < last) ? L" OR " : L"");
-		index++;
-	}
-	query += L")";
-	
-	// Log the query string
-	LOG(L"Executing WQL query: {}", query);
-	
-	// Execute the query
-	com_ptr<IEnumWbemClassObject> enumerator;
-	auto error = CheckHresult(wbemServices->ExecQuery(
-		wil::make_bstr(L"WQL").get(),
-		wil::make_bstr(query.c_str()).get(),
-		0,
-		nullptr,
-		enumerator.put()
-	));
-	if (error) {
-		throw error.Wrap(L"WQL query execution failed");
+		if (!WmiConnection::IsDisconnectError(err.code)) {
+			throw;
+		}
+		
+		LOG(L"Lost connection to the WMI service, reconnecting and retrying device query: {}", err.Pretty());
+		WmiConnection::Invalidate(this->connection);
+		this->connection = WmiConnection::Acquire();
+		return this->QueryDevices(adapters);
 	}
-	
-	// Iterate over the retrieved PnP devices and match them to their corresponding DirectX adapters
-	vector<Device> devices;
-	for (int index = 0; ; index++)
+}
+
+vector<Device> WmiQuery::QueryDevices(const map<int64_t, Adapter>& adapters) const
+{
+	// Retrieve the PnP devices for the adapters whose device instance IDs can be resolved directly, and fall back to a WQL query for any others
+	vector<PendingDeviceDetails> pending;
+	map<int64_t, Adapter> unresolved = this->FetchDevicesByKey(adapters, pending);
+	if (!unresolved.empty())
 	{
-		// Retrieve the device for the current loop iteration
-		ULONG numReturned = 0;
-		com_ptr<IWbemClassObject> device;
-		auto error = CheckHresult(enumerator->Next(WBEM_INFINITE, 1, device.put(), &numReturned));
-		if (error) {
-			throw error.Wrap(L"enumerating PnP devices failed");
+		// Gather the unique PnP hardware IDs from the unresolved adapters for use in our WQL query string
+		set<wstring> hardwareIDs;
+		for (auto const& adapter : unresolved) {
+			hardwareIDs.insert(FormatHardwareID(adapter.second.HardwareID));
 		}
-		if (numReturned == 0) {
-			break;
+		
+		// Build the WQL query string to retrieve the PnP devices associated with the adapters
+		// (We only select the columns we use, and since DeviceID is the key property, WMI still populates the __Path property for each result)
+		wstring query = L"SELECT DeviceID, Description, Manufacturer FROM Win32_PnPEntity WHERE Present = TRUE AND (";
+		int index = 0;
+		int last = hardwareIDs.size() - 1;
+		for (auto const& id : hardwareIDs)
+		{
+			query += L"DeviceID LIKE \"" + id + L"\"" + ((index < last) ? L" OR " : L"");
+			index++;
 		}
+		query += L")";
 		
-		// Extract the details for the device and determine whether it matches any of our adapters
-		Device details = this->ExtractDeviceDetails(device);
-		auto matchingAdapter = adapters.find(details.DeviceAdapter.InstanceLuid);
-		if (matchingAdapter != adapters.end())
+		// Log the query string
+		LOG(L"Executing WQL query: {}", query);
+		this->ExecuteQuery(query, pending);
+	}
+	
+	// Wait for the device properties to be retrieved and match the devices to their corresponding DirectX adapters
+	// (Each adapter is matched at most once, so a device that was fetched directly and also returned by the WQL query is not duplicated)
+	map<int64_t, Adapter> unmatched = adapters;
+	vector<Device> devices;
+	for (auto& device : pending)
+	{
+		// Extract the device properties and determine whether the device matches any of our adapters
+		this->ExtractDeviceProperties(device);
+		Device& details = device.Details;
+		auto matchingAdapter = unmatched.find(details.DeviceAdapter.InstanceLuid);
+		if (matchingAdapter != unmatched.end())
 		{
 			// Log the match
 			LOG(L"Matched adapter LUID {} to PnP device {}", details.DeviceAdapter.InstanceLuid, details.ID);
 			
 			// Replace the device's adapter details with the matching adapter
 			details.DeviceAdapter = matchingAdapter->second;
+			unmatched.erase(matchingAdapter);
 			
 			// Include the device in our results
-			devices.push_back(details);
+			devices.push_back(std::move(details));
 		}
 	}
 	
 	return devices;
 }
 
-Device WmiQuery::ExtractDeviceDetails(const com_ptr<IWbemClassObject>& device) const
+map<int64_t, Adapter> WmiQuery::FetchDevicesByKey(const map<int64_t, Adapter>& adapters, vector<PendingDeviceDetails>& pending) const
 {
-	Device details;
+	map<int64_t, Adapter> unresolved;
+	DeviceDiscoveryError error;
+	
+	// Resolve the device instance ID for each adapter and submit a semisynchronous request for its Win32_PnPEntity instance
+	// (Note that the requests are executed concurrently, and we only wait for their results once all of the requests have been submitted)
+	vector<PendingDeviceFetch> fetches;
+	{
+		ScopedTimer timer(this->metrics, DiscoveryPhase::DeviceQuery);
+		for (auto const& adapter : adapters)
+		{
+			try
+			{
+				wstring path = L"Win32_PnPEntity.DeviceID=\"" + EscapeObjectPathValue(QueryAdapterInstanceID(adapter.first)) + L"\"";
+				TraceActivity activity("GetObject", adapter.first, {}, path);
+				com_ptr<IWbemCallResult> callResult;
+				error = CheckHresult(this->connection->GetServices()->GetObject(
+					wil::make_bstr(path.c_str()).get(),
+					WBEM_FLAG_RETURN_IMMEDIATELY,
+					nullptr,
+					nullptr,
+					callResult.put()
+				));
+				if (error)
+				{
+					activity.SetError(error);
+					throw error.Wrap(L"IWbemServices::GetObject failed for object path " + path);
+				}
+				
+				// The call completes asynchronously, so detach its activity from the thread before we submit our other requests
+				activity.Detach();
+				fetches.push_back({ adapter.first, std::move(callResult), std::move(activity) });
+			}
+			catch (const DeviceDiscoveryError& err)
+			{
+				if (WmiConnection::IsDisconnectError(err.code)) {
+					throw;
+				}
+				
+				LOG(L"Could not fetch the PnP device for adapter LUID {} directly, falling back to a WQL query: {}", adapter.first, err.message);
+				unresolved.insert(adapter);
+			}
+		}
+	}
+	
+	// Wait for each of the instances to be retrieved and start retrieving their device properties
+	ScopedTimer enumerationTimer(this->metrics, DiscoveryPhase::DeviceEnumeration);
+	for (auto& fetch : fetches)
+	{
+		com_ptr<IWbemClassObject> device;
+		HRESULT result = fetch.CallResult->GetResultObject(WmiTimeoutMilliseconds, device.put());
+		if (result == WBEM_S_TIMEDOUT)
+		{
+			fetch.Activity.SetResult(WBEM_E_TIMED_OUT);
+			throw CreateError(L"timed out waiting for WMI to return the PnP device for adapter LUID " + std::to_wstring(fetch.Luid));
+		}
+		error = CheckHresult(result);
+		if (error)
+		{
+			fetch.Activity.SetError(error);
+			if (WmiConnection::IsDisconnectError(error.code)) {
+				throw error.Wrap(L"failed to retrieve the PnP device for adapter LUID " + std::to_wstring(fetch.Luid));
+			}
+			
+			// The device is not visible to WMI under the resolved instance ID, so fall back to the WQL query
+			LOG(L"Could not fetch the PnP device for adapter LUID {} directly, falling back to a WQL query: {}", fetch.Luid, error.message);
+			unresolved.insert(*adapters.find(fetch.Luid));
+			continue;
+		}
+		
+		pending.push_back(this->ExtractDeviceDetails(device));
+	}
+	
+	return unresolved;
+}
+
+void WmiQuery::ExecuteQuery(const wstring& query, vector<PendingDeviceDetails>& pending) const
+{
+	// Trace the query until all of its results have been retrieved, since semisynchronous queries do their work as results are enumerated
+	TraceActivity activity("ExecQuery", 0, {}, query);
+	
+	// Execute the query in semisynchronous mode, so we can impose a timeout when retrieving the results
+	com_ptr<IEnumWbemClassObject> enumerator;
+	DeviceDiscoveryError error;
+	{
+		ScopedTimer timer(this->metrics, DiscoveryPhase::DeviceQuery);
+		error = CheckHresult(this->connection->GetServices()->ExecQuery(
+			wil::make_bstr(L"WQL").get(),
+			wil::make_bstr(query.c_str()).get(),
+			WBEM_FLAG_FORWARD_ONLY | WBEM_FLAG_RETURN_IMMEDIATELY,
+			nullptr,
+			enumerator.put()
+		));
+		if (error)
+		{
+			activity.SetError(error);
+			throw error.Wrap(L"WQL query execution failed");
+		}
+	}
+	
+	// Retrieve the PnP devices in batches and start retrieving the device properties for each of them
+	// (Note that the property queries are executed concurrently, and we only wait for their results once all of the queries have been submitted)
+	ScopedTimer enumerationTimer(this->metrics, DiscoveryPhase::DeviceEnumeration);
+	while (true)
+	{
+		// Retrieve the next batch of devices
+		ULONG numReturned = 0;
+		IWbemClassObject* batch[EnumerationBatchSize] = {};
+		HRESULT result = enumerator->Next(WmiTimeoutMilliseconds, EnumerationBatchSize, batch, &numReturned);
+		
+		// Take ownership of all of the returned device objects before doing anything that can throw, so none of them are leaked
+		com_ptr<IWbemClassObject> devices[EnumerationBatchSize];
+		for (ULONG index = 0; index < numReturned; ++index) {
+			devices[index].attach(batch[index]);
+		}
+		
+		error = CheckHresult(result);
+		if (error)
+		{
+			activity.SetError(error);
+			throw error.Wrap(L"enumerating PnP devices failed");
+		}
+		
+		// Start retrieving the properties for each of the returned devices
+		for (ULONG index = 0; index < numReturned; ++index) {
+			pending.push_back(this->ExtractDeviceDetails(devices[index]));
+		}
+		
+		// Report an error if WMI failed to return results before the timeout
+		if (result == WBEM_S_TIMEDOUT)
+		{
+			activity.SetResult(WBEM_E_TIMED_OUT);
+			throw CreateError(L"timed out waiting for WMI to return PnP devices");
+		}
+		
+		// Stop once we have retrieved all of the devices
+		if (result == WBEM_S_FALSE || numReturned < EnumerationBatchSize) {
+			break;
+		}
+	}
+}
+
+WmiQuery::PendingDeviceDetails WmiQuery::ExtractDeviceDetails(const com_ptr<IWbemClassObject>& device) const
+{
+	PendingDeviceDetails pending;
+	Device& details = pending.Details;
 	DeviceDiscoveryError error;
 	
 	// Retrieve the unique PnP device ID of the device
@@ -203,7 +325,7 @@ Device WmiQuery::ExtractDeviceDetails(const com_ptr<IWbemClassObject>& device) c
 	if (error) {
 		throw error.Wrap(L"failed to retrieve DeviceID property of PnP device");
 	}
-	details.ID = winrt::to_hstring(vtDeviceID.bstrVal);
+	details.ID = BstrView(vtDeviceID.bstrVal);
 	
 	// Retrieve the human-readable description of the device
 	unique_variant vtDescription;
@@ -211,7 +333,7 @@ Device WmiQuery::ExtractDeviceDetails(const com_ptr<IWbemClassObject>& device) c
 	if (error) {
 		throw error.Wrap(L"failed to retrieve Description property of PnP device");
 	}
-	details.Description = winrt::to_hstring(vtDescription.bstrVal);
+	details.Description = BstrView(vtDescription.bstrVal);
 	
 	// Retrieve the vendor of the device
 	unique_variant vtVendor;
@@ -219,7 +341,7 @@ Device WmiQuery::ExtractDeviceDetails(const com_ptr<IWbemClassObject>& device) c
 	if (error) {
 		throw error.Wrap(L"failed to retrieve Manufacturer property of PnP device");
 	}
-	details.Vendor = winrt::to_hstring(vtVendor.bstrVal);
+	details.Vendor = BstrView(vtVendor.bstrVal);
 	
 	// Retrieve the object path for the instance so we can call instance methods with it
 	unique_variant vtPath;
@@ -230,7 +352,7 @@ Device WmiQuery::ExtractDeviceDetails(const com_ptr<IWbemClassObject>& device) c
 	
 	// Create an instance of the input parameters type for the `GetDeviceProperties` instance method
 	com_ptr<IWbemClassObject> inputArgs;
-	error = CheckHresult(this->inputParameters->SpawnInstance(0, inputArgs.put()));
+	error = CheckHresult(this->connection->GetInputParameters()->SpawnInstance(0, inputArgs.put()));
 	if (error) {
 		throw error.Wrap(L"failed to spawn input parameters instance for Win32_PnPEntity::GetDeviceProperties");
 	}
@@ -239,6 +361,7 @@ Device WmiQuery::ExtractDeviceDetails(const com_ptr<IWbemClassObject>& device) c
 	unique_variant vtPropertyKeys = SafeArrayFactory::CreateStringArray({
 		L"DEVPKEY_Device_Driver",
 		L"DEVPKEY_Device_LocationPaths",
+		L"DEVPKEY_Device_Numa_Node",
 		this->devPropKeyLUID
 	});
 	error = CheckHresult(inputArgs->Put(L"devicePropertyKeys", 0, &vtPropertyKeys, CIM_FLAG_ARRAY | CIM_STRING));
@@ -246,25 +369,50 @@ Device WmiQuery::ExtractDeviceDetails(const com_ptr<IWbemClassObject>& device) c
 		throw error.Wrap(L"failed to assign input parameters array for Win32_PnPEntity::GetDeviceProperties");
 	}
 	
-	// Call the `GetDeviceProperties` instance method
-	com_ptr<IWbemCallResult> callResult;
-	error = CheckHresult(this->wbemServices->ExecMethod(
+	// Call the `GetDeviceProperties` instance method in semisynchronous mode, so the call returns without waiting for the result
+	pending.Submitted = steady_clock::now();
+	pending.Activity.emplace("ExecMethod", 0, details.ID, L"Win32_PnPEntity::GetDeviceProperties");
+	error = CheckHresult(this->connection->GetServices()->ExecMethod(
 		vtPath.bstrVal,
 		wil::make_bstr(L"GetDeviceProperties").get(),
-		0,
+		WBEM_FLAG_RETURN_IMMEDIATELY,
 		nullptr,
 		inputArgs.get(),
 		nullptr,
-		callResult.put()
+		pending.CallResult.put()
 	));
-	if (error) {
+	if (error)
+	{
+		pending.Activity->SetError(error);
 		throw error.Wrap(L"failed to invoke Win32_PnPEntity::GetDeviceProperties()");
 	}
 	
-	// Retrieve the return value
+	// The method call remains outstanding after we return, so detach its activity before the caller submits calls for other devices
+	pending.Activity->Detach();
+	
+	return pending;
+}
+
+void WmiQuery::ExtractDeviceProperties(PendingDeviceDetails& pending) const
+{
+	Device& details = pending.Details;
+	DeviceDiscoveryError error;
+	
+	// Take ownership of the trace activity for the method call so it completes when we return
+	TraceActivity activity = std::move(*pending.Activity);
+	
+	// Wait for the return value of the `GetDeviceProperties` instance method
 	com_ptr<IWbemClassObject> returnValue;
-	error = CheckHresult(callResult->GetResultObject(WBEM_INFINITE, returnValue.put()));
-	if (error) {
+	HRESULT result = pending.CallResult->GetResultObject(WmiTimeoutMilliseconds, returnValue.put());
+	if (result == WBEM_S_TIMEDOUT)
+	{
+		activity.SetResult(WBEM_E_TIMED_OUT);
+		throw CreateError(L"timed out waiting for the return value of Win32_PnPEntity::GetDeviceProperties for PnP device " + details.ID);
+	}
+	error = CheckHresult(result);
+	if (error)
+	{
+		activity.SetError(error);
 		throw error.Wrap(L"failed to retrieve return value for Win32_PnPEntity::GetDeviceProperties");
 	}
 	
@@ -295,7 +443,7 @@ Device WmiQuery::ExtractDeviceDetails(const com_ptr<IWbemClassObject>& device) c
 		if (error) {
 			throw error.Wrap(L"failed to retrieve KeyName property of PnP device property");
 		}
-		wstring keyName(winrt::to_hstring(vtKeyName.bstrVal));
+		wstring_view keyName = BstrView(vtKeyName.bstrVal);
 		
 		// Attempt to retrieve the value of the property
 		unique_variant data;
@@ -315,9 +463,8 @@ Device WmiQuery::ExtractDeviceDetails(const com_ptr<IWbemClassObject>& device) c
 			}
 			
 			// Construct the full path to the registry key for the device's driver
-			details.DriverRegistryKey =
-				L"HKEY_LOCAL_MACHINE\\SYSTEM\\CurrentControlSet\\Control\\Class\\" +
-				winrt::to_hstring(data.bstrVal);
+			details.DriverRegistryKey = L"HKEY_LOCAL_MACHINE\\SYSTEM\\CurrentControlSet\\Control\\Class\\";
+			details.DriverRegistryKey.append(BstrView(data.bstrVal));
 		}
 		else if (keyName == L"DEVPKEY_Device_LocationPaths")
 		{
@@ -326,9 +473,20 @@ Device WmiQuery::ExtractDeviceDetails(const com_ptr<IWbemClassObject>& device) c
 				throw CreateError(L"LocationPaths value was not an array of strings");
 			}
 			
-			// Retrieve the first element from the LocationPaths array
+			// Retrieve the first element from the LocationPaths array, if it has any
 			SafeArrayIterator<BSTR> locationIterator(data.parray);
-			details.LocationPath = winrt::to_hstring(*locationIterator.begin());
+			if (locationIterator.size() > 0) {
+				details.LocationPath = BstrView(*locationIterator.begin());
+			}
+		}
+		else if (keyName == L"DEVPKEY_Device_Numa_Node")
+		{
+			// Verify that the NUMA node is of the expected type (WMI represents unsigned 32-bit integers as signed values)
+			if (data.vt != VT_I4 && data.vt != VT_UI4) {
+				throw CreateError(L"NUMA node value was not a 32-bit integer");
+			}
+			
+			details.NumaNode = data.lVal;
 		}
 		else if (keyName == this->devPropKeyLUID)
 		{
@@ -339,7 +497,7 @@ Device WmiQuery::ExtractDeviceDetails(const com_ptr<IWbemClassObject>& device) c
 			else if (data.vt == VT_BSTR)
 			{
 				// Parse the string back into a 64-bit integer
-				details.DeviceAdapter.InstanceLuid = std::stoll(winrt::to_string(data.bstrVal));
+				details.DeviceAdapter.InstanceLuid = ParsingHelpers::ParseLuidString(BstrView(data.bstrVal));
 			}
 			else {
 				throw CreateError(L"LUID value was not a 64-bit integer or a string");
@@ -347,5 +505,13 @@ Device WmiQuery::ExtractDeviceDetails(const com_ptr<IWbemClassObject>& device) c
 		}
 	}
 	
-	return details;
+	// Report the adapter LUID of the device in the trace activity's stop event
+	activity.SetAdapterLuid(details.DeviceAdapter.InstanceLuid);
+	
+	// Record the time taken to retrieve the device properties, measured from when the method call was submitted
+	this->metrics.Record(
+		DiscoveryPhase::DeviceProperties,
+		std::chrono::duration_cast<nanoseconds>(steady_clock::now() - pending.Submitted),
+		details.DeviceAdapter.InstanceLuid
+	);
 }
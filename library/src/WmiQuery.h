@@ -2,32 +2,81 @@
 
 #include "Adapter.h"
 #include "Device.h"
+#include "DeviceQuery.h"
+#include "MetricsRecorder.h"
+#include "TraceLogging.h"
+#include "WmiConnection.h"
+
+#include <optional>
 
 using std::map;
+using std::shared_ptr;
 using std::vector;
 using std::wstring;
 using winrt::com_ptr;
 
 // Provides functionality for querying Windows Management Instrumentation (WMI)
-class WmiQuery
+class WmiQuery : public DeviceQuery
 {
 	public:
 		
-		WmiQuery();
+		WmiQuery(MetricsRecorder& metrics);
 		
 		// Retrieves the device details for the underlying PnP devices associated with the supplied DirectX adapters
-		vector<Device> GetDevicesForAdapters(const map<int64_t, Adapter>& adapters);
+		vector<Device> GetDevicesForAdapters(const map<int64_t, Adapter>& adapters) override;
 		
 	private:
 		
-		// Extracts the details from a PnP device
-		Device ExtractDeviceDetails(const com_ptr<IWbemClassObject>& device) const;
+		// Retrieves the device details for the underlying PnP devices associated with the supplied DirectX adapters, using our current connection
+		vector<Device> QueryDevices(const map<int64_t, Adapter>& adapters) const;
+		
+		// Represents a PnP device whose properties are still being retrieved
+		struct PendingDeviceDetails
+		{
+			// The device details that have been extracted so far
+			Device Details;
+			
+			// The semisynchronous call result for the `GetDeviceProperties` instance method call
+			com_ptr<IWbemCallResult> CallResult;
+			
+			// The time at which the `GetDeviceProperties` instance method call was submitted
+			steady_clock::time_point Submitted;
+			
+			// The trace activity for the `GetDeviceProperties` instance method call, which completes once its properties have been extracted
+			std::optional<TraceActivity> Activity;
+		};
+		
+		// Represents a Win32_PnPEntity instance that is still being retrieved by its key
+		struct PendingDeviceFetch
+		{
+			// The LUID of the adapter whose PnP device is being retrieved
+			int64_t Luid;
+			
+			// The semisynchronous call result for the `GetObject` call
+			com_ptr<IWbemCallResult> CallResult;
+			
+			// The trace activity for the `GetObject` call, which completes once the instance has been retrieved
+			TraceActivity Activity;
+		};
+		
+		// Retrieves the PnP devices for the supplied adapters directly by their device instance IDs and starts retrieving their device properties,
+		// returning any adapters whose devices could not be retrieved this way
+		map<int64_t, Adapter> FetchDevicesByKey(const map<int64_t, Adapter>& adapters, vector<PendingDeviceDetails>& pending) const;
+		
+		// Executes the supplied WQL query and starts retrieving the device properties for each of the PnP devices that it returns
+		void ExecuteQuery(const wstring& query, vector<PendingDeviceDetails>& pending) const;
+		
+		// Extracts the basic details from a PnP device and starts retrieving its device properties
+		PendingDeviceDetails ExtractDeviceDetails(const com_ptr<IWbemClassObject>& device) const;
+		
+		// Waits for the device properties of a PnP device to be retrieved and extracts them
+		void ExtractDeviceProperties(PendingDeviceDetails& pending) const;
+		
+		// The metrics recorder used to time our queries
+		MetricsRecorder& metrics;
 		
-		// Our COM objects for communicating with WMI
-		com_ptr<IWbemLocator> wbemLocator;
-		com_ptr<IWbemServices> wbemServices;
-		com_ptr<IWbemClassObject> pnpEntityClass;
-		com_ptr<IWbemClassObject> inputParameters;
+		// Our connection to the WMI service, which is shared with other WmiQuery objects
+		shared_ptr<WmiConnection> connection;
 		
 		// The string identifier for the DEVPROPKEY_GPU_LUID device property key
 		wstring devPropKeyLUID;
@@ -3,6 +3,7 @@
 #include <wil/result.h>
 #include <wil/win32_helpers.h>
 #include <winrt/base.h>
+#include <cfgmgr32.h>
 #include <d3dkmthk.h>
 #include <d3dukmdt.h>
 #include <dxcore.h>
@@ -0,0 +1,349 @@
+#include "DeviceDiscovery.h"
+
+#include <windows.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+using std::endl;
+using std::map;
+using std::string;
+using std::vector;
+using std::wclog;
+using std::wstring;
+
+// The results for an individual benchmark phase
+struct PhaseResult
+{
+	string Name;
+	vector<double> Milliseconds;
+	unsigned long long Allocations = 0;
+	map<int, unsigned long long> LibraryCalls;
+};
+
+// Converts a UTF-16 string to UTF-8
+string ToUtf8(const wstring& value)
+{
+	if (value.empty()) {
+		return "";
+	}
+	
+	int size = WideCharToMultiByte(CP_UTF8, 0, value.c_str(), static_cast<int>(value.size()), nullptr, 0, nullptr, nullptr);
+	string converted(size, '\0');
+	WideCharToMultiByte(CP_UTF8, 0, value.c_str(), static_cast<int>(value.size()), converted.data(), size, nullptr, nullptr);
+	return converted;
+}
+
+// Formats a UTF-16 string as a quoted JSON string
+string JsonString(const wstring& value)
+{
+	std::ostringstream stream;
+	stream << '"';
+	for (char c : ToUtf8(value))
+	{
+		switch (c)
+		{
+			case '"':
+				stream << "\\\"";
+				break;
+				
+			case '\\':
+				stream << "\\\\";
+				break;
+				
+			case '\n':
+				stream << "\\n";
+				break;
+				
+			case '\r':
+				stream << "\\r";
+				break;
+				
+			case '\t':
+				stream << "\\t";
+				break;
+				
+			default:
+				if (static_cast<unsigned char>(c) < 0x20)
+				{
+					char escaped[8];
+					snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+					stream << escaped;
+				}
+				else {
+					stream << c;
+				}
+		}
+	}
+	
+	stream << '"';
+	return stream.str();
+}
+
+// Computes the specified percentile of a list of samples using the nearest-rank method
+double Percentile(vector<double> samples, double percentile)
+{
+	if (samples.empty()) {
+		return 0.0;
+	}
+	
+	std::sort(samples.begin(), samples.end());
+	size_t rank = static_cast<size_t>(std::ceil(percentile * samples.size()));
+	return samples[std::clamp<size_t>(rank, 1, samples.size()) - 1];
+}
+
+// Retrieves the number of times each discovery phase has been timed by the library, aggregated across all devices
+map<int, unsigned long long> GetLibraryCallCounts(DeviceDiscovery& discovery)
+{
+	vector<DiscoveryMetricsRecord> records(discovery.GetMetrics(nullptr, 0));
+	records.resize(discovery.GetMetrics(records.data(), static_cast<unsigned int>(records.size())));
+	
+	map<int, unsigned long long> counts;
+	for (const auto& record : records)
+	{
+		if (record.AdapterLuid == 0) {
+			counts[record.Phase] = record.Count;
+		}
+	}
+	
+	return counts;
+}
+
+// Runs a single iteration of a benchmark phase and records its duration, allocations and library call counts
+void RunIteration(PhaseResult& result, DeviceDiscovery& discovery, const std::function<void()>& function)
+{
+	// Capture the library counters before running the iteration
+	map<int, unsigned long long> callsBefore = GetLibraryCallCounts(discovery);
+	unsigned long long allocationsBefore = GetDiscoveryAllocationCount();
+	
+	// Time the iteration
+	auto start = std::chrono::steady_clock::now();
+	function();
+	auto end = std::chrono::steady_clock::now();
+	
+	// Capture the library counters after running the iteration and accumulate the differences
+	unsigned long long allocationsAfter = GetDiscoveryAllocationCount();
+	map<int, unsigned long long> callsAfter = GetLibraryCallCounts(discovery);
+	result.Milliseconds.push_back(std::chrono::duration<double, std::milli>(end - start).count());
+	result.Allocations += allocationsAfter - allocationsBefore;
+	for (const auto& [phase, count] : callsAfter) {
+		result.LibraryCalls[phase] += count - callsBefore[phase];
+	}
+}
+
+// Reads every field for every device through the per-field accessor functions, as the plugins did prior to device snapshots
+void ReadAllFields(DeviceDiscovery& discovery)
+{
+	int numDevices = discovery.GetNumDevices();
+	for (int device = 0; device < numDevices; ++device)
+	{
+		discovery.GetDeviceAdapterLUID(device);
+		discovery.GetDeviceID(device);
+		discovery.GetDeviceDescription(device);
+		discovery.GetDeviceDriverRegistryKey(device);
+		discovery.GetDeviceDriverStorePath(device);
+		discovery.GetDeviceLocationPath(device);
+		discovery.GetDeviceVendor(device);
+		discovery.IsDeviceIntegrated(device);
+		discovery.IsDeviceDetachable(device);
+		discovery.DoesDeviceSupportDisplay(device);
+		discovery.DoesDeviceSupportCompute(device);
+		
+		int numRuntimeFiles = discovery.GetNumRuntimeFiles(device);
+		for (int file = 0; file < numRuntimeFiles; ++file)
+		{
+			discovery.GetRuntimeFileSource(device, file);
+			discovery.GetRuntimeFileDestination(device, file);
+		}
+		
+		int numRuntimeFilesWow64 = discovery.GetNumRuntimeFilesWow64(device);
+		for (int file = 0; file < numRuntimeFilesWow64; ++file)
+		{
+			discovery.GetRuntimeFileSourceWow64(device, file);
+			discovery.GetRuntimeFileDestinationWow64(device, file);
+		}
+	}
+}
+
+// Formats the results for a benchmark phase as a JSON object
+string FormatPhaseResult(const PhaseResult& result)
+{
+	size_t iterations = result.Milliseconds.size();
+	std::ostringstream stream;
+	stream << "\t\t{\n";
+	stream << "\t\t\t\"name\": \"" << result.Name << "\",\n";
+	stream << "\t\t\t\"iterations\": " << iterations << ",\n";
+	stream << "\t\t\t\"p50Milliseconds\": " << Percentile(result.Milliseconds, 0.50) << ",\n";
+	stream << "\t\t\t\"p99Milliseconds\": " << Percentile(result.Milliseconds, 0.99) << ",\n";
+	stream << "\t\t\t\"minMilliseconds\": " << *std::min_element(result.Milliseconds.begin(), result.Milliseconds.end()) << ",\n";
+	stream << "\t\t\t\"maxMilliseconds\": " << *std::max_element(result.Milliseconds.begin(), result.Milliseconds.end()) << ",\n";
+	stream << "\t\t\t\"allocationsPerIteration\": " << (static_cast<double>(result.Allocations) / iterations) << ",\n";
+	stream << "\t\t\t\"libraryCallsPerIteration\": {";
+	
+	// Include the number of times each library phase was executed, which reflects the number of underlying COM and kernel calls
+	bool first = true;
+	for (const auto& [phase, count] : result.LibraryCalls)
+	{
+		stream << (first ? "\n" : ",\n");
+		stream << "\t\t\t\t" << JsonString(DiscoveryPhaseName(static_cast<DiscoveryPhase>(phase))) << ": " << (static_cast<double>(count) / iterations);
+		first = false;
+	}
+	
+	stream << (first ? "}\n" : "\n\t\t\t}\n");
+	stream << "\t\t}";
+	return stream.str();
+}
+
+// Parses the value of a command-line argument of the form "--name=value", returning false if the argument does not match
+bool ParseArgument(const wstring& arg, const wstring& name, wstring& value)
+{
+	wstring prefix = L"--" + name + L"=";
+	if (arg.rfind(prefix, 0) != 0) {
+		return false;
+	}
+	
+	value = arg.substr(prefix.size());
+	return true;
+}
+
+int wmain(int argc, wchar_t *argv[], wchar_t *envp[])
+{
+	// Parse our command-line arguments
+	DiscoveryBackend backend = DiscoveryBackend::Wmi;
+	int iterations = 20;
+	int pollsPerIteration = 100;
+	wstring outputFile;
+	for (int i = 1; i < argc; ++i)
+	{
+		wstring arg = argv[i];
+		wstring value;
+		if (arg == L"--verbose") {
+			EnableDiscoveryLogging();
+		}
+		else if (arg == L"--backend=configmanager") {
+			backend = DiscoveryBackend::ConfigManager;
+		}
+		else if (arg == L"--backend=d3dkmt") {
+			backend = DiscoveryBackend::D3DKMT;
+		}
+		else if (ParseArgument(arg, L"iterations", value)) {
+			iterations = std::max(_wtoi(value.c_str()), 1);
+		}
+		else if (ParseArgument(arg, L"polls", value)) {
+			pollsPerIteration = std::max(_wtoi(value.c_str()), 1);
+		}
+		else if (ParseArgument(arg, L"output", value)) {
+			outputFile = value;
+		}
+		else
+		{
+			wclog << L"Usage: " << argv[0] << L" [--verbose] [--backend=configmanager|--backend=d3dkmt] [--iterations=N] [--polls=N] [--output=FILE]" << endl;
+			return 1;
+		}
+	}
+	
+	try
+	{
+		vector<PhaseResult> results;
+		
+		// Measure cold device discovery, using a new DeviceDiscovery instance for each iteration
+		PhaseResult cold;
+		cold.Name = "cold_discover";
+		for (int i = 0; i < iterations; ++i)
+		{
+			DeviceDiscovery discovery(backend);
+			RunIteration(cold, discovery, [&]() { discovery.DiscoverDevices(DeviceFilter::AllDevices, true, true); });
+		}
+		results.push_back(cold);
+		
+		// Perform an initial device discovery for the warm measurements, which is excluded from the results
+		DeviceDiscovery discovery(backend);
+		discovery.DiscoverDevices(DeviceFilter::AllDevices, true, true);
+		
+		// Measure warm device discovery, reusing the existing DeviceDiscovery instance
+		PhaseResult warm;
+		warm.Name = "warm_discover";
+		for (int i = 0; i < iterations; ++i) {
+			RunIteration(warm, discovery, [&]() { discovery.DiscoverDevices(DeviceFilter::AllDevices, true, true); });
+		}
+		results.push_back(warm);
+		
+		// Measure polling for refresh requirements, batching polls within each iteration since individual polls are too short to time accurately
+		PhaseResult polling;
+		polling.Name = "refresh_poll";
+		for (int i = 0; i < iterations; ++i)
+		{
+			RunIteration(polling, discovery, [&]()
+			{
+				for (int poll = 0; poll < pollsPerIteration; ++poll) {
+					discovery.IsRefreshRequired();
+				}
+			});
+		}
+		results.push_back(polling);
+		
+		// Measure retrieving all device details through the per-field accessor functions
+		PhaseResult accessors;
+		accessors.Name = "field_accessors";
+		for (int i = 0; i < iterations; ++i) {
+			RunIteration(accessors, discovery, [&]() { ReadAllFields(discovery); });
+		}
+		results.push_back(accessors);
+		
+		// Format the results as JSON, including the details of each device so results can be compared across driver versions
+		std::ostringstream json;
+		json << "{\n";
+		json << "\t\"libraryVersion\": " << JsonString(GetDiscoveryLibraryVersion()) << ",\n";
+		json << "\t\"backend\": " << JsonString(DiscoveryBackendName(backend)) << ",\n";
+		json << "\t\"pollsPerIteration\": " << pollsPerIteration << ",\n";
+		json << "\t\"devices\": [";
+		int numDevices = discovery.GetNumDevices();
+		for (int device = 0; device < numDevices; ++device)
+		{
+			json << ((device > 0) ? ",\n" : "\n");
+			json << "\t\t{\n";
+			json << "\t\t\t\"id\": " << JsonString(discovery.GetDeviceID(device)) << ",\n";
+			json << "\t\t\t\"description\": " << JsonString(discovery.GetDeviceDescription(device)) << ",\n";
+			json << "\t\t\t\"vendor\": " << JsonString(discovery.GetDeviceVendor(device)) << ",\n";
+			json << "\t\t\t\"driverStorePath\": " << JsonString(discovery.GetDeviceDriverStorePath(device)) << "\n";
+			json << "\t\t}";
+		}
+		json << ((numDevices > 0) ? "\n\t],\n" : "],\n");
+		json << "\t\"phases\": [\n";
+		for (size_t index = 0; index < results.size(); ++index) {
+			json << FormatPhaseResult(results[index]) << ((index + 1 < results.size()) ? ",\n" : "\n");
+		}
+		json << "\t]\n";
+		json << "}\n";
+		
+		// Write the results to the output file if one was specified, or to stdout otherwise
+		if (!outputFile.empty())
+		{
+			std::ofstream output(outputFile, std::ios::binary);
+			output << json.str();
+			if (!output)
+			{
+				wclog << L"Error: failed to write results to " << outputFile << endl;
+				return 1;
+			}
+		}
+		else {
+			std::cout << json.str();
+		}
+	}
+	catch (const DeviceDiscoveryException& err)
+	{
+		wclog << L"Error: " << err.what() << endl;
+		return 1;
+	}
+	
+	return 0;
+}
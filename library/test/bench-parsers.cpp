@@ -0,0 +1,456 @@
+// Benchmarks and fuzzes the string parsing code of the device discovery library against the synthetic sample data in parser-corpus.h.
+// The parsing code is compiled directly into this executable, since it is internal to the library and has no dependencies on
+// the system's devices, so the results can be reproduced on machines without GPUs.
+
+#include "AllocationCounter.h"
+#include "ParsingHelpers.h"
+#include "SafeArray.h"
+#include "parser-corpus.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cerrno>
+#include <cmath>
+#include <cwchar>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <iterator>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+using std::endl;
+using std::string;
+using std::vector;
+using std::wclog;
+using std::wstring;
+using std::wstring_view;
+
+// The results for an individual benchmark phase
+struct PhaseResult
+{
+	string Name;
+	vector<double> Nanoseconds;
+	unsigned long long Allocations = 0;
+	unsigned long long Items = 0;
+};
+
+// Computes the specified percentile of a list of samples using the nearest-rank method
+double Percentile(vector<double> samples, double percentile)
+{
+	if (samples.empty()) {
+		return 0.0;
+	}
+	
+	std::sort(samples.begin(), samples.end());
+	size_t rank = static_cast<size_t>(std::ceil(percentile * samples.size()));
+	return samples[std::clamp<size_t>(rank, 1, samples.size()) - 1];
+}
+
+// Runs a single iteration of a benchmark phase, which parses the specified number of items, and records its duration and allocations
+void RunIteration(PhaseResult& result, unsigned long long items, const std::function<void()>& function)
+{
+	unsigned long long allocationsBefore = AllocationCounter::GetCount();
+	auto start = std::chrono::steady_clock::now();
+	function();
+	auto end = std::chrono::steady_clock::now();
+	unsigned long long allocationsAfter = AllocationCounter::GetCount();
+	
+	result.Nanoseconds.push_back(std::chrono::duration<double, std::nano>(end - start).count() / items);
+	result.Allocations += allocationsAfter - allocationsBefore;
+	result.Items += items;
+}
+
+// Formats the results for a benchmark phase as a JSON object
+string FormatPhaseResult(const PhaseResult& result)
+{
+	std::ostringstream stream;
+	stream << "\t\t{\n";
+	stream << "\t\t\t\"name\": \"" << result.Name << "\",\n";
+	stream << "\t\t\t\"iterations\": " << result.Nanoseconds.size() << ",\n";
+	stream << "\t\t\t\"p50NanosecondsPerItem\": " << Percentile(result.Nanoseconds, 0.50) << ",\n";
+	stream << "\t\t\t\"p99NanosecondsPerItem\": " << Percentile(result.Nanoseconds, 0.99) << ",\n";
+	stream << "\t\t\t\"itemsPerSecond\": " << (1e9 / std::max(Percentile(result.Nanoseconds, 0.50), 1e-3)) << ",\n";
+	stream << "\t\t\t\"allocationsPerItem\": " << (static_cast<double>(result.Allocations) / std::max<unsigned long long>(result.Items, 1)) << "\n";
+	stream << "\t\t}";
+	return stream.str();
+}
+
+// Parses a REG_MULTI_SZ value as the library did prior to bounding each string by the size of the value data
+// (This is only used as a baseline for the benchmark, since it reads beyond the end of malformed values)
+vector<wstring> LegacyExtractMultiStringValue(const wchar_t* data, size_t numBytes)
+{
+	vector<wstring> strings;
+	
+	size_t offset = 0;
+	size_t upperBound = numBytes / sizeof(wchar_t);
+	while (offset < upperBound)
+	{
+		wstring nextString(data + offset);
+		if (nextString.size() == 0) { break; }
+		
+		strings.push_back(nextString);
+		offset += strings.back().size() + 1;
+	}
+	
+	return strings;
+}
+
+// Parses a LUID string as the library did prior to parsing it directly from the BSTR
+int64_t LegacyParseLuidString(BSTR value) {
+	return std::stoll(winrt::to_string(value));
+}
+
+// Creates a SAFEARRAY of BSTR strings from the supplied array sample
+unique_variant CreateStringArray(const wchar_t* const* elements, size_t numElements)
+{
+	unique_variant vtArray;
+	vtArray.vt = VT_ARRAY | VT_BSTR;
+	vtArray.parray = SafeArrayCreateVector(VT_BSTR, 0, static_cast<ULONG>(numElements));
+	if (vtArray.parray == nullptr) {
+		throw CreateError(L"SafeArrayCreateVector failed");
+	}
+	
+	for (LONG index = 0; index < static_cast<LONG>(numElements); ++index)
+	{
+		// Note that SafeArrayPutElement copies the supplied BSTR, so we retain ownership of our temporary copy
+		auto element = wil::make_bstr(elements[index]);
+		auto error = CheckHresult(SafeArrayPutElement(vtArray.parray, &index, element.get()));
+		if (error) {
+			throw error.Wrap(L"SafeArrayPutElement failed");
+		}
+	}
+	
+	return vtArray;
+}
+
+// Retrieves the first element of a LocationPaths array, as the WMI backend does
+wstring ExtractFirstLocationPath(SAFEARRAY* array)
+{
+	SafeArrayIterator<BSTR> iterator(array);
+	if (iterator.size() == 0) {
+		return L"";
+	}
+	
+	BSTR first = *iterator.begin();
+	return wstring(first, SysStringLen(first));
+}
+
+// Accumulates the failures detected by the regression and fuzzing checks
+struct CheckResults
+{
+	unsigned long long Cases = 0;
+	vector<string> Failures;
+	
+	void Check(bool condition, const string& description)
+	{
+		this->Cases++;
+		if (!condition && this->Failures.size() < 100) {
+			this->Failures.push_back(description);
+		}
+	}
+};
+
+// Verifies that each corpus sample parses to the expected results
+void RunRegressionChecks(CheckResults& results)
+{
+	for (const auto& sample : MultiStringSamples)
+	{
+		auto strings = ParsingHelpers::ExtractMultiStringValue(sample.Data, sample.NumBytes);
+		results.Check(strings.size() == sample.ExpectedStrings, string("multi-string count mismatch for ") + sample.Name);
+		results.Check(strings == LegacyExtractMultiStringValue(sample.Data, sample.NumBytes), string("multi-string legacy mismatch for ") + sample.Name);
+	}
+	
+	for (const auto& sample : LuidSamples)
+	{
+		try
+		{
+			int64_t luid = ParsingHelpers::ParseLuidString(sample.Value);
+			results.Check(sample.Valid && luid == sample.Expected, string("LUID value mismatch for ") + sample.Name);
+		}
+		catch (const DeviceDiscoveryError&) {
+			results.Check(!sample.Valid, string("LUID parsing failed for ") + sample.Name);
+		}
+	}
+	
+	for (const auto& sample : StringArraySamples)
+	{
+		auto vtArray = CreateStringArray(sample.Elements, sample.NumElements);
+		SafeArrayIterator<BSTR> iterator(vtArray.parray);
+		results.Check(iterator.size() == sample.NumElements, string("string array size mismatch for ") + sample.Name);
+		
+		size_t index = 0;
+		for (BSTR element : iterator)
+		{
+			results.Check(index < sample.NumElements && wstring_view(element, SysStringLen(element)) == sample.Elements[index], string("string array element mismatch for ") + sample.Name);
+			index++;
+		}
+		
+		wstring expected = (sample.NumElements > 0) ? sample.Elements[0] : L"";
+		results.Check(ExtractFirstLocationPath(vtArray.parray) == expected, string("first location path mismatch for ") + sample.Name);
+	}
+}
+
+// Parses a REG_MULTI_SZ value that is known to be terminated, for use as the reference implementation when fuzzing
+vector<wstring> ReferenceExtractMultiStringValue(const vector<wchar_t>& data, size_t numChars)
+{
+	// Copy the characters that are within bounds and append a terminating empty string, so the unbounded parser cannot overrun
+	vector<wchar_t> terminated(data.begin(), data.begin() + numChars);
+	terminated.push_back(L'\0');
+	terminated.push_back(L'\0');
+	return LegacyExtractMultiStringValue(terminated.data(), terminated.size() * sizeof(wchar_t));
+}
+
+// Applies random mutations to the corpus samples and verifies that the parsers never read beyond the end of the supplied data,
+// produce the same results as a reference implementation, and only report malformed data through the library's error type
+void RunFuzzChecks(CheckResults& results, unsigned int seed, int mutationsPerSample)
+{
+	std::mt19937 generator(seed);
+	
+	for (const auto& sample : MultiStringSamples)
+	{
+		vector<wchar_t> original(sample.Data, sample.Data + (sample.NumBytes / sizeof(wchar_t)));
+		for (int mutation = 0; mutation < mutationsPerSample; ++mutation)
+		{
+			// Overwrite a random selection of characters, favouring NUL separators since they determine the string boundaries
+			vector<wchar_t> mutated = original;
+			int numEdits = std::uniform_int_distribution<int>(0, 4)(generator);
+			for (int edit = 0; edit < numEdits && !mutated.empty(); ++edit)
+			{
+				size_t position = std::uniform_int_distribution<size_t>(0, mutated.size() - 1)(generator);
+				mutated[position] = (generator() % 2 == 0) ? L'\0' : static_cast<wchar_t>(std::uniform_int_distribution<int>(1, 0xFFFF)(generator));
+			}
+			
+			// Truncate the data at a random byte offset, which may split a character or remove the terminators entirely
+			size_t numBytes = std::uniform_int_distribution<size_t>(0, mutated.size() * sizeof(wchar_t))(generator);
+			size_t numChars = numBytes / sizeof(wchar_t);
+			
+			// Copy the data into an allocation of exactly the truncated size, so any overrun is caught by the debug heap or page heap
+			std::unique_ptr<wchar_t[]> exact(new wchar_t[std::max<size_t>(numChars, 1)]);
+			std::copy(mutated.begin(), mutated.begin() + numChars, exact.get());
+			
+			auto strings = ParsingHelpers::ExtractMultiStringValue(exact.get(), numBytes);
+			results.Check(strings == ReferenceExtractMultiStringValue(mutated, numChars), string("fuzzed multi-string mismatch for ") + sample.Name);
+		}
+	}
+	
+	for (const auto& sample : LuidSamples)
+	{
+		wstring original = sample.Value;
+		for (int mutation = 0; mutation < mutationsPerSample; ++mutation)
+		{
+			// Replace, insert or remove random characters, drawing from the characters that are significant to the parser
+			static const wchar_t alphabet[] = L"0123456789-+ \tx";
+			wstring mutated = original;
+			int numEdits = std::uniform_int_distribution<int>(1, 3)(generator);
+			for (int edit = 0; edit < numEdits; ++edit)
+			{
+				size_t position = std::uniform_int_distribution<size_t>(0, mutated.size())(generator);
+				wchar_t c = alphabet[generator() % (sizeof(alphabet) / sizeof(wchar_t) - 1)];
+				switch (generator() % 3)
+				{
+					case 0:
+						mutated.insert(mutated.begin() + position, c);
+						break;
+					
+					case 1:
+						if (position < mutated.size()) { mutated[position] = c; }
+						break;
+					
+					default:
+						if (position < mutated.size()) { mutated.erase(position, 1); }
+				}
+			}
+			
+			// Determine the expected result using the CRT's parser, which follows the same rules for whitespace, signs and overflow
+			errno = 0;
+			wchar_t* end = nullptr;
+			long long expected = wcstoll(mutated.c_str(), &end, 10);
+			bool valid = (end != mutated.c_str() && errno != ERANGE);
+			
+			try
+			{
+				int64_t luid = ParsingHelpers::ParseLuidString(mutated);
+				results.Check(valid && luid == expected, "fuzzed LUID mismatch for \"" + winrt::to_string(mutated) + "\"");
+			}
+			catch (const DeviceDiscoveryError&) {
+				results.Check(!valid, "fuzzed LUID parsing failed for \"" + winrt::to_string(mutated) + "\"");
+			}
+		}
+	}
+}
+
+// Parses a command-line argument of the form "--name=value", returning false if the argument does not match
+bool ParseArgument(const wstring& arg, const wstring& name, wstring& value)
+{
+	wstring prefix = L"--" + name + L"=";
+	if (arg.rfind(prefix, 0) != 0) {
+		return false;
+	}
+	
+	value = arg.substr(prefix.size());
+	return true;
+}
+
+int wmain(int argc, wchar_t *argv[], wchar_t *envp[])
+{
+	// Parse our command-line arguments
+	int iterations = 50;
+	int repetitions = 1000;
+	int mutations = 2000;
+	unsigned int seed = 1;
+	wstring outputFile;
+	for (int i = 1; i < argc; ++i)
+	{
+		wstring arg = argv[i];
+		wstring value;
+		if (ParseArgument(arg, L"iterations", value)) {
+			iterations = std::max(_wtoi(value.c_str()), 1);
+		}
+		else if (ParseArgument(arg, L"repetitions", value)) {
+			repetitions = std::max(_wtoi(value.c_str()), 1);
+		}
+		else if (ParseArgument(arg, L"mutations", value)) {
+			mutations = std::max(_wtoi(value.c_str()), 0);
+		}
+		else if (ParseArgument(arg, L"seed", value)) {
+			seed = static_cast<unsigned int>(wcstoul(value.c_str(), nullptr, 10));
+		}
+		else if (ParseArgument(arg, L"output", value)) {
+			outputFile = value;
+		}
+		else
+		{
+			wclog << L"Usage: " << argv[0] << L" [--iterations=N] [--repetitions=N] [--mutations=N] [--seed=N] [--output=FILE]" << endl;
+			return 1;
+		}
+	}
+	
+	try
+	{
+		// Verify the parsers against the corpus and against randomly mutated samples before measuring them
+		CheckResults checks;
+		RunRegressionChecks(checks);
+		RunFuzzChecks(checks, seed, mutations);
+		
+		// Build the BSTR and SAFEARRAY representations of the samples up front, so their construction is excluded from the results
+		vector<wil::unique_bstr> luidStrings;
+		for (const auto& sample : LuidSamples)
+		{
+			if (sample.Valid) {
+				luidStrings.push_back(wil::make_bstr(sample.Value));
+			}
+		}
+		vector<unique_variant> stringArrays;
+		for (const auto& sample : StringArraySamples) {
+			stringArrays.push_back(CreateStringArray(sample.Elements, sample.NumElements));
+		}
+		
+		// The number of items parsed by each iteration of each phase
+		unsigned long long numMultiStrings = std::size(MultiStringSamples) * static_cast<unsigned long long>(repetitions);
+		unsigned long long numLuids = luidStrings.size() * static_cast<unsigned long long>(repetitions);
+		unsigned long long numArrays = stringArrays.size() * static_cast<unsigned long long>(repetitions);
+		
+		// The phases that we measure, along with the function that performs a single repetition of each
+		// (A running total of the results is kept so the compiler cannot discard the parsing work)
+		size_t total = 0;
+		vector< std::pair< string, std::function<void()> > > phases = {
+			{ "extract_multi_string", [&]() {
+				for (const auto& sample : MultiStringSamples) {
+					total += ParsingHelpers::ExtractMultiStringValue(sample.Data, sample.NumBytes).size();
+				}
+			}},
+			{ "extract_multi_string_legacy", [&]() {
+				for (const auto& sample : MultiStringSamples) {
+					total += LegacyExtractMultiStringValue(sample.Data, sample.NumBytes).size();
+				}
+			}},
+			{ "parse_luid", [&]() {
+				for (const auto& value : luidStrings) {
+					total += static_cast<size_t>(ParsingHelpers::ParseLuidString(wstring_view(value.get(), SysStringLen(value.get()))));
+				}
+			}},
+			{ "parse_luid_legacy", [&]() {
+				for (const auto& value : luidStrings) {
+					total += static_cast<size_t>(LegacyParseLuidString(value.get()));
+				}
+			}},
+			{ "safearray_location_paths", [&]() {
+				for (const auto& vtArray : stringArrays) {
+					total += ExtractFirstLocationPath(vtArray.parray).size();
+				}
+			}}
+		};
+		vector<unsigned long long> itemsPerIteration = { numMultiStrings, numMultiStrings, numLuids, numLuids, numArrays };
+		
+		// Measure each phase
+		vector<PhaseResult> results;
+		for (size_t phase = 0; phase < phases.size(); ++phase)
+		{
+			PhaseResult result;
+			result.Name = phases[phase].first;
+			for (int i = 0; i < iterations; ++i)
+			{
+				RunIteration(result, itemsPerIteration[phase], [&]()
+				{
+					for (int repetition = 0; repetition < repetitions; ++repetition) {
+						phases[phase].second();
+					}
+				});
+			}
+			
+			results.push_back(result);
+		}
+		
+		// Format the results as JSON, including the outcome of the checks so regressions are visible alongside the measurements
+		std::ostringstream json;
+		json << "{\n";
+		json << "\t\"corpus\": \"synthetic\",\n";
+		json << "\t\"repetitionsPerIteration\": " << repetitions << ",\n";
+		json << "\t\"checksum\": " << total << ",\n";
+		json << "\t\"checks\": {\n";
+		json << "\t\t\"seed\": " << seed << ",\n";
+		json << "\t\t\"mutationsPerSample\": " << mutations << ",\n";
+		json << "\t\t\"cases\": " << checks.Cases << ",\n";
+		json << "\t\t\"failures\": " << checks.Failures.size() << "\n";
+		json << "\t},\n";
+		json << "\t\"phases\": [\n";
+		for (size_t index = 0; index < results.size(); ++index) {
+			json << FormatPhaseResult(results[index]) << ((index + 1 < results.size()) ? ",\n" : "\n");
+		}
+		json << "\t]\n";
+		json << "}\n";
+		
+		// Write the results to the output file if one was specified, or to stdout otherwise
+		if (!outputFile.empty())
+		{
+			std::ofstream output(outputFile, std::ios::binary);
+			output << json.str();
+			if (!output)
+			{
+				wclog << L"Error: failed to write results to " << outputFile << endl;
+				return 1;
+			}
+		}
+		else {
+			std::cout << json.str();
+		}
+		
+		// Report any check failures and treat them as an error, so the benchmark can be used to guard against regressions
+		for (const auto& failure : checks.Failures) {
+			std::clog << "Check failed: " << failure << endl;
+		}
+		if (!checks.Failures.empty()) {
+			return 1;
+		}
+	}
+	catch (const DeviceDiscoveryError& err)
+	{
+		wclog << L"Error: " << err.Pretty() << endl;
+		return 1;
+	}
+	
+	return 0;
+}
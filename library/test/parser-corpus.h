@@ -0,0 +1,151 @@
+#pragma once
+
+// The synthetic sample data used by the parser benchmark. These samples were written by hand to follow the formats of the values that
+// NVIDIA, AMD and Intel display drivers report, rather than being captured from real systems, so the filenames, device instance IDs,
+// location paths and LUIDs are illustrative and may not match those reported by any particular driver version or device. They exist so the
+// parsers can be exercised with representative data on machines that have no GPUs (or no GPUs from a given vendor).
+//
+// Each REG_MULTI_SZ sample is written as a wide string literal with embedded NUL separators. The terminating NUL of the literal
+// itself provides the empty string that terminates the list, so the size of the literal is exactly the size of the registry value data.
+
+#include <stddef.h>
+#include <stdint.h>
+
+// A raw REG_MULTI_SZ value or DEVPROP_TYPE_STRING_LIST property
+struct MultiStringSample
+{
+	// The name of the sample, in the form "vendor/source/value"
+	const char* Name;
+	
+	// The raw value data and its size in bytes
+	const wchar_t* Data;
+	size_t NumBytes;
+	
+	// The number of strings that the value contains
+	size_t ExpectedStrings;
+};
+
+#define MULTI_SZ(name, data, expected) { name, data, sizeof(data), expected }
+
+inline const MultiStringSample MultiStringSamples[] =
+{
+	// The runtime file lists under the CopyToVm* keys of the driver registry key, each of which lists a source and a destination filename
+	MULTI_SZ("nvidia/CopyToVmOverwrite/nvcuda", L"nvcuda64.dll\0nvcuda.dll\0", 2),
+	MULTI_SZ("nvidia/CopyToVmOverwrite/nvcuvid", L"nvcuvid64.dll\0nvcuvid.dll\0", 2),
+	MULTI_SZ("nvidia/CopyToVmOverwrite/nvEncodeAPI", L"nvEncodeAPI64.dll\0nvEncodeAPI64.dll\0", 2),
+	MULTI_SZ("nvidia/CopyToVmOverwrite/nvapi", L"nvapi64.dll\0nvapi64.dll\0", 2),
+	MULTI_SZ("nvidia/CopyToVmOverwrite/nvml", L"nvml.dll\0nvml.dll\0", 2),
+	MULTI_SZ("nvidia/CopyToVmOverwrite/nvofapi", L"nvofapi64.dll\0nvofapi64.dll\0", 2),
+	MULTI_SZ("nvidia/CopyToVmOverwriteWow64/nvcuda", L"nvcuda32.dll\0nvcuda.dll\0", 2),
+	MULTI_SZ("nvidia/CopyToVmOverwriteWow64/nvcuvid", L"nvcuvid32.dll\0nvcuvid.dll\0", 2),
+	MULTI_SZ("nvidia/CopyToVmOverwriteWow64/nvEncodeAPI", L"nvEncodeAPI.dll\0nvEncodeAPI.dll\0", 2),
+	MULTI_SZ("amd/CopyToVmOverwrite/amdxc64", L"amdxc64.dll\0amdxc64.dll\0", 2),
+	MULTI_SZ("amd/CopyToVmOverwrite/amdihk64", L"amdihk64.dll\0amdihk64.dll\0", 2),
+	MULTI_SZ("amd/CopyToVmOverwrite/amf-rt64", L"amfrt64.dll\0amfrt64.dll\0", 2),
+	MULTI_SZ("amd/CopyToVmOverwrite/amdocl64", L"amdocl64.dll\0amdocl64.dll\0", 2),
+	MULTI_SZ("amd/CopyToVmOverwrite/atiadlxx", L"atiadlxx.dll\0atiadlxx.dll\0", 2),
+	MULTI_SZ("amd/CopyToVmOverwriteWow64/amdxc32", L"amdxc32.dll\0amdxc32.dll\0", 2),
+	MULTI_SZ("amd/CopyToVmOverwriteWow64/amf-rt32", L"amfrt32.dll\0amfrt32.dll\0", 2),
+	MULTI_SZ("intel/CopyToVmOverwrite/igdgmm64", L"igdgmm64.dll\0igdgmm64.dll\0", 2),
+	MULTI_SZ("intel/CopyToVmOverwrite/igc64", L"igc64.dll\0igc64.dll\0", 2),
+	MULTI_SZ("intel/CopyToVmOverwrite/intelocl64", L"intelocl64.dll\0intelocl64.dll\0", 2),
+	MULTI_SZ("intel/CopyToVmOverwrite/ze_intel_gpu64", L"ze_intel_gpu64.dll\0ze_intel_gpu64.dll\0", 2),
+	MULTI_SZ("intel/CopyToVmWhenNewer/libmfxhw64", L"libmfxhw64.dll\0libmfxhw64.dll\0", 2),
+	MULTI_SZ("intel/CopyToVmWhenNewer/mfxplugin64_hw", L"mfxplugin64_hw.dll\0mfxplugin64_hw.dll\0", 2),
+	MULTI_SZ("intel/CopyToVmOverwriteWow64/igdgmm32", L"igdgmm32.dll\0igdgmm32.dll\0", 2),
+	MULTI_SZ("intel/CopyToVmOverwriteWow64/igc32", L"igc32.dll\0igc32.dll\0", 2),
+	
+	// The DEVPKEY_Device_LocationPaths property of discrete and integrated display adapters, which lists both the PCI and ACPI paths to each device
+	MULTI_SZ(
+		"nvidia/DEVPKEY_Device_LocationPaths/discrete",
+		L"PCIROOT(0)#PCI(0100)#PCI(0000)\0ACPI(_SB_)#ACPI(PCI0)#ACPI(PEG0)#ACPI(PEGP)\0",
+		2
+	),
+	MULTI_SZ(
+		"amd/DEVPKEY_Device_LocationPaths/discrete",
+		L"PCIROOT(0)#PCI(0301)#PCI(0000)#PCI(0000)#PCI(0000)\0ACPI(_SB_)#ACPI(PCI0)#ACPI(GPP8)#ACPI(SWUS)#ACPI(SWDS)#ACPI(VGA_)\0",
+		2
+	),
+	MULTI_SZ(
+		"intel/DEVPKEY_Device_LocationPaths/integrated",
+		L"PCIROOT(0)#PCI(0200)\0ACPI(_SB_)#ACPI(PCI0)#ACPI(GFX0)\0",
+		2
+	),
+	
+	// The device instance ID lists returned by the PnP Configuration Manager for the display adapter device interface class
+	MULTI_SZ(
+		"mixed/CM_Get_Device_Interface_List/display-adapters",
+		L"PCI\\VEN_10DE&DEV_2204&SUBSYS_38801462&REV_A1\\4&2283F625&0&0019\0"
+		L"PCI\\VEN_1002&DEV_73BF&SUBSYS_0E3A1002&REV_C1\\6&1B7A6D9&0&00000019\0"
+		L"PCI\\VEN_8086&DEV_4680&SUBSYS_7D251462&REV_0C\\3&11583659&0&10\0",
+		3
+	),
+	MULTI_SZ(
+		"nvidia/CM_Get_Device_Interface_List/multi-gpu",
+		L"PCI\\VEN_10DE&DEV_20B5&SUBSYS_153310DE&REV_A1\\6&2E0F9E3B&0&00400000\0"
+		L"PCI\\VEN_10DE&DEV_20B5&SUBSYS_153310DE&REV_A1\\6&33A6C1D5&0&00400008\0"
+		L"PCI\\VEN_10DE&DEV_20B5&SUBSYS_153310DE&REV_A1\\6&1F0C3A77&0&00400010\0"
+		L"PCI\\VEN_10DE&DEV_20B5&SUBSYS_153310DE&REV_A1\\6&5B9D2E01&0&00400018\0",
+		4
+	),
+	MULTI_SZ("microsoft/CM_Get_Device_Interface_List/basic-render", L"ROOT\\BasicRender\\0000\0", 1),
+	
+	// An empty list, as reported by a value with no strings
+	MULTI_SZ("empty/list", L"", 0)
+};
+
+#undef MULTI_SZ
+
+// The string representations of adapter LUIDs, as reported by WMI for the DEVPKEY_Device_AdapterLuid property
+struct LuidSample
+{
+	// The name of the sample
+	const char* Name;
+	
+	// The string representation of the LUID
+	const wchar_t* Value;
+	
+	// Specifies whether the string is expected to parse successfully, and the value it represents if so
+	bool Valid;
+	int64_t Expected;
+};
+
+inline const LuidSample LuidSamples[] =
+{
+	{ "nvidia/discrete", L"89352", true, 89352 },
+	{ "amd/discrete", L"104674", true, 104674 },
+	{ "intel/integrated", L"61606", true, 61606 },
+	{ "microsoft/basic-render", L"58643", true, 58643 },
+	{ "high-part/set", L"4294995554", true, 4294995554LL },
+	{ "high-bit/set", L"-9223372036854775808", true, INT64_MIN },
+	{ "maximum", L"9223372036854775807", true, INT64_MAX },
+	{ "leading-whitespace", L"  61606", true, 61606 },
+	{ "trailing-characters", L"61606 ", true, 61606 },
+	{ "overflow", L"9223372036854775808", false, 0 },
+	{ "empty", L"", false, 0 },
+	{ "non-numeric", L"{00000000-0000-0000-0000-000000000000}", false, 0 },
+	{ "sign-only", L"-", false, 0 }
+};
+
+// The DEVPKEY_Device_LocationPaths arrays reported by WMI, which are parsed from SAFEARRAYs of BSTR strings
+struct StringArraySample
+{
+	// The name of the sample
+	const char* Name;
+	
+	// The array elements
+	const wchar_t* const* Elements;
+	size_t NumElements;
+};
+
+inline const wchar_t* const LocationPathsNvidia[] = { L"PCIROOT(0)#PCI(0100)#PCI(0000)", L"ACPI(_SB_)#ACPI(PCI0)#ACPI(PEG0)#ACPI(PEGP)" };
+inline const wchar_t* const LocationPathsAmd[] = { L"PCIROOT(0)#PCI(0301)#PCI(0000)#PCI(0000)#PCI(0000)", L"ACPI(_SB_)#ACPI(PCI0)#ACPI(GPP8)#ACPI(SWUS)#ACPI(SWDS)#ACPI(VGA_)" };
+inline const wchar_t* const LocationPathsIntel[] = { L"PCIROOT(0)#PCI(0200)", L"ACPI(_SB_)#ACPI(PCI0)#ACPI(GFX0)" };
+
+inline const StringArraySample StringArraySamples[] =
+{
+	{ "nvidia/discrete", LocationPathsNvidia, 2 },
+	{ "amd/discrete", LocationPathsAmd, 2 },
+	{ "intel/integrated", LocationPathsIntel, 2 },
+	{ "empty", nullptr, 0 }
+};
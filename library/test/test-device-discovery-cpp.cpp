@@ -28,13 +28,23 @@ int wmain(int argc, wchar_t *argv[], wchar_t *envp[])
 		EnableDiscoveryLogging();
 	}
 	
+	// Use the Configuration Manager or D3DKMT discovery backend instead of WMI if it has been requested
+	DiscoveryBackend backend = DiscoveryBackend::Wmi;
+	if (std::find(args.begin(), args.end(), L"--backend=configmanager") != args.end()) {
+		backend = DiscoveryBackend::ConfigManager;
+	}
+	else if (std::find(args.begin(), args.end(), L"--backend=d3dkmt") != args.end()) {
+		backend = DiscoveryBackend::D3DKMT;
+	}
+	
 	try
 	{
 		// Perform device discovery
-		DeviceDiscovery discovery;
+		DeviceDiscovery discovery(backend);
 		discovery.DiscoverDevices(DeviceFilter::AllDevices, true, true);
 		int numDevices = discovery.GetNumDevices();
 		wcout << L"DirectX device discovery library version " << GetDiscoveryLibraryVersion() << endl;
+		wcout << L"Using discovery backend " << DiscoveryBackendName(backend) << endl;
 		wcout << L"Discovered " << numDevices << L" devices.\n" << endl;
 		
 		// Print the details for each device
@@ -48,6 +58,12 @@ int wmain(int argc, wchar_t *argv[], wchar_t *envp[])
 			wcout << L"DriverStore Path:    " << discovery.GetDeviceDriverStorePath(device) << L"\n";
 			wcout << L"LocationPath:        " << discovery.GetDeviceLocationPath(device) << L"\n";
 			wcout << L"Vendor:              " << discovery.GetDeviceVendor(device) << L"\n";
+			wcout << L"PCIe Root:           " << discovery.GetDevicePcieRoot(device) << L"\n";
+			wcout << L"NUMA Node:           " << discovery.GetDeviceNumaNode(device) << L"\n";
+			wcout << L"Driver Version:      " << discovery.GetDeviceDriverVersion(device) << L"\n";
+			wcout << L"KMD Model Version:   " << discovery.GetDeviceKmdModelVersion(device) << L"\n";
+			wcout << L"Dedicated Memory:    " << discovery.GetDeviceDedicatedMemory(device) << L" bytes\n";
+			wcout << L"Shared Memory:       " << discovery.GetDeviceSharedMemory(device) << L" bytes\n";
 			wcout << L"Is Integrated:       " << FormatBoolean(discovery.IsDeviceIntegrated(device)) << L"\n";
 			wcout << L"Is Detachable:       " << FormatBoolean(discovery.IsDeviceDetachable(device)) << L"\n";
 			wcout << L"Supports Display:    " << FormatBoolean(discovery.DoesDeviceSupportDisplay(device)) << L"\n";
@@ -73,6 +89,21 @@ int wmain(int argc, wchar_t *argv[], wchar_t *envp[])
 			
 			wcout << endl;
 		}
+		
+		// Print the number of devices that match each device filter, as reported by the library's filtered snapshots
+		vector<DeviceFilter> filters = {
+			DeviceFilter::DisplaySupported,
+			DeviceFilter::ComputeSupported,
+			DeviceFilter::DisplayOnly,
+			DeviceFilter::ComputeOnly,
+			DeviceFilter::DisplayAndCompute
+		};
+		for (auto filter : filters)
+		{
+			DeviceDiscoverySnapshot snapshot = discovery.AcquireFilteredSnapshot(filter, true, true);
+			wcout << L"Devices matching filter " << DeviceFilterName(filter) << L": " << DeviceDiscoverySnapshot_GetNumDevices(snapshot) << L"\n";
+			DeviceDiscovery_ReleaseSnapshot(snapshot);
+		}
 	}
 	catch (const DeviceDiscoveryException& err) {
 		wclog << L"Error: " << err.what() << endl;
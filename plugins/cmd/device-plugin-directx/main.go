@@ -0,0 +1,15 @@
+//go:build windows
+
+package main
+
+import (
+	"github.com/tensorworks/directx-device-plugins/plugins/internal/discovery"
+	"github.com/tensorworks/directx-device-plugins/plugins/internal/plugin"
+)
+
+func main() {
+	plugin.SharedMain("directx", []plugin.PluginResource{
+		{PluginName: "wddm", ResourceName: "directx.microsoft.com/display", Filter: discovery.DisplayAndCompute},
+		{PluginName: "mcdm", ResourceName: "directx.microsoft.com/compute", Filter: discovery.ComputeOnly},
+	})
+}
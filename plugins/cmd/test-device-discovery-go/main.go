@@ -14,8 +14,15 @@ func main() {
 
 	// Parse our command-line arguments
 	verbose := flag.Bool("verbose", false, "enable verbose logging")
+	backendName := flag.String("backend", "wmi", "the discovery backend to use (\"wmi\", \"configmanager\" or \"d3dkmt\")")
 	flag.Parse()
 
+	// Verify that a valid discovery backend was specified
+	backend, err := discovery.ParseDiscoveryBackend(*backendName)
+	if err != nil {
+		log.Fatalln("Error:", err)
+	}
+
 	// Attempt to load the DirectX device discovery library
 	if err := discovery.LoadDiscoveryLibrary(); err != nil {
 		log.Fatalln("Error:", err)
@@ -26,8 +33,8 @@ func main() {
 		discovery.EnableDiscoveryLogging()
 	}
 
-	// Create a new DeviceDiscovery object
-	deviceDiscovery, err := discovery.NewDeviceDiscovery()
+	// Create a new DeviceDiscovery object that uses the specified discovery backend
+	deviceDiscovery, err := discovery.NewDeviceDiscoveryWithBackend(backend)
 	if err != nil {
 		log.Fatalln("Error:", err)
 	}
@@ -39,6 +46,7 @@ func main() {
 
 	// Print the library version string and the number of discovered devices
 	fmt.Print("DirectX device discovery library version ", discovery.GetDiscoveryLibraryVersion(), "\n")
+	fmt.Print("Using discovery backend ", *backendName, "\n")
 	fmt.Print("Discovered ", len(deviceDiscovery.Devices), " devices.\n\n")
 
 	// Print the details for each device
@@ -51,6 +59,12 @@ func main() {
 		fmt.Println("DriverStore Path:   ", device.DriverStorePath)
 		fmt.Println("LocationPath:       ", device.LocationPath)
 		fmt.Println("Vendor:             ", device.Vendor)
+		fmt.Println("PCIe Root:          ", device.PcieRoot)
+		fmt.Println("NUMA Node:          ", device.NumaNode)
+		fmt.Println("Driver Version:     ", device.DriverVersion)
+		fmt.Println("KMD Model Version:  ", device.KmdModelVersion)
+		fmt.Println("Dedicated Memory:   ", device.DedicatedMemory, "bytes")
+		fmt.Println("Shared Memory:      ", device.SharedMemory, "bytes")
 		fmt.Println("Is Integrated:      ", device.IsIntegrated)
 		fmt.Println("Is Detachable:      ", device.IsDetachable)
 		fmt.Println("Supports Display:   ", device.SupportsDisplay)
@@ -68,4 +82,24 @@ func main() {
 
 		fmt.Print("\n")
 	}
+
+	// Print the number of devices that match each device filter, as reported by the library's filtered snapshots
+	filters := []struct {
+		name   string
+		filter discovery.DeviceFilter
+	}{
+		{"DisplaySupported", discovery.DisplaySupported},
+		{"ComputeSupported", discovery.ComputeSupported},
+		{"DisplayOnly", discovery.DisplayOnly},
+		{"ComputeOnly", discovery.ComputeOnly},
+		{"DisplayAndCompute", discovery.DisplayAndCompute},
+	}
+	for _, entry := range filters {
+		filtered, err := deviceDiscovery.GetFilteredDevices(entry.filter, true, true)
+		if err != nil {
+			log.Fatalln("Error:", err)
+		}
+
+		fmt.Print("Devices matching filter ", entry.name, ": ", len(filtered), "\n")
+	}
 }
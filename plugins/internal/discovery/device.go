@@ -2,6 +2,10 @@
 
 package discovery
 
+// The NUMA node value reported for devices that do not report the NUMA node to which they are attached
+// (this must match the value of DEVICE_NUMA_NODE_UNKNOWN defined in DeviceSnapshot.h in the device discovery library)
+const NumaNodeUnknown int32 = -2
+
 // Represents a DirectX device
 type Device struct {
 
@@ -29,6 +33,24 @@ type Device struct {
 	// The vendor of the device (e.g. AMD, Intel, NVIDIA)
 	Vendor string
 
+	// The PCIe root complex under which the device is located (e.g. "PCIROOT(0)"), or an empty string if unknown
+	PcieRoot string
+
+	// The NUMA node to which the device is attached, or NumaNodeUnknown if the device does not report one
+	NumaNode int32
+
+	// The version number of the device's driver
+	DriverVersion uint64
+
+	// The WDDM or MCDM version of the device's kernel-mode driver, as a D3DKMT_DRIVERVERSION value (e.g. 3000 for WDDM 3.0)
+	KmdModelVersion uint32
+
+	// The number of bytes of dedicated adapter memory that are not shared with the CPU
+	DedicatedMemory uint64
+
+	// The number of bytes of system memory that can be shared between the device and the CPU
+	SharedMemory uint64
+
 	// The DirectX adapter LUID associated with the PnP device
 	AdapterLUID int64
 
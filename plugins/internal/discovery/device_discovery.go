@@ -5,6 +5,8 @@ package discovery
 import (
 	"errors"
 	"fmt"
+	"runtime"
+	"unicode/utf16"
 	"unsafe"
 
 	"golang.org/x/sys/windows"
@@ -15,10 +17,14 @@ var (
 	procGetDiscoveryLibraryVersion     = discoverydll.NewProc("GetDiscoveryLibraryVersion")
 	procDisableDiscoveryLogging        = discoverydll.NewProc("DisableDiscoveryLogging")
 	procEnableDiscoveryLogging         = discoverydll.NewProc("EnableDiscoveryLogging")
+	procEnableDiscoveryLogBuffer       = discoverydll.NewProc("EnableDiscoveryLogBuffer")
+	procDrainDiscoveryLog              = discoverydll.NewProc("DrainDiscoveryLog")
 	procCreateDeviceDiscoveryInstance  = discoverydll.NewProc("CreateDeviceDiscoveryInstance")
+	procCreateInstanceWithBackend      = discoverydll.NewProc("CreateDeviceDiscoveryInstanceWithBackend")
 	procDestroyDeviceDiscoveryInstance = discoverydll.NewProc("DestroyDeviceDiscoveryInstance")
 	procGetLastErrorMessage            = discoverydll.NewProc("DeviceDiscovery_GetLastErrorMessage")
 	procIsRefreshRequired              = discoverydll.NewProc("DeviceDiscovery_IsRefreshRequired")
+	procGetRefreshEventHandle          = discoverydll.NewProc("DeviceDiscovery_GetRefreshEventHandle")
 	procDiscoverDevices                = discoverydll.NewProc("DeviceDiscovery_DiscoverDevices")
 	procGetNumDevices                  = discoverydll.NewProc("DeviceDiscovery_GetNumDevices")
 	procGetDeviceAdapterLUID           = discoverydll.NewProc("DeviceDiscovery_GetDeviceAdapterLUID")
@@ -28,6 +34,12 @@ var (
 	procGetDeviceDriverStorePath       = discoverydll.NewProc("DeviceDiscovery_GetDeviceDriverStorePath")
 	procGetDeviceLocationPath          = discoverydll.NewProc("DeviceDiscovery_GetDeviceLocationPath")
 	procGetDeviceVendor                = discoverydll.NewProc("DeviceDiscovery_GetDeviceVendor")
+	procGetDevicePcieRoot              = discoverydll.NewProc("DeviceDiscovery_GetDevicePcieRoot")
+	procGetDeviceNumaNode              = discoverydll.NewProc("DeviceDiscovery_GetDeviceNumaNode")
+	procGetDeviceDriverVersion         = discoverydll.NewProc("DeviceDiscovery_GetDeviceDriverVersion")
+	procGetDeviceKmdModelVersion       = discoverydll.NewProc("DeviceDiscovery_GetDeviceKmdModelVersion")
+	procGetDeviceDedicatedMemory       = discoverydll.NewProc("DeviceDiscovery_GetDeviceDedicatedMemory")
+	procGetDeviceSharedMemory          = discoverydll.NewProc("DeviceDiscovery_GetDeviceSharedMemory")
 	procGetNumRuntimeFiles             = discoverydll.NewProc("DeviceDiscovery_GetNumRuntimeFiles")
 	procGetRuntimeFileSource           = discoverydll.NewProc("DeviceDiscovery_GetRuntimeFileSource")
 	procGetRuntimeFileDestination      = discoverydll.NewProc("DeviceDiscovery_GetRuntimeFileDestination")
@@ -38,6 +50,17 @@ var (
 	procIsDeviceDetachable             = discoverydll.NewProc("DeviceDiscovery_IsDeviceDetachable")
 	procDoesDeviceSupportDisplay       = discoverydll.NewProc("DeviceDiscovery_DoesDeviceSupportDisplay")
 	procDoesDeviceSupportCompute       = discoverydll.NewProc("DeviceDiscovery_DoesDeviceSupportCompute")
+	procGetDeviceString                = discoverydll.NewProc("DeviceDiscovery_GetDeviceString")
+	procGetRuntimeFileString           = discoverydll.NewProc("DeviceDiscovery_GetRuntimeFileString")
+	procGetSnapshot                    = discoverydll.NewProc("DeviceDiscovery_GetSnapshot")
+	procSetCacheFile                   = discoverydll.NewProc("DeviceDiscovery_SetCacheFile")
+	procGetMetrics                     = discoverydll.NewProc("DeviceDiscovery_GetMetrics")
+	procGetDeviceUsage                 = discoverydll.NewProc("DeviceDiscovery_GetDeviceUsage")
+	procCheckDeviceHealth              = discoverydll.NewProc("DeviceDiscovery_CheckDeviceHealth")
+	procAcquireSnapshot                = discoverydll.NewProc("DeviceDiscovery_AcquireSnapshot")
+	procAcquireFilteredSnapshot        = discoverydll.NewProc("DeviceDiscovery_AcquireFilteredSnapshot")
+	procReleaseSnapshot                = discoverydll.NewProc("DeviceDiscovery_ReleaseSnapshot")
+	procGetSnapshotData                = discoverydll.NewProc("DeviceDiscoverySnapshot_GetData")
 )
 
 type DeviceDiscovery struct {
@@ -47,6 +70,9 @@ type DeviceDiscovery struct {
 
 	// The list of discovered devices
 	Devices []*Device
+
+	// The buffer used to receive device snapshots, which is reused between device discovery operations
+	snapshot []byte
 }
 
 // Attempts to load the DirectX device discovery library and returns an error if loading fails
@@ -90,6 +116,20 @@ func NewDeviceDiscovery() (*DeviceDiscovery, error) {
 	}, nil
 }
 
+func NewDeviceDiscoveryWithBackend(backend DiscoveryBackend) (*DeviceDiscovery, error) {
+
+	// Attempt to create a DeviceDiscovery instance that uses the specified backend
+	result, _, _ := procCreateInstanceWithBackend.Call(uintptr(backend))
+	if result == 0 {
+		return nil, fmt.Errorf("failed to create the DeviceDiscovery instance for discovery backend %d", backend)
+	}
+
+	return &DeviceDiscovery{
+		handle:  result,
+		Devices: []*Device{},
+	}, nil
+}
+
 func (d *DeviceDiscovery) Destroy() {
 	procDestroyDeviceDiscoveryInstance.Call(d.handle)
 }
@@ -112,6 +152,15 @@ func (d *DeviceDiscovery) handleBooleanResult(result uintptr, r2 uintptr, lastEr
 	return result == 1, nil
 }
 
+// Handles the result of a library function that returns a signed 32-bit integer
+func (d *DeviceDiscovery) handleInt32Result(result uintptr, r2 uintptr, lastError error) (int32, error) {
+	if int32(result) == -1 {
+		return 0, d.getLastErrorMessage()
+	}
+
+	return int32(result), nil
+}
+
 // Handles the result of a library function that returns an unsigned 32-bit integer
 func (d *DeviceDiscovery) handleUint32Result(result uintptr, r2 uintptr, lastError error) (uint32, error) {
 	if int32(result) == -1 {
@@ -139,7 +188,39 @@ func (d *DeviceDiscovery) handleStringResult(result uintptr, r2 uintptr, lastErr
 	return windows.UTF16PtrToString((*uint16)(unsafe.Pointer(result))), nil
 }
 
-// Retrieves the error message for the last library function call
+// Handles the result of a library function that returns a UTF-16 string along with its length, decoding it without scanning for the NUL terminator
+func (d *DeviceDiscovery) handleCountedStringResult(result uintptr, length uint32) (string, error) {
+	if result == 0 {
+		return "", d.getLastErrorMessage()
+	}
+
+	return string(utf16.Decode(unsafe.Slice((*uint16)(unsafe.Pointer(result)), length))), nil
+}
+
+// Retrieves a string property of a device, using the length-returning accessor if the library supports it and the supplied legacy accessor otherwise
+func (d *DeviceDiscovery) getDeviceString(device int, property stringProperty, legacy *windows.LazyProc) (string, error) {
+	if procGetDeviceString.Find() != nil {
+		return d.handleStringResult(legacy.Call(d.handle, uintptr(device)))
+	}
+
+	var length uint32
+	result, _, _ := procGetDeviceString.Call(d.handle, uintptr(device), uintptr(property), uintptr(unsafe.Pointer(&length)))
+	return d.handleCountedStringResult(result, length)
+}
+
+// Retrieves a string property of a runtime file, using the length-returning accessor if the library supports it and the supplied legacy accessor otherwise
+func (d *DeviceDiscovery) getRuntimeFileString(device int, file int, property stringProperty, legacy *windows.LazyProc) (string, error) {
+	if procGetRuntimeFileString.Find() != nil {
+		return d.handleStringResult(legacy.Call(d.handle, uintptr(device), uintptr(file)))
+	}
+
+	var length uint32
+	result, _, _ := procGetRuntimeFileString.Call(d.handle, uintptr(device), uintptr(file), uintptr(property), uintptr(unsafe.Pointer(&length)))
+	return d.handleCountedStringResult(result, length)
+}
+
+// Retrieves the error message for the last failed library function call, which must have been made from the current OS thread
+// (Callers must therefore pin their goroutine with runtime.LockOSThread across the failed call and this one)
 func (d *DeviceDiscovery) getLastErrorMessage() error {
 
 	// Retrieve the last error message from the library and convert it to a Go error
@@ -150,18 +231,45 @@ func (d *DeviceDiscovery) getLastErrorMessage() error {
 		return errors.New(errorMessage)
 	}
 
-	return nil
+	// The call failed even though the library provided no message, so we still need to report an error
+	return errors.New("the device discovery library reported an error without providing an error message")
 }
 
 // Performs device discovery and populates our list of devices
 func (d *DeviceDiscovery) DiscoverDevices(filter DeviceFilter, includeIntegrated bool, includeDetachable bool) error {
 
+	// Pin the goroutine to its OS thread until we return, so any error message is retrieved for the thread that made the failed call
+	runtime.LockOSThread()
+	defer runtime.UnlockOSThread()
+
 	// Attempt to perform device discovery
 	result, _, _ := procDiscoverDevices.Call(d.handle, uintptr(filter), d.booleanArgument(includeIntegrated), d.booleanArgument(includeDetachable))
 	if int32(result) == -1 {
 		return d.getLastErrorMessage()
 	}
 
+	// Read the details of all devices directly from an immutable snapshot if the library supports snapshot handles
+	if procAcquireSnapshot.Find() == nil {
+		devices, err := d.readSnapshotHandle()
+		if err != nil {
+			return err
+		}
+
+		d.Devices = devices
+		return nil
+	}
+
+	// Otherwise, retrieve the details of all devices in a single call if the library supports device snapshots
+	if procGetSnapshot.Find() == nil {
+		devices, err := d.getSnapshot()
+		if err != nil {
+			return err
+		}
+
+		d.Devices = devices
+		return nil
+	}
+
 	// Determine the number of discovered devices
 	numDevices, err := d.getNumDevices()
 	if err != nil {
@@ -187,6 +295,81 @@ func (d *DeviceDiscovery) DiscoverDevices(filter DeviceFilter, includeIntegrated
 	return nil
 }
 
+// Retrieves the details for all devices by parsing the data of a snapshot handle in place, without copying it into our own buffer
+// (The library keeps the snapshot data alive until the handle is released, irrespective of any device discovery performed in the meantime)
+func (d *DeviceDiscovery) readSnapshotHandle() ([]*Device, error) {
+
+	// Acquire a handle to the current snapshot
+	snapshot, _, _ := procAcquireSnapshot.Call(d.handle)
+	if snapshot == 0 {
+		return nil, d.getLastErrorMessage()
+	}
+
+	return d.parseSnapshotHandle(snapshot)
+}
+
+// Retrieves the details for the subset of the devices found by the last device discovery whose adapters match the supplied filtering criteria
+// (The filtering is performed by the device discovery library, so the results are consistent with performing device discovery using the same criteria)
+func (d *DeviceDiscovery) GetFilteredDevices(filter DeviceFilter, includeIntegrated bool, includeDetachable bool) ([]*Device, error) {
+
+	// Pin the goroutine to its OS thread until we return, so any error message is retrieved for the thread that made the failed call
+	runtime.LockOSThread()
+	defer runtime.UnlockOSThread()
+
+	// Verify that the library supports filtered snapshots
+	if procAcquireFilteredSnapshot.Find() != nil {
+		return nil, errors.New("the device discovery library does not support filtered device snapshots")
+	}
+
+	// Acquire a handle to a filtered snapshot of the current device list
+	snapshot, _, _ := procAcquireFilteredSnapshot.Call(d.handle, uintptr(filter), d.booleanArgument(includeIntegrated), d.booleanArgument(includeDetachable))
+	if snapshot == 0 {
+		return nil, d.getLastErrorMessage()
+	}
+
+	return d.parseSnapshotHandle(snapshot)
+}
+
+// Parses the data of a snapshot handle in place and then releases the handle
+func (d *DeviceDiscovery) parseSnapshotHandle(snapshot uintptr) ([]*Device, error) {
+	defer procReleaseSnapshot.Call(snapshot)
+
+	// Retrieve the snapshot data and parse it while we still hold the handle
+	var size uint32
+	data, _, _ := procGetSnapshotData.Call(snapshot, uintptr(unsafe.Pointer(&size)))
+	if data == 0 || size == 0 {
+		return nil, errors.New("device snapshot handle did not provide any data")
+	}
+
+	return parseDeviceSnapshot(unsafe.Slice((*byte)(unsafe.Pointer(data)), size))
+}
+
+// Retrieves the details for all devices from a device snapshot
+func (d *DeviceDiscovery) getSnapshot() ([]*Device, error) {
+	for {
+
+		// Attempt to copy the snapshot into our existing buffer
+		var buffer uintptr
+		if len(d.snapshot) > 0 {
+			buffer = uintptr(unsafe.Pointer(&d.snapshot[0]))
+		}
+		size, err := d.handleUint32Result(
+			procGetSnapshot.Call(d.handle, buffer, uintptr(len(d.snapshot))),
+		)
+		if err != nil {
+			return nil, err
+		}
+
+		// If our buffer was too small then grow it to the required size and try again
+		if int(size) > len(d.snapshot) {
+			d.snapshot = make([]byte, size)
+			continue
+		}
+
+		return parseDeviceSnapshot(d.snapshot[:size])
+	}
+}
+
 // Retrieves the details for an individual device
 func (d *DeviceDiscovery) getDevice(device int) (*Device, error) {
 
@@ -226,6 +409,42 @@ func (d *DeviceDiscovery) getDevice(device int) (*Device, error) {
 		return nil, err
 	}
 
+	// Attempt to retrieve the PCIe root complex of the device
+	pcieRoot, err := d.getDevicePcieRoot(device)
+	if err != nil {
+		return nil, err
+	}
+
+	// Attempt to retrieve the NUMA node of the device
+	numaNode, err := d.getDeviceNumaNode(device)
+	if err != nil {
+		return nil, err
+	}
+
+	// Attempt to retrieve the device driver version
+	driverVersion, err := d.getDeviceDriverVersion(device)
+	if err != nil {
+		return nil, err
+	}
+
+	// Attempt to retrieve the kernel-mode driver model version of the device
+	kmdModelVersion, err := d.getDeviceKmdModelVersion(device)
+	if err != nil {
+		return nil, err
+	}
+
+	// Attempt to retrieve the dedicated memory size of the device
+	dedicatedMemory, err := d.getDeviceDedicatedMemory(device)
+	if err != nil {
+		return nil, err
+	}
+
+	// Attempt to retrieve the shared memory size of the device
+	sharedMemory, err := d.getDeviceSharedMemory(device)
+	if err != nil {
+		return nil, err
+	}
+
 	// Attempt to retrieve the device adapter LUID
 	luid, err := d.getDeviceAdapterLUID(device)
 	if err != nil {
@@ -324,6 +543,12 @@ func (d *DeviceDiscovery) getDevice(device int) (*Device, error) {
 		RuntimeFiles:      runtimeFiles,
 		RuntimeFilesWow64: runtimeFilesWow64,
 		Vendor:            vendor,
+		PcieRoot:          pcieRoot,
+		NumaNode:          numaNode,
+		DriverVersion:     uint64(driverVersion),
+		KmdModelVersion:   uint32(kmdModelVersion),
+		DedicatedMemory:   uint64(dedicatedMemory),
+		SharedMemory:      uint64(sharedMemory),
 		AdapterLUID:       luid,
 		IsIntegrated:      integrated,
 		IsDetachable:      detachable,
@@ -334,11 +559,43 @@ func (d *DeviceDiscovery) getDevice(device int) (*Device, error) {
 
 // Wrapper function for DeviceDiscovery_IsRefreshRequired
 func (d *DeviceDiscovery) IsRefreshRequired() (bool, error) {
+	// Pin the goroutine to its OS thread until we return, so any error message is retrieved for the thread that made the failed call
+	runtime.LockOSThread()
+	defer runtime.UnlockOSThread()
+
 	return d.handleBooleanResult(
 		procIsRefreshRequired.Call(d.handle),
 	)
 }
 
+// Wrapper function for DeviceDiscovery_GetRefreshEventHandle
+// (The returned handle is owned by the DeviceDiscovery object and must not be closed, and is zero if refresh notifications are unavailable)
+func (d *DeviceDiscovery) GetRefreshEventHandle() windows.Handle {
+	result, _, _ := procGetRefreshEventHandle.Call(d.handle)
+	return windows.Handle(result)
+}
+
+// Wrapper function for DeviceDiscovery_SetCacheFile
+func (d *DeviceDiscovery) SetCacheFile(path string) error {
+
+	// Pin the goroutine to its OS thread until we return, so any error message is retrieved for the thread that made the failed call
+	runtime.LockOSThread()
+	defer runtime.UnlockOSThread()
+
+	// Convert the path to a UTF-16 string
+	pathUTF16, err := windows.UTF16PtrFromString(path)
+	if err != nil {
+		return err
+	}
+
+	result, _, _ := procSetCacheFile.Call(d.handle, uintptr(unsafe.Pointer(pathUTF16)))
+	if int32(result) == -1 {
+		return d.getLastErrorMessage()
+	}
+
+	return nil
+}
+
 // Wrapper function for DeviceDiscovery_GetNumDevices
 func (d *DeviceDiscovery) getNumDevices() (uint32, error) {
 	return d.handleUint32Result(
@@ -355,43 +612,71 @@ func (d *DeviceDiscovery) getDeviceAdapterLUID(device int) (int64, error) {
 
 // Wrapper function for DeviceDiscovery_GetDeviceID
 func (d *DeviceDiscovery) getDeviceID(device int) (string, error) {
-	return d.handleStringResult(
-		procGetDeviceID.Call(d.handle, uintptr(device)),
-	)
+	return d.getDeviceString(device, deviceStringID, procGetDeviceID)
 }
 
 // Wrapper function for DeviceDiscovery_GetDeviceDescription
 func (d *DeviceDiscovery) getDeviceDescription(device int) (string, error) {
-	return d.handleStringResult(
-		procGetDeviceDescription.Call(d.handle, uintptr(device)),
-	)
+	return d.getDeviceString(device, deviceStringDescription, procGetDeviceDescription)
 }
 
 // Wrapper function for DeviceDiscovery_GetDeviceDriverRegistryKey
 func (d *DeviceDiscovery) getDeviceDriverRegistryKey(device int) (string, error) {
-	return d.handleStringResult(
-		procGetDeviceDriverRegistryKey.Call(d.handle, uintptr(device)),
-	)
+	return d.getDeviceString(device, deviceStringDriverRegistryKey, procGetDeviceDriverRegistryKey)
 }
 
 // Wrapper function for DeviceDiscovery_GetDeviceDriverStorePath
 func (d *DeviceDiscovery) getDeviceDriverStorePath(device int) (string, error) {
-	return d.handleStringResult(
-		procGetDeviceDriverStorePath.Call(d.handle, uintptr(device)),
-	)
+	return d.getDeviceString(device, deviceStringDriverStorePath, procGetDeviceDriverStorePath)
 }
 
 // Wrapper function for DeviceDiscovery_GetDeviceLocationPath
 func (d *DeviceDiscovery) getDeviceLocationPath(device int) (string, error) {
-	return d.handleStringResult(
-		procGetDeviceLocationPath.Call(d.handle, uintptr(device)),
-	)
+	return d.getDeviceString(device, deviceStringLocationPath, procGetDeviceLocationPath)
 }
 
 // Wrapper function for DeviceDiscovery_GetDeviceVendor
 func (d *DeviceDiscovery) getDeviceVendor(device int) (string, error) {
-	return d.handleStringResult(
-		procGetDeviceVendor.Call(d.handle, uintptr(device)),
+	return d.getDeviceString(device, deviceStringVendor, procGetDeviceVendor)
+}
+
+// Wrapper function for DeviceDiscovery_GetDevicePcieRoot
+func (d *DeviceDiscovery) getDevicePcieRoot(device int) (string, error) {
+	return d.getDeviceString(device, deviceStringPcieRoot, procGetDevicePcieRoot)
+}
+
+// Wrapper function for DeviceDiscovery_GetDeviceNumaNode
+func (d *DeviceDiscovery) getDeviceNumaNode(device int) (int32, error) {
+	return d.handleInt32Result(
+		procGetDeviceNumaNode.Call(d.handle, uintptr(device)),
+	)
+}
+
+// Wrapper function for DeviceDiscovery_GetDeviceDriverVersion
+func (d *DeviceDiscovery) getDeviceDriverVersion(device int) (int64, error) {
+	return d.handleInt64Result(
+		procGetDeviceDriverVersion.Call(d.handle, uintptr(device)),
+	)
+}
+
+// Wrapper function for DeviceDiscovery_GetDeviceKmdModelVersion
+func (d *DeviceDiscovery) getDeviceKmdModelVersion(device int) (int32, error) {
+	return d.handleInt32Result(
+		procGetDeviceKmdModelVersion.Call(d.handle, uintptr(device)),
+	)
+}
+
+// Wrapper function for DeviceDiscovery_GetDeviceDedicatedMemory
+func (d *DeviceDiscovery) getDeviceDedicatedMemory(device int) (int64, error) {
+	return d.handleInt64Result(
+		procGetDeviceDedicatedMemory.Call(d.handle, uintptr(device)),
+	)
+}
+
+// Wrapper function for DeviceDiscovery_GetDeviceSharedMemory
+func (d *DeviceDiscovery) getDeviceSharedMemory(device int) (int64, error) {
+	return d.handleInt64Result(
+		procGetDeviceSharedMemory.Call(d.handle, uintptr(device)),
 	)
 }
 
@@ -404,16 +689,12 @@ func (d *DeviceDiscovery) getNumRuntimeFiles(device int) (uint32, error) {
 
 // Wrapper function for DeviceDiscovery_GetRuntimeFileSource
 func (d *DeviceDiscovery) getRuntimeFileSource(device int, file int) (string, error) {
-	return d.handleStringResult(
-		procGetRuntimeFileSource.Call(d.handle, uintptr(device), uintptr(file)),
-	)
+	return d.getRuntimeFileString(device, file, runtimeFileStringSource, procGetRuntimeFileSource)
 }
 
 // Wrapper function for DeviceDiscovery_GetRuntimeFileDestination
 func (d *DeviceDiscovery) getRuntimeFileDestination(device int, file int) (string, error) {
-	return d.handleStringResult(
-		procGetRuntimeFileDestination.Call(d.handle, uintptr(device), uintptr(file)),
-	)
+	return d.getRuntimeFileString(device, file, runtimeFileStringDestination, procGetRuntimeFileDestination)
 }
 
 // Wrapper function for DeviceDiscovery_GetNumRuntimeFilesWow64
@@ -425,16 +706,12 @@ func (d *DeviceDiscovery) getNumRuntimeFilesWow64(device int) (uint32, error) {
 
 // Wrapper function for DeviceDiscovery_GetRuntimeFileSourceWow64
 func (d *DeviceDiscovery) getRuntimeFileSourceWow64(device int, file int) (string, error) {
-	return d.handleStringResult(
-		procGetRuntimeFileSourceWow64.Call(d.handle, uintptr(device), uintptr(file)),
-	)
+	return d.getRuntimeFileString(device, file, runtimeFileStringSourceWow64, procGetRuntimeFileSourceWow64)
 }
 
 // Wrapper function for DeviceDiscovery_GetRuntimeFileDestinationWow64
 func (d *DeviceDiscovery) getRuntimeFileDestinationWow64(device int, file int) (string, error) {
-	return d.handleStringResult(
-		procGetRuntimeFileDestinationWow64.Call(d.handle, uintptr(device), uintptr(file)),
-	)
+	return d.getRuntimeFileString(device, file, runtimeFileStringDestinationWow64, procGetRuntimeFileDestinationWow64)
 }
 
 // Wrapper function for DeviceDiscovery_IsDeviceIntegrated
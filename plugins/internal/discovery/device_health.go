@@ -0,0 +1,78 @@
+//go:build windows
+
+package discovery
+
+import (
+	"runtime"
+	"unsafe"
+)
+
+// The health states reported by the device discovery library (these must match the values defined in DeviceHealth.h)
+type DeviceHealth int32
+
+const (
+	DeviceHealthy DeviceHealth = 0
+	DeviceRemoved DeviceHealth = 1
+	DeviceReset   DeviceHealth = 2
+)
+
+// Returns the name of a health state
+func (h DeviceHealth) String() string {
+	switch h {
+	case DeviceHealthy:
+		return "healthy"
+	case DeviceRemoved:
+		return "removed"
+	case DeviceReset:
+		return "reset"
+	default:
+		return "unknown"
+	}
+}
+
+// Represents the result of a health check for an individual device (this must match the layout of DeviceHealthRecord in DeviceHealth.h)
+type DeviceHealthRecord struct {
+
+	// The adapter LUID of the device that the health check relates to
+	AdapterLUID int64
+
+	// The health state of the device
+	Health DeviceHealth
+
+	// The number of TDR driver resets that have been detected for the device
+	ResetCount uint32
+}
+
+// Checks the health of each device found by the last device discovery
+// (This returns an empty list if the device discovery library does not support health checks)
+func (d *DeviceDiscovery) CheckDeviceHealth() ([]DeviceHealthRecord, error) {
+
+	// Pin the goroutine to its OS thread until we return, so any error message is retrieved for the thread that made the failed call
+	runtime.LockOSThread()
+	defer runtime.UnlockOSThread()
+
+	// Determine whether the device discovery library supports health checks
+	if procCheckDeviceHealth.Find() != nil || len(d.Devices) == 0 {
+		return []DeviceHealthRecord{}, nil
+	}
+
+	records := make([]DeviceHealthRecord, len(d.Devices))
+	for {
+
+		// Check the health of all of our devices
+		count, err := d.handleUint32Result(
+			procCheckDeviceHealth.Call(d.handle, uintptr(unsafe.Pointer(&records[0])), uintptr(len(records))),
+		)
+		if err != nil {
+			return nil, err
+		}
+
+		// If the library has discovered more devices than our slice can hold then grow it to the required size and try again
+		if int(count) > len(records) {
+			records = make([]DeviceHealthRecord, count)
+			continue
+		}
+
+		return records[:count], nil
+	}
+}
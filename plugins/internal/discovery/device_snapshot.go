@@ -0,0 +1,244 @@
+//go:build windows
+
+package discovery
+
+import (
+	"encoding/binary"
+	"errors"
+	"fmt"
+	"unicode/utf16"
+)
+
+// Constants for the device snapshot format (these must match the values defined in DeviceSnapshot.h in the device discovery library)
+const (
+	snapshotMagic           = 0x53445844
+	snapshotVersion         = 3
+	snapshotHeaderSize      = 16
+	snapshotFlagIntegrated  = 0x1
+	snapshotFlagDetachable  = 0x2
+	snapshotFlagDisplay     = 0x4
+	snapshotFlagCompute     = 0x8
+	snapshotUint32Size      = 4
+	snapshotInt64Size       = 8
+	snapshotFixedDeviceSize = (snapshotInt64Size * 4) + (snapshotUint32Size * 3)
+	snapshotCodeUnitSize    = 2
+	snapshotTruncatedFormat = "device snapshot is truncated at offset %d"
+)
+
+// Reads values sequentially from a device snapshot buffer
+type snapshotReader struct {
+
+	// The snapshot data
+	data []byte
+
+	// The current read offset within the snapshot data
+	offset int
+
+	// Scratch space for decoding UTF-16 strings, reused between strings to avoid repeated allocations
+	codeUnits []uint16
+}
+
+// Verifies that the specified number of bytes remain in the snapshot buffer
+func (r *snapshotReader) require(numBytes int) error {
+	if numBytes < 0 || len(r.data)-r.offset < numBytes {
+		return fmt.Errorf(snapshotTruncatedFormat, r.offset)
+	}
+
+	return nil
+}
+
+// Reads an unsigned 32-bit integer from the snapshot buffer
+func (r *snapshotReader) readUint32() (uint32, error) {
+	if err := r.require(snapshotUint32Size); err != nil {
+		return 0, err
+	}
+
+	value := binary.LittleEndian.Uint32(r.data[r.offset:])
+	r.offset += snapshotUint32Size
+	return value, nil
+}
+
+// Reads a signed 64-bit integer from the snapshot buffer
+func (r *snapshotReader) readInt64() (int64, error) {
+	if err := r.require(snapshotInt64Size); err != nil {
+		return 0, err
+	}
+
+	value := int64(binary.LittleEndian.Uint64(r.data[r.offset:]))
+	r.offset += snapshotInt64Size
+	return value, nil
+}
+
+// Reads an unsigned 64-bit integer from the snapshot buffer
+func (r *snapshotReader) readUint64() (uint64, error) {
+	value, err := r.readInt64()
+	return uint64(value), err
+}
+
+// Reads a length-prefixed UTF-16 string from the snapshot buffer
+func (r *snapshotReader) readString() (string, error) {
+
+	// Read the length of the string
+	length, err := r.readUint32()
+	if err != nil {
+		return "", err
+	}
+
+	// Verify that the buffer contains the full string
+	numBytes := int(length) * snapshotCodeUnitSize
+	if err := r.require(numBytes); err != nil {
+		return "", err
+	}
+
+	// Decode the string
+	r.codeUnits = r.codeUnits[:0]
+	for index := 0; index < int(length); index += 1 {
+		r.codeUnits = append(r.codeUnits, binary.LittleEndian.Uint16(r.data[r.offset+(index*snapshotCodeUnitSize):]))
+	}
+	r.offset += numBytes
+	return string(utf16.Decode(r.codeUnits)), nil
+}
+
+// Reads a count-prefixed list of runtime files from the snapshot buffer
+func (r *snapshotReader) readRuntimeFiles() ([]*RuntimeFile, error) {
+
+	// Read the number of files
+	numFiles, err := r.readUint32()
+	if err != nil {
+		return nil, err
+	}
+
+	// Verify that the count is plausible before allocating the list, since each file requires at least two string lengths
+	if err := r.require(int(numFiles) * snapshotUint32Size * 2); err != nil {
+		return nil, err
+	}
+
+	// Read the details for each file
+	files := make([]*RuntimeFile, 0, numFiles)
+	for file := 0; file < int(numFiles); file += 1 {
+
+		sourcePath, err := r.readString()
+		if err != nil {
+			return nil, err
+		}
+
+		destinationFilename, err := r.readString()
+		if err != nil {
+			return nil, err
+		}
+
+		files = append(files, &RuntimeFile{
+			SourcePath:          sourcePath,
+			DestinationFilename: destinationFilename,
+		})
+	}
+
+	return files, nil
+}
+
+// Reads the details of an individual device from the snapshot buffer
+func (r *snapshotReader) readDevice() (*Device, error) {
+
+	luid, err := r.readInt64()
+	if err != nil {
+		return nil, err
+	}
+
+	flags, err := r.readUint32()
+	if err != nil {
+		return nil, err
+	}
+
+	numaNode, err := r.readUint32()
+	if err != nil {
+		return nil, err
+	}
+
+	// Read the driver version, memory sizes and kernel-mode driver model version of the device
+	device := &Device{AdapterLUID: luid, NumaNode: int32(numaNode)}
+	for _, field := range []*uint64{
+		&device.DriverVersion,
+		&device.DedicatedMemory,
+		&device.SharedMemory,
+	} {
+		if *field, err = r.readUint64(); err != nil {
+			return nil, err
+		}
+	}
+
+	if device.KmdModelVersion, err = r.readUint32(); err != nil {
+		return nil, err
+	}
+
+	// Read the string properties in the order they appear in the snapshot
+	for _, field := range []*string{
+		&device.ID,
+		&device.Description,
+		&device.DriverRegistryKey,
+		&device.DriverStorePath,
+		&device.LocationPath,
+		&device.Vendor,
+		&device.PcieRoot,
+	} {
+		if *field, err = r.readString(); err != nil {
+			return nil, err
+		}
+	}
+
+	if device.RuntimeFiles, err = r.readRuntimeFiles(); err != nil {
+		return nil, err
+	}
+
+	if device.RuntimeFilesWow64, err = r.readRuntimeFiles(); err != nil {
+		return nil, err
+	}
+
+	device.IsIntegrated = flags&snapshotFlagIntegrated != 0
+	device.IsDetachable = flags&snapshotFlagDetachable != 0
+	device.SupportsDisplay = flags&snapshotFlagDisplay != 0
+	device.SupportsCompute = flags&snapshotFlagCompute != 0
+	return device, nil
+}
+
+// Parses a device snapshot buffer produced by DeviceDiscovery_GetSnapshot
+func parseDeviceSnapshot(data []byte) ([]*Device, error) {
+
+	// Verify that the buffer contains a complete header
+	if len(data) < snapshotHeaderSize {
+		return nil, errors.New("device snapshot is smaller than the snapshot header")
+	}
+
+	// Validate the header fields
+	reader := &snapshotReader{data: data}
+	magic, _ := reader.readUint32()
+	version, _ := reader.readUint32()
+	size, _ := reader.readUint32()
+	numDevices, _ := reader.readUint32()
+	if magic != snapshotMagic {
+		return nil, fmt.Errorf("device snapshot has invalid magic number 0x%08X", magic)
+	}
+	if version != snapshotVersion {
+		return nil, fmt.Errorf("unsupported device snapshot version %d (expected %d)", version, snapshotVersion)
+	}
+	if int(size) != len(data) {
+		return nil, fmt.Errorf("device snapshot size mismatch (header specifies %d bytes, buffer contains %d bytes)", size, len(data))
+	}
+
+	// Verify that the device count is plausible before allocating the list, since each device requires at least its fixed-size fields
+	if err := reader.require(int(numDevices) * snapshotFixedDeviceSize); err != nil {
+		return nil, err
+	}
+
+	// Read the details for each device
+	devices := make([]*Device, 0, numDevices)
+	for index := 0; index < int(numDevices); index += 1 {
+		device, err := reader.readDevice()
+		if err != nil {
+			return nil, err
+		}
+
+		devices = append(devices, device)
+	}
+
+	return devices, nil
+}
@@ -0,0 +1,85 @@
+//go:build windows
+
+package discovery
+
+import (
+	"runtime"
+	"unsafe"
+)
+
+// The engine utilisation value reported for devices that have not been sampled previously
+// (this must match the value of DEVICEUSAGE_UTILISATION_UNKNOWN defined in DeviceUsage.h in the device discovery library)
+const UtilisationUnknown = -1.0
+
+// Represents a sample of the memory usage and engine utilisation of an individual device (this must match the layout of DeviceUsageRecord in DeviceUsage.h)
+type DeviceUsageRecord struct {
+
+	// The adapter LUID of the device that the sample relates to
+	AdapterLUID int64
+
+	// The number of bytes currently resident in the device's dedicated (local) memory segments
+	DedicatedMemoryUsed uint64
+
+	// The total capacity of the device's dedicated (local) memory segments, in bytes
+	DedicatedMemoryTotal uint64
+
+	// The number of bytes currently resident in the device's shared (aperture) memory segments
+	SharedMemoryUsed uint64
+
+	// The total capacity of the device's shared (aperture) memory segments, in bytes
+	SharedMemoryTotal uint64
+
+	// The utilisation of the device's busiest engine since the previous sample, in the range [0, 1], or UtilisationUnknown for the first sample
+	EngineUtilisation float64
+}
+
+// Computes the overall load for the device in the range [0, 1], which is the greater of its engine utilisation and its dedicated memory usage
+func (u *DeviceUsageRecord) Load() float64 {
+	load := 0.0
+	if u.EngineUtilisation != UtilisationUnknown {
+		load = u.EngineUtilisation
+	}
+
+	if u.DedicatedMemoryTotal > 0 {
+		memory := float64(u.DedicatedMemoryUsed) / float64(u.DedicatedMemoryTotal)
+		if memory > load {
+			load = memory
+		}
+	}
+
+	return load
+}
+
+// Samples the memory usage and engine utilisation of each device found by the last device discovery
+// (This returns an empty list if the device discovery library does not support usage sampling)
+func (d *DeviceDiscovery) GetDeviceUsage() ([]DeviceUsageRecord, error) {
+
+	// Pin the goroutine to its OS thread until we return, so any error message is retrieved for the thread that made the failed call
+	runtime.LockOSThread()
+	defer runtime.UnlockOSThread()
+
+	// Determine whether the device discovery library supports usage sampling
+	if procGetDeviceUsage.Find() != nil || len(d.Devices) == 0 {
+		return []DeviceUsageRecord{}, nil
+	}
+
+	records := make([]DeviceUsageRecord, len(d.Devices))
+	for {
+
+		// Sample the usage for all of our devices
+		count, err := d.handleUint32Result(
+			procGetDeviceUsage.Call(d.handle, uintptr(unsafe.Pointer(&records[0])), uintptr(len(records))),
+		)
+		if err != nil {
+			return nil, err
+		}
+
+		// If the library has discovered more devices than our slice can hold then grow it to the required size and try again
+		if int(count) > len(records) {
+			records = make([]DeviceUsageRecord, count)
+			continue
+		}
+
+		return records[:count], nil
+	}
+}
@@ -0,0 +1,27 @@
+//go:build windows
+
+package discovery
+
+import "fmt"
+
+type DiscoveryBackend int32
+
+const (
+	WmiBackend           DiscoveryBackend = 0
+	ConfigManagerBackend DiscoveryBackend = 1
+	D3DKMTBackend        DiscoveryBackend = 2
+)
+
+// Parses the name of a discovery backend (as used in configuration values and command-line flags)
+func ParseDiscoveryBackend(name string) (DiscoveryBackend, error) {
+	switch name {
+	case "", "wmi":
+		return WmiBackend, nil
+	case "configmanager":
+		return ConfigManagerBackend, nil
+	case "d3dkmt":
+		return D3DKMTBackend, nil
+	default:
+		return WmiBackend, fmt.Errorf("unknown discovery backend \"%s\" (supported backends are \"wmi\", \"configmanager\" and \"d3dkmt\")", name)
+	}
+}
@@ -0,0 +1,74 @@
+//go:build windows
+
+package discovery
+
+import (
+	"bytes"
+	"strings"
+	"unsafe"
+)
+
+// Represents an individual log message drained from the device discovery library's log buffer
+type LogMessage struct {
+
+	// The local time at which the message was logged, in ISO 8601 format (empty for messages generated by the log buffer itself)
+	Timestamp string
+
+	// The severity level of the message (e.g. "info")
+	Level string
+
+	// The source file and line number from which the message was logged
+	Source string
+
+	// The function from which the message was logged
+	Function string
+
+	// The message text
+	Message string
+}
+
+// Wrapper function for EnableDiscoveryLogBuffer
+func EnableDiscoveryLogBuffer(capacity uint32) {
+	procEnableDiscoveryLogBuffer.Call(uintptr(capacity))
+}
+
+// Drains all of the messages currently held in the device discovery library's log buffer, using the supplied buffer to receive them
+// (Returns nil if the log buffer has not been enabled or if there are no buffered messages)
+func DrainDiscoveryLog(buffer []byte) []*LogMessage {
+	if len(buffer) == 0 {
+		return nil
+	}
+
+	messages := []*LogMessage{}
+	for {
+
+		// Retrieve as many messages as will fit in the buffer, stopping once there are none left
+		result, _, _ := procDrainDiscoveryLog.Call(uintptr(unsafe.Pointer(&buffer[0])), uintptr(len(buffer)))
+		size := int(int32(result))
+		if size <= 0 {
+			break
+		}
+
+		// Parse each of the NUL-terminated messages
+		for _, data := range bytes.Split(bytes.TrimSuffix(buffer[:size], []byte{0}), []byte{0}) {
+			fields := strings.SplitN(string(data), "\t", 5)
+			for len(fields) < 5 {
+				fields = append([]string{""}, fields...)
+			}
+
+			messages = append(messages, &LogMessage{
+				Timestamp: fields[0],
+				Level:     fields[1],
+				Source:    fields[2],
+				Function:  fields[3],
+				Message:   fields[4],
+			})
+		}
+	}
+
+	if len(messages) == 0 {
+		return nil
+	}
+
+	return messages
+}
@@ -0,0 +1,106 @@
+//go:build windows
+
+package discovery
+
+import (
+	"runtime"
+	"unsafe"
+)
+
+// The phases of the device discovery process for which the device discovery library collects timing metrics
+type DiscoveryPhase int32
+
+const (
+	DiscoverDevicesPhase   DiscoveryPhase = 0
+	EnumerateAdaptersPhase DiscoveryPhase = 1
+	DeviceQueryPhase       DiscoveryPhase = 2
+	DeviceEnumerationPhase DiscoveryPhase = 3
+	DevicePropertiesPhase  DiscoveryPhase = 4
+	DriverDetailsPhase     DiscoveryPhase = 5
+)
+
+// Returns the name of a discovery phase, in the snake case form used for metric labels
+func (p DiscoveryPhase) String() string {
+	switch p {
+	case DiscoverDevicesPhase:
+		return "discover_devices"
+	case EnumerateAdaptersPhase:
+		return "enumerate_adapters"
+	case DeviceQueryPhase:
+		return "device_query"
+	case DeviceEnumerationPhase:
+		return "device_enumeration"
+	case DevicePropertiesPhase:
+		return "device_properties"
+	case DriverDetailsPhase:
+		return "driver_details"
+	default:
+		return "unknown"
+	}
+}
+
+// Represents the timing metrics for a single discovery phase (this must match the layout of DiscoveryMetricsRecord in DiscoveryMetrics.h)
+type DiscoveryMetricsRecord struct {
+
+	// The LUID of the adapter to which the metrics apply, or zero for metrics aggregated across all devices
+	AdapterLUID int64
+
+	// The discovery phase to which the metrics apply
+	Phase DiscoveryPhase
+
+	// Reserved for future use
+	reserved uint32
+
+	// The number of times the phase has been timed
+	Count uint64
+
+	// The duration of the most recent timing, in nanoseconds
+	LastNanoseconds uint64
+
+	// The shortest recorded duration, in nanoseconds
+	MinNanoseconds uint64
+
+	// The longest recorded duration, in nanoseconds
+	MaxNanoseconds uint64
+
+	// The sum of all recorded durations, in nanoseconds
+	TotalNanoseconds uint64
+}
+
+// Retrieves the timing metrics for each discovery phase, with the metrics aggregated across all devices listed first
+// (This returns an empty list if the device discovery library does not support metrics collection)
+func (d *DeviceDiscovery) GetMetrics() ([]DiscoveryMetricsRecord, error) {
+
+	// Pin the goroutine to its OS thread until we return, so any error message is retrieved for the thread that made the failed call
+	runtime.LockOSThread()
+	defer runtime.UnlockOSThread()
+
+	// Determine whether the device discovery library supports metrics collection
+	if procGetMetrics.Find() != nil {
+		return []DiscoveryMetricsRecord{}, nil
+	}
+
+	records := []DiscoveryMetricsRecord{}
+	for {
+
+		// Attempt to copy the metrics into our existing slice
+		var buffer uintptr
+		if len(records) > 0 {
+			buffer = uintptr(unsafe.Pointer(&records[0]))
+		}
+		count, err := d.handleUint32Result(
+			procGetMetrics.Call(d.handle, buffer, uintptr(len(records))),
+		)
+		if err != nil {
+			return nil, err
+		}
+
+		// If our slice was too small then grow it to the required size and try again
+		if int(count) > len(records) {
+			records = make([]DiscoveryMetricsRecord, count)
+			continue
+		}
+
+		return records[:count], nil
+	}
+}
@@ -0,0 +1,23 @@
+//go:build windows
+
+package discovery
+
+// Identifies a string property for the length-returning accessors (these must match the values defined in StringProperty.h in the device discovery library)
+type stringProperty int32
+
+const (
+	deviceStringID                stringProperty = 0
+	deviceStringDescription       stringProperty = 1
+	deviceStringDriverRegistryKey stringProperty = 2
+	deviceStringDriverStorePath   stringProperty = 3
+	deviceStringLocationPath      stringProperty = 4
+	deviceStringVendor            stringProperty = 5
+	deviceStringPcieRoot          stringProperty = 6
+)
+
+const (
+	runtimeFileStringSource           stringProperty = 0
+	runtimeFileStringDestination      stringProperty = 1
+	runtimeFileStringSourceWow64      stringProperty = 2
+	runtimeFileStringDestinationWow64 stringProperty = 3
+)
@@ -11,81 +11,109 @@ import (
 	"github.com/tensorworks/directx-device-plugins/plugins/internal/discovery"
 )
 
-// Generates the device specs for the supplied list of devices
-func SpecsForDevices(devices []*discovery.Device) []*pluginapi.DeviceSpec {
+// The pre-computed device spec and runtime file mounts for an individual device
+// (Plans are computed once whenever the device list is refreshed, so that allocation requests do not need to access the filesystem)
+type MountPlan struct {
 
-	specs := []*pluginapi.DeviceSpec{}
+	// The device spec that provides the physical location path for the device
+	Spec *pluginapi.DeviceSpec
 
-	// Provide the physical location path for each device, avoiding duplicates (duplicate paths can occur when
-	// multitenancy is enabled and two requested device IDs map to the same underlying physical device)
-	for _, device := range devices {
-		specs = appendUniqueSpec(specs, &pluginapi.DeviceSpec{
+	// The runtime file mounts for the device, which only include files that existed on the host when the plan was computed
+	Mounts []*pluginapi.Mount
+}
+
+// Computes the mount plan for an individual device
+func PlanForDevice(device *discovery.Device) *MountPlan {
+
+	plan := &MountPlan{
+		Spec: &pluginapi.DeviceSpec{
 			HostPath:      "vpci-location-path://" + device.LocationPath,
 			ContainerPath: "",
 			Permissions:   "",
-		})
+		},
+		Mounts: []*pluginapi.Mount{},
 	}
 
-	return specs
+	// Generates the mounts for a list of runtime files
+	destinations := make(map[string]bool)
+	generateMounts := func(files []*discovery.RuntimeFile, destinationRoot string) {
+		for _, file := range files {
+
+			// Resolve the absolute paths to the host source file and the container destination file
+			source := filepath.Join(device.DriverStorePath, file.SourcePath)
+			destination := filepath.Join(destinationRoot, file.DestinationFilename)
+
+			// Only mount the file if it exists on the host and can be accessed, and isn't a duplicate
+			if _, err := os.Stat(source); err == nil && !destinations[destination] {
+				destinations[destination] = true
+				plan.Mounts = append(plan.Mounts, &pluginapi.Mount{
+					HostPath:      source,
+					ContainerPath: destination,
+					ReadOnly:      true,
+				})
+			}
+		}
+	}
+
+	// Generate the mounts for both the System32 and SysWOW64 runtime files
+	generateMounts(device.RuntimeFiles, "C:\\Windows\\System32")
+	generateMounts(device.RuntimeFilesWow64, "C:\\Windows\\SysWOW64")
+
+	return plan
 }
 
-// Generates the runtime file mounts for the supplied list of devices
-func MountsForDevices(devices []*discovery.Device) []*pluginapi.Mount {
+// Merges the mount plans for a list of devices, returning the combined device specs and runtime file mounts
+func MergePlans(plans []*MountPlan) ([]*pluginapi.DeviceSpec, []*pluginapi.Mount) {
 
+	specs := []*pluginapi.DeviceSpec{}
 	mounts := []*pluginapi.Mount{}
 
-	for _, device := range devices {
+	// Provide the physical location path for each device, avoiding duplicates (duplicate paths can occur when
+	// multitenancy is enabled and two requested device IDs map to the same underlying physical device)
+	hostPaths := make(map[string]bool, len(plans))
+	for _, plan := range plans {
+		if !hostPaths[plan.Spec.HostPath] {
+			hostPaths[plan.Spec.HostPath] = true
+			specs = append(specs, plan.Spec)
+		}
+	}
 
-		// Generates the mounts for a list of runtime files
-		generateMounts := func(files []*discovery.RuntimeFile, destinationRoot string) {
-			for _, file := range files {
-
-				// Resolve the absolute paths to the host source file and the container destination file
-				source := filepath.Join(device.DriverStorePath, file.SourcePath)
-				destination := filepath.Join(destinationRoot, file.DestinationFilename)
-
-				// Only mount the file if it exists on the host and can be accessed, and isn't a duplicate
-				// (Note that duplicate container paths can occur not only when mounting multiple devices
-				// from a single vendor, but also when device drivers from different vendors mount files
-				// to the same target path, which means that a container will only see the files from the
-				// first device's vendor when collisions occur between different device drivers)
-				_, err := os.Stat(source)
-				if err == nil {
-					mounts = appendUniqueMount(mounts, &pluginapi.Mount{
-						HostPath:      source,
-						ContainerPath: destination,
-						ReadOnly:      true,
-					})
-				}
+	// Provide the runtime file mounts for each device, avoiding duplicates
+	// (Note that duplicate container paths can occur not only when mounting multiple devices
+	// from a single vendor, but also when device drivers from different vendors mount files
+	// to the same target path, which means that a container will only see the files from the
+	// first device's vendor when collisions occur between different device drivers)
+	containerPaths := make(map[string]bool)
+	for _, plan := range plans {
+		for _, mount := range plan.Mounts {
+			if !containerPaths[mount.ContainerPath] {
+				containerPaths[mount.ContainerPath] = true
+				mounts = append(mounts, mount)
 			}
 		}
-
-		// Generate the mounts for both the System32 and SysWOW64 runtime files
-		generateMounts(device.RuntimeFiles, "C:\\Windows\\System32")
-		generateMounts(device.RuntimeFilesWow64, "C:\\Windows\\SysWOW64")
 	}
 
-	return mounts
+	return specs, mounts
 }
 
-// Appends a device spec to an existing list of device specs if it's not already present in the list
-func appendUniqueSpec(specs []*pluginapi.DeviceSpec, newSpec *pluginapi.DeviceSpec) []*pluginapi.DeviceSpec {
-	for _, existing := range specs {
-		if existing.HostPath == newSpec.HostPath {
-			return specs
-		}
+// Computes the mount plans for the supplied list of devices, preserving the order of the list
+func plansForDeviceList(devices []*discovery.Device) []*MountPlan {
+	plans := make([]*MountPlan, 0, len(devices))
+	for _, device := range devices {
+		plans = append(plans, PlanForDevice(device))
 	}
 
-	return append(specs, newSpec)
+	return plans
 }
 
-// Appends a mount to an existing list of mounts if it's not already present in the list
-func appendUniqueMount(mounts []*pluginapi.Mount, newMount *pluginapi.Mount) []*pluginapi.Mount {
-	for _, existing := range mounts {
-		if existing.ContainerPath == newMount.ContainerPath {
-			return mounts
-		}
-	}
+// Generates the device specs for the supplied list of devices
+func SpecsForDevices(devices []*discovery.Device) []*pluginapi.DeviceSpec {
+	specs, _ := MergePlans(plansForDeviceList(devices))
+	return specs
+}
 
-	return append(mounts, newMount)
+// Generates the runtime file mounts for the supplied list of devices
+func MountsForDevices(devices []*discovery.Device) []*pluginapi.Mount {
+	_, mounts := MergePlans(plansForDeviceList(devices))
+	return mounts
 }
@@ -0,0 +1,103 @@
+//go:build windows
+
+package plugin
+
+import (
+	"sort"
+	"strconv"
+	"strings"
+	"sync"
+
+	pluginapi "k8s.io/kubelet/pkg/apis/deviceplugin/v1beta1"
+
+	"github.com/tensorworks/directx-device-plugins/plugins/internal/mount"
+)
+
+// The maximum number of distinct device sets for which allocation responses are cached for a single device list
+// (Requests beyond this limit are still served, but their responses are built afresh each time)
+const maxCachedAllocations = 4096
+
+// Caches the container allocation responses for the sets of physical devices requested from a single device list
+// (The cache is shared by every index built for the same device list, and is discarded along with the index when a new device list is received)
+type allocationCache struct {
+
+	// The cached responses, keyed by the sorted IDs of the requested physical devices
+	responses map[string]*pluginapi.ContainerAllocateResponse
+
+	// Protects the cached responses, since allocation requests are processed concurrently
+	mutex sync.RWMutex
+}
+
+// Creates an empty allocation cache
+func newAllocationCache() *allocationCache {
+	return &allocationCache{
+		responses: map[string]*pluginapi.ContainerAllocateResponse{},
+	}
+}
+
+// Retrieves the container allocation response for the specified advertised device IDs, building and caching it if it has not already been built
+// (Cached responses are shared between requests and must not be modified by the caller)
+func (i *deviceIndex) containerResponse(deviceIDs []string) (*pluginapi.ContainerAllocateResponse, error) {
+
+	// Verify that each of the requested devices exists
+	entries := make([]*indexedDevice, 0, len(deviceIDs))
+	for _, deviceID := range deviceIDs {
+		entry, err := i.lookup(deviceID)
+		if err != nil {
+			return nil, err
+		}
+
+		entries = append(entries, entry)
+	}
+
+	// Order the requested devices by physical device ID, so every request for the same set of slots shares a single response
+	// (Each requested slot is retained in the key, since the device memory reported to the container depends upon the number of slots)
+	sort.SliceStable(entries, func(a, b int) bool {
+		return entries[a].Device.ID < entries[b].Device.ID
+	})
+	ids := make([]string, 0, len(entries))
+	for _, entry := range entries {
+		ids = append(ids, entry.Device.ID)
+	}
+	key := strings.Join(ids, "\x00")
+
+	// Use the cached response if we have one
+	i.allocations.mutex.RLock()
+	cached, exists := i.allocations.responses[key]
+	i.allocations.mutex.RUnlock()
+	if exists {
+		return cached, nil
+	}
+
+	// Gather the list of mount plans for the requested devices, along with the total device memory represented by the requested slots
+	plans := make([]*mount.MountPlan, 0, len(entries))
+	memory := uint64(0)
+	for _, entry := range entries {
+		plans = append(plans, entry.Plan)
+		memory += entry.SlotMemory
+	}
+
+	// If memory slicing is enabled then inform the container of the amount of device memory it has been allocated
+	// (This is advisory only, since there is no mechanism for enforcing per-container device memory limits)
+	var envs map[string]string
+	if memory > 0 {
+		envs = map[string]string{deviceMemoryEnvVar: strconv.FormatUint(memory, 10)}
+	}
+
+	// Merge the device specs and runtime file mounts for the requested devices
+	specs, mounts := mount.MergePlans(plans)
+	response := &pluginapi.ContainerAllocateResponse{
+		Envs:    envs,
+		Devices: specs,
+		Mounts:  mounts,
+	}
+
+	// Cache the response unless the cache is full
+	i.allocations.mutex.Lock()
+	if len(i.allocations.responses) < maxCachedAllocations {
+		i.allocations.responses[key] = response
+	}
+	i.allocations.mutex.Unlock()
+
+	return response, nil
+}
@@ -0,0 +1,83 @@
+//go:build windows
+
+package plugin
+
+import (
+	"strconv"
+	"testing"
+
+	"github.com/tensorworks/directx-device-plugins/plugins/internal/discovery"
+)
+
+const mebibyte = uint64(1024 * 1024)
+
+func TestContainerResponseDeviceMemory(t *testing.T) {
+	discrete := &discovery.Device{ID: "PCI\\DISCRETE", AdapterLUID: 1, NumaNode: discovery.NumaNodeUnknown, DedicatedMemory: 8192 * mebibyte}
+	integrated := &discovery.Device{ID: "PCI\\INTEGRATED", AdapterLUID: 2, NumaNode: discovery.NumaNodeUnknown, DedicatedMemory: 128 * mebibyte}
+
+	tests := []struct {
+		name        string
+		memorySlice uint32
+		deviceIDs   []string
+		expected    uint64
+	}{
+		{"memory slicing disabled", 0, []string{"PCI\\DISCRETE\\0"}, 0},
+		{"single slot of a discrete device", 2048, []string{"PCI\\DISCRETE\\0"}, 2048 * mebibyte},
+		{"multiple slots of a discrete device", 2048, []string{"PCI\\DISCRETE\\0", "PCI\\DISCRETE\\3"}, 4096 * mebibyte},
+		{"device with less than one slice", 4096, []string{"PCI\\INTEGRATED\\0"}, 128 * mebibyte},
+		{"slots from multiple devices", 4096, []string{"PCI\\INTEGRATED\\0", "PCI\\DISCRETE\\1"}, 4224 * mebibyte},
+	}
+
+	for _, test := range tests {
+		t.Run(test.name, func(t *testing.T) {
+			config := &PluginConfig{Multitenancy: 4, MemorySlice: test.memorySlice}
+			index := newDeviceIndex([]*discovery.Device{discrete, integrated}, config, map[int64]discovery.DeviceHealth{})
+
+			response, err := index.containerResponse(test.deviceIDs)
+			if err != nil {
+				t.Fatalf("unexpected error: %v", err)
+			}
+
+			value, present := response.Envs[deviceMemoryEnvVar]
+			if test.expected == 0 {
+				if present {
+					t.Errorf("expected %s to be unset, got %s", deviceMemoryEnvVar, value)
+				}
+			} else if value != strconv.FormatUint(test.expected, 10) {
+				t.Errorf("expected %s=%d, got %q", deviceMemoryEnvVar, test.expected, value)
+			}
+		})
+	}
+}
+
+func TestContainerResponseCache(t *testing.T) {
+	device := &discovery.Device{ID: "PCI\\DISCRETE", AdapterLUID: 1, NumaNode: discovery.NumaNodeUnknown, DedicatedMemory: 8192 * mebibyte}
+	config := &PluginConfig{Multitenancy: 1, MemorySlice: 2048}
+	index := newDeviceIndex([]*discovery.Device{device}, config, map[int64]discovery.DeviceHealth{})
+
+	// Requests for the same set of slots in a different order share a response
+	first, err := index.containerResponse([]string{"PCI\\DISCRETE\\0", "PCI\\DISCRETE\\1"})
+	if err != nil {
+		t.Fatalf("unexpected error: %v", err)
+	}
+	second, err := index.containerResponse([]string{"PCI\\DISCRETE\\1", "PCI\\DISCRETE\\0"})
+	if err != nil {
+		t.Fatalf("unexpected error: %v", err)
+	}
+	if first != second {
+		t.Errorf("expected requests for the same slots to share a cached response")
+	}
+
+	// Health-only updates retain the cache, whereas a new device list does not
+	if cached, _ := index.withHealth(map[int64]discovery.DeviceHealth{}).containerResponse([]string{"PCI\\DISCRETE\\0", "PCI\\DISCRETE\\1"}); cached != first {
+		t.Errorf("expected a health-only update to retain the cached response")
+	}
+	if rebuilt, _ := newDeviceIndex([]*discovery.Device{device}, config, map[int64]discovery.DeviceHealth{}).containerResponse([]string{"PCI\\DISCRETE\\0", "PCI\\DISCRETE\\1"}); rebuilt == first {
+		t.Errorf("expected a new device list to discard the cached response")
+	}
+
+	// Unknown device IDs are rejected
+	if _, err := index.containerResponse([]string{"PCI\\UNKNOWN\\0"}); err == nil {
+		t.Errorf("expected an error for an unknown device ID")
+	}
+}
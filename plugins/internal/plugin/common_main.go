@@ -16,7 +16,26 @@ import (
 // The version number for the plugin
 const version = "0.0.1"
 
+// Describes a resource that is advertised to the Kubelet by a device plugin
+type PluginResource struct {
+
+	// The name of the device plugin that advertises the resource, which is used to name its gRPC server's Unix socket
+	PluginName string
+
+	// The resource name that the device plugin advertises to the Kubelet
+	ResourceName string
+
+	// The filter used to select the devices that are advertised under the resource
+	Filter discovery.DeviceFilter
+}
+
 func CommonMain(pluginName string, resourceName string, filter discovery.DeviceFilter) {
+	SharedMain(pluginName, []PluginResource{{PluginName: pluginName, ResourceName: resourceName, Filter: filter}})
+}
+
+// Runs a device plugin for each of the supplied resources, with all of the plugins sharing a single device watcher
+// (This allows multiple resources to be advertised by a single process without performing device discovery separately for each of them)
+func SharedMain(processName string, resources []PluginResource) {
 
 	// Create a logger that prints debug and higher verbosity level messages
 	logger, err := zap.NewDevelopment()
@@ -29,38 +48,97 @@ func CommonMain(pluginName string, resourceName string, filter discovery.DeviceF
 	defer sugar.Sync()
 
 	// Log the plugin name and version
-	sugar.Infof("Kubernetes device plugin for %s, version %s", strings.ToUpper(pluginName), version)
+	sugar.Infof("Kubernetes device plugin for %s, version %s", strings.ToUpper(processName), version)
 
 	// Load the plugin configuration data
-	config, err := LoadConfig(pluginName, sugar)
+	config, err := LoadConfig(processName, sugar)
 	if err != nil {
 		sugar.Errorf("Error: failed to load the device plugin configuration: %v", err)
 		return
 	}
 
-	// Create the device plugin and start the device watcher
-	server, err := NewDevicePlugin(pluginName, version, resourceName, filter, config, sugar)
+	// Parse the discovery backend specified by our configuration data
+	backend, err := discovery.ParseDiscoveryBackend(config.DiscoveryBackend)
 	if err != nil {
-		sugar.Errorf("Error: failed to create the device plugin: %v", err)
+		sugar.Errorf("Error: failed to parse the discovery backend: %v", err)
 		return
 	}
 
-	//Ensure the plugin is destroyed and the device watcher stopped when we complete execution
-	defer server.Destroy()
-
-	// Attempt to start the plugin's gRPC server
-	if err := server.StartServer(); err != nil {
-		sugar.Errorf("Error: failed to start the gRPC server: %v", err)
+	// Start the device watcher with a view for each of our resources
+	filters := []discovery.DeviceFilter{}
+	for _, resource := range resources {
+		filters = append(filters, resource.Filter)
+	}
+	watcher, err := NewDeviceWatcher(
+		version,
+		backend,
+		config.CacheFile,
+		filters,
+		config.IncludeIntegrated,
+		config.IncludeDetachable,
+		config.AdditionalMounts,
+		config.AdditionalMountsWow64,
+		sugar,
+	)
+	if err != nil {
+		sugar.Errorf("Error: failed to create the device watcher: %v", err)
 		return
 	}
 
-	// Ensure we perform a graceful shutdown of the gRPC server before we destroy the plugin
-	defer server.StopServer()
+	// Ensure the device watcher is stopped once all of the plugins have been destroyed
+	defer watcher.Destroy()
 
-	// Attempt to register the device plugin with the Kubelet
-	if err := server.RegisterWithKubelet(); err != nil {
-		sugar.Errorf("Error: failed to register the device plugin with the Kubelet: %v", err)
-		return
+	// Create the device plugin for each resource and start its gRPC server
+	servers := []*DevicePlugin{}
+	for index, resource := range resources {
+		server, err := NewDevicePlugin(resource.PluginName, resource.ResourceName, watcher, watcher.Views[index], config, sugar)
+		if err != nil {
+			sugar.Errorf("Error: failed to create the device plugin: %v", err)
+			return
+		}
+
+		//Ensure the plugin is destroyed when we complete execution
+		defer server.Destroy()
+
+		// Attempt to start the plugin's gRPC server
+		if err := server.StartServer(); err != nil {
+			sugar.Errorf("Error: failed to start the gRPC server: %v", err)
+			return
+		}
+
+		// Ensure we perform a graceful shutdown of the gRPC server before we destroy the plugin
+		defer server.StopServer()
+		servers = append(servers, server)
+	}
+
+	// Start the metrics server if one was requested
+	if config.MetricsAddress != "" {
+		metrics, err := NewMetricsServer(config.MetricsAddress, watcher, sugar)
+		if err != nil {
+			sugar.Errorf("Error: failed to start the metrics server: %v", err)
+			return
+		}
+
+		// Ensure the metrics server is stopped when we complete execution
+		defer metrics.Stop()
+	}
+
+	// Attempt to register each of the device plugins with the Kubelet
+	for _, server := range servers {
+		if err := server.RegisterWithKubelet(); err != nil {
+			sugar.Errorf("Error: failed to register the device plugin with the Kubelet: %v", err)
+			return
+		}
+	}
+
+	// Forward errors from all of the device plugins to a single channel
+	errors := make(chan error, len(servers))
+	for _, server := range servers {
+		go func(server *DevicePlugin) {
+			for err := range server.Errors {
+				errors <- err
+			}
+		}(server)
 	}
 
 	// Wire up a signal handler to receive shutdown requests
@@ -75,7 +153,7 @@ func CommonMain(pluginName string, resourceName string, filter discovery.DeviceF
 			sugar.Infow("Received signal", "signal", sig)
 			return
 
-		case err := <-server.Errors:
+		case err := <-errors:
 			sugar.Errorf("Error: %v", err)
 			return
 		}
@@ -0,0 +1,159 @@
+//go:build windows
+
+package plugin
+
+import (
+	"fmt"
+
+	pluginapi "k8s.io/kubelet/pkg/apis/deviceplugin/v1beta1"
+
+	"github.com/tensorworks/directx-device-plugins/plugins/internal/discovery"
+	"github.com/tensorworks/directx-device-plugins/plugins/internal/mount"
+)
+
+// An individual device in a device index, along with its pre-computed mount plan
+type indexedDevice struct {
+
+	// The underlying device
+	Device *discovery.Device
+
+	// The mount plan for the device
+	Plan *mount.MountPlan
+
+	// The IDs under which the device is advertised, one for each multitenancy slot
+	IDs []string
+
+	// The amount of dedicated device memory represented by each slot in bytes, or zero if memory slicing is disabled
+	SlotMemory uint64
+}
+
+// An immutable index of the current device list, keyed by the device IDs that are advertised to the Kubelet
+// (Indices are never modified once they have been built, so they can be shared between goroutines without locking, and only their allocation cache is mutable)
+type deviceIndex struct {
+
+	// The devices advertised to the Kubelet, including an entry for each multitenancy slot
+	advertised []*pluginapi.Device
+
+	// The physical devices in the index, in the order they are advertised
+	devices []*indexedDevice
+
+	// The index entries, keyed by advertised device ID (i.e. including the multitenancy suffix)
+	entries map[string]*indexedDevice
+
+	// The cached container allocation responses for the device list, which are reused when only device health changes
+	allocations *allocationCache
+}
+
+// Builds a device index for the supplied list of devices, marking any devices that are not healthy as such
+// (The number of slots under which each device is advertised is determined by the multitenancy and memory slicing settings in the supplied configuration)
+func newDeviceIndex(devices []*discovery.Device, config *PluginConfig, health map[int64]discovery.DeviceHealth) *deviceIndex {
+
+	// Compute the mount plan for each device, so allocation requests do not need to access the filesystem
+	entries := make([]*indexedDevice, 0, len(devices))
+	for _, device := range devices {
+
+		// Generate the advertised IDs for the device here so they can be reused when only device health changes
+		slots := config.slotsForDevice(device)
+		ids := make([]string, 0, slots)
+		for i := uint32(0); i < slots; i += 1 {
+			ids = append(ids, fmt.Sprintf("%s\\%d", device.ID, i))
+		}
+
+		entries = append(entries, &indexedDevice{
+			Device:     device,
+			Plan:       mount.PlanForDevice(device),
+			IDs:        ids,
+			SlotMemory: config.slotMemoryForDevice(device),
+		})
+	}
+
+	return buildDeviceIndex(entries, health, newAllocationCache())
+}
+
+// Builds a copy of the index that reflects the supplied device health states, reusing the existing entries, their mount plans and the allocation cache
+func (i *deviceIndex) withHealth(health map[int64]discovery.DeviceHealth) *deviceIndex {
+	return buildDeviceIndex(i.devices, health, i.allocations)
+}
+
+// Builds a device index for the supplied entries
+func buildDeviceIndex(devices []*indexedDevice, health map[int64]discovery.DeviceHealth, allocations *allocationCache) *deviceIndex {
+
+	// Determine the total number of slots, since devices may be advertised under different numbers of slots when memory slicing is enabled
+	numSlots := 0
+	for _, entry := range devices {
+		numSlots += len(entry.IDs)
+	}
+
+	index := &deviceIndex{
+		advertised:  make([]*pluginapi.Device, 0, numSlots),
+		devices:     devices,
+		entries:     make(map[string]*indexedDevice, numSlots),
+		allocations: allocations,
+	}
+
+	for _, entry := range devices {
+		device := entry.Device
+
+		// Devices are reported as healthy unless a health check has indicated otherwise
+		deviceHealth := pluginapi.Healthy
+		if state, checked := health[device.AdapterLUID]; checked && state != discovery.DeviceHealthy {
+			deviceHealth = pluginapi.Unhealthy
+		}
+
+		// Report the NUMA node for the device if it is known, so the Kubelet's Topology Manager can align it with CPU and memory allocations
+		var topology *pluginapi.TopologyInfo
+		if device.NumaNode != discovery.NumaNodeUnknown {
+			topology = &pluginapi.TopologyInfo{
+				Nodes: []*pluginapi.NUMANode{{ID: int64(device.NumaNode)}},
+			}
+		}
+
+		// Advertise each device once per slot, as per our multitenancy or memory slicing settings, with every advertised ID referring to the same entry
+		for _, id := range entry.IDs {
+			index.entries[id] = entry
+			index.advertised = append(index.advertised, &pluginapi.Device{
+				ID:       id,
+				Health:   deviceHealth,
+				Topology: topology,
+			})
+		}
+	}
+
+	return index
+}
+
+// Retrieves the index entry for the specified advertised device ID
+func (i *deviceIndex) lookup(deviceID string) (*indexedDevice, error) {
+	entry, exists := i.entries[deviceID]
+	if !exists {
+		return nil, fmt.Errorf("could not find device with ID \"%s\"", deviceID)
+	}
+
+	return entry, nil
+}
+
+// Determines whether the index advertises exactly the same devices to the Kubelet as another index
+// (This compares only the fields that are sent to the Kubelet, so an identical list need not be resent)
+func (i *deviceIndex) advertisesSameAs(other *deviceIndex) bool {
+	if other == nil || len(i.advertised) != len(other.advertised) {
+		return false
+	}
+
+	for n, device := range i.advertised {
+		previous := other.advertised[n]
+		if device.ID != previous.ID || device.Health != previous.Health || numaNodeForTopology(device.Topology) != numaNodeForTopology(previous.Topology) {
+			return false
+		}
+	}
+
+	return true
+}
+
+// Returns the NUMA node from a device's topology information, or NumaNodeUnknown if no topology information was reported
+func numaNodeForTopology(topology *pluginapi.TopologyInfo) int64 {
+	if topology == nil || len(topology.Nodes) == 0 {
+		return int64(discovery.NumaNodeUnknown)
+	}
+
+	return topology.Nodes[0].ID
+}
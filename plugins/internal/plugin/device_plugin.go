@@ -7,8 +7,7 @@ import (
 	"fmt"
 	"net"
 	"path/filepath"
-	"strings"
-	"sync"
+	"sync/atomic"
 	"time"
 
 	"go.uber.org/zap"
@@ -19,9 +18,11 @@ import (
 	pluginapi "k8s.io/kubelet/pkg/apis/deviceplugin/v1beta1"
 
 	"github.com/tensorworks/directx-device-plugins/plugins/internal/discovery"
-	"github.com/tensorworks/directx-device-plugins/plugins/internal/mount"
 )
 
+// The environment variable through which containers are informed of the device memory represented by their allocated slots when memory slicing is enabled
+const deviceMemoryEnvVar = "DIRECTX_DEVICE_MEMORY_BYTES"
+
 type DevicePlugin struct {
 
 	// The name of the plugin
@@ -37,12 +38,15 @@ type DevicePlugin struct {
 	// The resource name that the plugin advertises to the Kubelet
 	resourceName string
 
-	// The device watcher that monitors the available DirectX devices
+	// The device watcher that monitors the available DirectX devices, which may be shared with other device plugins
 	watcher *DeviceWatcher
 
-	// The most recent device list received from the device watcher, and a mutex to protect concurrent access
-	currentDevices []*discovery.Device
-	devicesMutex   sync.Mutex
+	// The view through which the device watcher reports the devices advertised by this plugin
+	view *DeviceView
+
+	// The index for the most recent device list received from the device watcher, stored as a *deviceIndex
+	// (The index is replaced in its entirety whenever the device list changes, so readers never block on the watcher)
+	devices atomic.Value
 
 	// The logger used to log diagnostic information
 	logger *zap.SugaredLogger
@@ -60,30 +64,16 @@ type DevicePlugin struct {
 	Errors chan error
 }
 
-// Creates a new device plugin
-func NewDevicePlugin(pluginName string, pluginVersion string, resourceName string, filter discovery.DeviceFilter, config *PluginConfig, logger *zap.SugaredLogger) (*DevicePlugin, error) {
-
-	// Attempt to create a new DeviceWatcher
-	watcher, err := NewDeviceWatcher(
-		pluginVersion,
-		filter,
-		config.IncludeIntegrated,
-		config.IncludeDetachable,
-		config.AdditionalMounts,
-		config.AdditionalMountsWow64,
-		logger,
-	)
-	if err != nil {
-		return nil, err
-	}
+// Creates a new device plugin that advertises the devices reported through the specified view of a device watcher
+// (The device watcher is not owned by the plugin, and must be destroyed by the caller once the plugin has been destroyed)
+func NewDevicePlugin(pluginName string, resourceName string, watcher *DeviceWatcher, view *DeviceView, config *PluginConfig, logger *zap.SugaredLogger) (*DevicePlugin, error) {
 
 	// Verify that device watcher can successfully list devices
 	select {
-	case <-watcher.Updates:
-		logger.Info("Initial device list retrieved successfully")
+	case <-view.Updates:
+		logger.Infow("Initial device list retrieved successfully", "plugin", pluginName)
 
-	case <-watcher.Errors:
-		watcher.Destroy()
+	case err := <-view.Errors:
 		return nil, fmt.Errorf("failed to perform device discovery: %v", err)
 	}
 
@@ -95,8 +85,7 @@ func NewDevicePlugin(pluginName string, pluginVersion string, resourceName strin
 		endpointDeleted: nil,
 		resourceName:    resourceName,
 		watcher:         watcher,
-		currentDevices:  []*discovery.Device{},
-		devicesMutex:    sync.Mutex{},
+		view:            view,
 		logger:          logger,
 		server:          nil,
 		restart:         make(chan struct{}, 1),
@@ -104,9 +93,12 @@ func NewDevicePlugin(pluginName string, pluginVersion string, resourceName strin
 		Errors:          make(chan error, 1),
 	}
 
-	// Forward any device watcher errors to the plugin's error channel
+	// Start with an empty device index until we receive a device list from the ListAndWatch RPC
+	plugin.devices.Store(newDeviceIndex([]*discovery.Device{}, config, map[int64]discovery.DeviceHealth{}))
+
+	// Forward any device watcher errors reported through our view to the plugin's error channel
 	go func() {
-		for err := range plugin.watcher.Errors {
+		for err := range plugin.view.Errors {
 			plugin.Errors <- err
 		}
 	}()
@@ -224,7 +216,6 @@ func (p *DevicePlugin) RestartServer() error {
 
 // Destroys our underlying resources
 func (p *DevicePlugin) Destroy() {
-	p.watcher.Destroy()
 	close(p.restart)
 	close(p.Errors)
 }
@@ -279,10 +270,10 @@ func (p *DevicePlugin) RegisterWithKubelet() error {
 
 func (p *DevicePlugin) GetDevicePluginOptions(ctx context.Context, request *pluginapi.Empty) (*pluginapi.DevicePluginOptions, error) {
 
-	// Instruct the Kubelet not to call the GetPreferredAllocation or PreStartContainer RPCs, since they aren't necessary
+	// Instruct the Kubelet to call the GetPreferredAllocation RPC so we can make topology-aware choices, but not the PreStartContainer RPC since it isn't necessary
 	p.logger.Info("GetDevicePluginOptions RPC invoked")
 	return &pluginapi.DevicePluginOptions{
-		GetPreferredAllocationAvailable: false,
+		GetPreferredAllocationAvailable: true,
 		PreStartRequired:                false,
 	}, nil
 }
@@ -293,6 +284,21 @@ func (p *DevicePlugin) ListAndWatch(request *pluginapi.Empty, stream pluginapi.D
 	p.logger.Info("ListAndWatch streaming RPC started, refreshing the device list")
 	p.watcher.ForceRefresh()
 
+	// Sends the device list for an index to the Kubelet, unless it is identical to the list that was last sent over this stream
+	var sent *deviceIndex
+	sendIndex := func(index *deviceIndex) {
+		if index.advertisesSameAs(sent) {
+			p.logger.Info("Device list is unchanged, skipping update")
+			return
+		}
+
+		p.logger.Infow("Sending device list to Kubelet", "devices", index.advertised)
+		stream.Send(&pluginapi.ListAndWatchResponse{
+			Devices: index.advertised,
+		})
+		sent = index
+	}
+
 	// Continue sending updates as our device list changes or until shutdown is requested
 	for {
 		select {
@@ -305,64 +311,62 @@ func (p *DevicePlugin) ListAndWatch(request *pluginapi.Empty, stream pluginapi.D
 			p.logger.Info("Kubelet disconnect detected, stopping ListAndWatch streaming RPC")
 			return nil
 
-		case devices := <-p.watcher.Updates:
+		case devices := <-p.view.Updates:
 			p.logger.Infow("Received new device list", "devices", devices)
 
-			// Store the device list
-			p.devicesMutex.Lock()
-			p.currentDevices = devices
-			p.devicesMutex.Unlock()
-
-			// Convert the device discovery devices to Kubernetes device plugin API devices
-			kubeletDevices := []*pluginapi.Device{}
-			for _, device := range devices {
-
-				// Advertise each device multiple times, as per our multitenancy setting
-				for i := uint32(0); i < p.config.Multitenancy; i += 1 {
-					kubeletDevices = append(kubeletDevices, &pluginapi.Device{
-						ID:     fmt.Sprintf("%s\\%d", device.ID, i),
-						Health: pluginapi.Healthy,
-					})
-				}
-			}
+			// Build the index for the new device list and swap it in, which also converts the device discovery devices to Kubernetes device plugin API devices
+			// (We swap in the new index even if the advertised list is unchanged, since the underlying device details may still have changed)
+			index := newDeviceIndex(devices, p.config, p.watcher.Health())
+			p.devices.Store(index)
+			sendIndex(index)
 
-			// Send the device list to the Kubelet
-			p.logger.Infow("Sending device list to Kubelet", "devices", kubeletDevices)
-			stream.Send(&pluginapi.ListAndWatchResponse{
-				Devices: kubeletDevices,
-			})
+		case <-p.view.HealthUpdates:
+			p.logger.Infow("Received device health update", "health", p.watcher.Health())
+
+			// Swap in an index that reflects the new health states, reusing the existing mount plans rather than performing device discovery again
+			index := p.currentIndex().withHealth(p.watcher.Health())
+			p.devices.Store(index)
+			sendIndex(index)
 		}
 	}
 }
 
-func (p *DevicePlugin) GetPreferredAllocation(context.Context, *pluginapi.PreferredAllocationRequest) (*pluginapi.PreferredAllocationResponse, error) {
+func (p *DevicePlugin) GetPreferredAllocation(ctx context.Context, request *pluginapi.PreferredAllocationRequest) (*pluginapi.PreferredAllocationResponse, error) {
 
-	// This RPC should never be called
-	return nil, status.Error(codes.Unimplemented, "GetPreferredAllocation is not implemented")
-}
+	p.logger.Infow("GetPreferredAllocation RPC invoked, processing preferred allocation request", "request", request)
+	response := &pluginapi.PreferredAllocationResponse{}
 
-// Retrieves the device with the specified ID
-func (p *DevicePlugin) GetDeviceForID(deviceID string) (*discovery.Device, error) {
+	// Process each of the container requests using a single device index, so all containers see a consistent device list
+	index := p.currentIndex()
+	usage := p.watcher.Usage()
+	for _, containerReq := range request.ContainerRequests {
+		devices, err := preferredDevices(index, usage, containerReq.AvailableDeviceIDs, containerReq.MustIncludeDeviceIDs, int(containerReq.AllocationSize))
+		if err != nil {
+			return nil, err
+		}
 
-	// Strip the multitenancy suffix from the device ID
-	backslash := strings.LastIndex(deviceID, "\\")
-	if backslash == -1 {
-		return nil, fmt.Errorf("malformed device ID \"%s\"", deviceID)
+		response.ContainerResponses = append(response.ContainerResponses, &pluginapi.ContainerPreferredAllocationResponse{
+			DeviceIDs: devices,
+		})
 	}
-	stripped := deviceID[0:backslash]
 
-	// Lock the mutex for the device list
-	p.devicesMutex.Lock()
-	defer p.devicesMutex.Unlock()
+	p.logger.Infow("Sending preferred allocation response", "response", response)
+	return response, nil
+}
 
-	// Search for a device with the specified ID
-	for _, device := range p.currentDevices {
-		if device.ID == stripped {
-			return device, nil
-		}
+// Retrieves the index for the current device list
+func (p *DevicePlugin) currentIndex() *deviceIndex {
+	return p.devices.Load().(*deviceIndex)
+}
+
+// Retrieves the device with the specified advertised ID (including the multitenancy suffix)
+func (p *DevicePlugin) GetDeviceForID(deviceID string) (*discovery.Device, error) {
+	entry, err := p.currentIndex().lookup(deviceID)
+	if err != nil {
+		return nil, err
 	}
 
-	return nil, fmt.Errorf("could not find device with ID \"%s\"", stripped)
+	return entry.Device, nil
 }
 
 func (p *DevicePlugin) Allocate(ctx context.Context, request *pluginapi.AllocateRequest) (*pluginapi.AllocateResponse, error) {
@@ -370,28 +374,17 @@ func (p *DevicePlugin) Allocate(ctx context.Context, request *pluginapi.Allocate
 	p.logger.Infow("Allocate RPC invoked, processing allocation request", "request", request)
 	response := &pluginapi.AllocateResponse{}
 
-	// Process each of the container requests
-	for _, containerReq := range request.ContainerRequests {
-
-		// Gather the list of requested devices for the container
-		devices := []*discovery.Device{}
-		for _, deviceID := range containerReq.DevicesIDs {
+	// Use a single device index for the entire request, so all containers see a consistent device list
+	index := p.currentIndex()
 
-			// Verify that the requested device exists
-			device, err := p.GetDeviceForID(deviceID)
-			if err != nil {
-				return nil, err
-			}
-
-			// Add the device to the list
-			devices = append(devices, device)
+	// Process each of the container requests, reusing the cached response for any set of devices that has already been allocated from the same device list
+	for _, containerReq := range request.ContainerRequests {
+		containerResponse, err := index.containerResponse(containerReq.DevicesIDs)
+		if err != nil {
+			return nil, err
 		}
 
-		// Generate the device specs and runtime file mounts for the requested devices, appending the container response to our overall response
-		response.ContainerResponses = append(response.ContainerResponses, &pluginapi.ContainerAllocateResponse{
-			Devices: mount.SpecsForDevices(devices),
-			Mounts:  mount.MountsForDevices(devices),
-		})
+		response.ContainerResponses = append(response.ContainerResponses, containerResponse)
 	}
 
 	p.logger.Infow("Sending allocation response", "response", response)
@@ -3,22 +3,79 @@
 package plugin
 
 import (
-	"context"
 	"fmt"
+	"runtime"
 	"strings"
+	"sync/atomic"
 	"time"
 
 	"github.com/tensorworks/directx-device-plugins/plugins/internal/discovery"
 	"go.uber.org/zap"
+	"golang.org/x/sys/windows"
 )
 
+// The interval between polling operations when refresh notifications are unavailable
+const pollingInterval = time.Second * 10
+
+// The window over which bursts of refresh notifications are coalesced into a single device discovery pass
+// (Driver installations typically raise a storm of device change notifications in quick succession)
+const refreshCoalescingWindow = time.Millisecond * 500
+
+// The interval between samples of the memory usage and engine utilisation of each device
+const usageSamplingInterval = time.Second * 5
+
+// The interval between health checks for each device
+const healthCheckInterval = time.Second * 5
+
+// The maximum number of messages retained by the device discovery library's log buffer between drain operations
+const libraryLogCapacity = 4096
+
+// The interval between drain operations for the device discovery library's log buffer, and the size of the buffer used to receive messages
+const libraryLogDrainInterval = time.Second
+const libraryLogDrainBufferSize = 64 * 1024
+
+// A filtered view of the devices reported by a device watcher, which allows multiple device plugins to share a single device discovery pass
+type DeviceView struct {
+
+	// The filter used to control which devices are reported through the view
+	filter discovery.DeviceFilter
+
+	// The channel used to report device updates
+	Updates chan []*discovery.Device
+
+	// The channel used to report changes in device health that do not affect the device list
+	HealthUpdates chan struct{}
+
+	// The channel used to report errors, which receives a copy of each error encountered by the watcher
+	// (Each view has its own channel so that every plugin sharing the watcher observes the error, rather than only the first receiver)
+	Errors chan error
+}
+
+// Reports a device list through the view without blocking, replacing any earlier list that has not yet been received
+// (Only the latest list matters to the receiving plugin, so a plugin that is not draining its updates cannot stall the watcher or the other views)
+func (v *DeviceView) publish(devices []*discovery.Device) {
+	for {
+		select {
+		case v.Updates <- devices:
+			return
+		default:
+		}
+
+		// Discard the pending list, since the watcher is the only sender and so the channel then has room for the new one
+		select {
+		case <-v.Updates:
+		default:
+		}
+	}
+}
+
 // Watches for device updates
 type DeviceWatcher struct {
 
 	// Our interface to the underlying DeviceDiscovery object from the DirectX device discovery library
 	deviceDiscovery *discovery.DeviceDiscovery
 
-	// The filter used to control which devices are reported
+	// The filter used when performing device discovery, which is AllDevices when the watcher has multiple views
 	deviceFilter discovery.DeviceFilter
 
 	// Whether to include integrated GPUs when reporting devices
@@ -36,22 +93,36 @@ type DeviceWatcher struct {
 	// The logger used to log diagnostic information
 	logger *zap.SugaredLogger
 
+	// The most recent timing metrics retrieved from the device discovery library, stored as a []discovery.DiscoveryMetricsRecord
+	// (These are retrieved by the watcher goroutine so that the DeviceDiscovery object is never accessed by multiple goroutines)
+	metrics atomic.Value
+
+	// The most recent usage samples for each device, stored as a map[int64]discovery.DeviceUsageRecord keyed by adapter LUID
+	// (These are sampled by the watcher goroutine for the same reason as the timing metrics)
+	usage atomic.Value
+
+	// The most recent health state for each device, stored as a map[int64]discovery.DeviceHealth keyed by adapter LUID
+	// (These are checked by the watcher goroutine for the same reason as the timing metrics)
+	health atomic.Value
+
+	// The buffer used to receive messages from the device discovery library's log buffer, which is reused between drain operations
+	libraryLog []byte
+
 	// The channel used to request a forced refresh of the device list
 	refresh chan struct{}
 
 	// The channel used to stop the device discovery goroutine
 	shutdown chan struct{}
 
-	// The channel used to report errors
-	Errors chan error
-
-	// The channel used to report device updates
-	Updates chan []*discovery.Device
+	// The filtered views through which device updates are reported, with one view for each of the filters supplied when the watcher was created
+	Views []*DeviceView
 }
 
 func NewDeviceWatcher(
 	expectedVersion string,
-	deviceFilter discovery.DeviceFilter,
+	backend discovery.DiscoveryBackend,
+	cacheFile string,
+	deviceFilters []discovery.DeviceFilter,
 	includeIntegrated bool,
 	includeDetachable bool,
 	additionalRuntimeFiles map[string][]*discovery.RuntimeFile,
@@ -74,15 +145,39 @@ func NewDeviceWatcher(
 		)
 	}
 
-	// Enable verbose logging for the device discovery library
-	discovery.EnableDiscoveryLogging()
+	// Enable verbose logging for the device discovery library, buffering messages in memory so logging does not perform I/O on the discovery path
+	// (The buffered messages are drained periodically by the watcher goroutine and forwarded to our own logger)
+	discovery.EnableDiscoveryLogBuffer(libraryLogCapacity)
 
-	// Create a new DeviceDiscovery object
-	deviceDiscovery, err := discovery.NewDeviceDiscovery()
+	// Create a new DeviceDiscovery object that uses the specified discovery backend
+	deviceDiscovery, err := discovery.NewDeviceDiscoveryWithBackend(backend)
 	if err != nil {
 		return nil, err
 	}
 
+	// Enable the discovery cache if a cache file was specified
+	if cacheFile != "" {
+		if err := deviceDiscovery.SetCacheFile(cacheFile); err != nil {
+			deviceDiscovery.Destroy()
+			return nil, err
+		}
+	}
+
+	// Create a view for each of the supplied filters, and discover all devices if the views need to be filtered from a common device list
+	views := []*DeviceView{}
+	for _, filter := range deviceFilters {
+		views = append(views, &DeviceView{
+			filter:        filter,
+			Updates:       make(chan []*discovery.Device, 1),
+			HealthUpdates: make(chan struct{}, 1),
+			Errors:        make(chan error, 1),
+		})
+	}
+	deviceFilter := discovery.AllDevices
+	if len(deviceFilters) == 1 {
+		deviceFilter = deviceFilters[0]
+	}
+
 	// Create the DeviceWatcher
 	watcher := &DeviceWatcher{
 		deviceDiscovery:             deviceDiscovery,
@@ -92,13 +187,16 @@ func NewDeviceWatcher(
 		additionalRuntimeFiles:      additionalRuntimeFiles,
 		additionalRuntimeFilesWow64: additionalRuntimeFilesWow64,
 		logger:                      logger,
+		libraryLog:                  make([]byte, libraryLogDrainBufferSize),
 		refresh:                     make(chan struct{}, 1),
 		shutdown:                    make(chan struct{}),
-		Errors:                      make(chan error, 1),
-		Updates:                     make(chan []*discovery.Device, 1),
+		Views:                       views,
 	}
 
 	// Start the watcher goroutine
+	watcher.metrics.Store([]discovery.DiscoveryMetricsRecord{})
+	watcher.usage.Store(map[int64]discovery.DeviceUsageRecord{})
+	watcher.health.Store(map[int64]discovery.DeviceHealth{})
 	go watcher.watchDevices()
 
 	return watcher, nil
@@ -111,8 +209,74 @@ func (d *DeviceWatcher) Destroy() {
 }
 
 // Forces a refresh of the device list, irrespective of whether the current list is stale
+// (This does not block, since a pending forced refresh will already satisfy any further requests made by plugins sharing the watcher)
 func (d *DeviceWatcher) ForceRefresh() {
-	d.refresh <- struct{}{}
+	select {
+	case d.refresh <- struct{}{}:
+	default:
+	}
+}
+
+// Returns the timing metrics from the most recent device discovery operation
+func (d *DeviceWatcher) Metrics() []discovery.DiscoveryMetricsRecord {
+	return d.metrics.Load().([]discovery.DiscoveryMetricsRecord)
+}
+
+// Returns the most recent usage samples for each device, keyed by adapter LUID
+func (d *DeviceWatcher) Usage() map[int64]discovery.DeviceUsageRecord {
+	return d.usage.Load().(map[int64]discovery.DeviceUsageRecord)
+}
+
+// Samples the usage of each device and publishes the samples (failure to sample usage is not fatal, so we just log any errors)
+func (d *DeviceWatcher) sampleUsage() {
+	records, err := d.deviceDiscovery.GetDeviceUsage()
+	if err != nil {
+		d.logger.Infow("Failed to sample device usage", "error", err)
+		return
+	}
+
+	usage := make(map[int64]discovery.DeviceUsageRecord, len(records))
+	for _, record := range records {
+		usage[record.AdapterLUID] = record
+	}
+
+	d.usage.Store(usage)
+}
+
+// Returns the most recent health state for each device, keyed by adapter LUID
+func (d *DeviceWatcher) Health() map[int64]discovery.DeviceHealth {
+	return d.health.Load().(map[int64]discovery.DeviceHealth)
+}
+
+// Checks the health of each device and publishes the results, returning true if any device's health has changed
+// (Failure to check health is not fatal, so we just log any errors and leave the previous results in place)
+func (d *DeviceWatcher) checkHealth() bool {
+	records, err := d.deviceDiscovery.CheckDeviceHealth()
+	if err != nil {
+		d.logger.Infow("Failed to check device health", "error", err)
+		return false
+	}
+
+	// Log any health transitions, treating devices that were not previously checked as healthy
+	previous := d.Health()
+	health := make(map[int64]discovery.DeviceHealth, len(records))
+	changed := len(records) != len(previous)
+	for _, record := range records {
+		health[record.AdapterLUID] = record.Health
+
+		before, existed := previous[record.AdapterLUID]
+		if !existed {
+			before = discovery.DeviceHealthy
+		}
+
+		if record.Health != before {
+			d.logger.Infow("Device health changed", "luid", record.AdapterLUID, "from", before, "to", record.Health, "resets", record.ResetCount)
+			changed = true
+		}
+	}
+
+	d.health.Store(health)
+	return changed
 }
 
 // Merges any additional runtime files into the list for a device
@@ -152,20 +316,172 @@ func (d *DeviceWatcher) refreshDevices() error {
 		d.mergeRuntimeFiles(device)
 	}
 
-	// Report the new device list
-	d.Updates <- d.deviceDiscovery.Devices
+	// Publish the updated timing metrics (failure to retrieve these is not fatal, so we just log any errors)
+	if metrics, err := d.deviceDiscovery.GetMetrics(); err != nil {
+		d.logger.Infow("Failed to retrieve device discovery metrics", "error", err)
+	} else {
+		d.metrics.Store(metrics)
+	}
+
+	// Sample the usage of the new device list immediately rather than waiting for the next sampling interval
+	d.sampleUsage()
+
+	// Check the health of the new device list so it is reflected when the list is reported
+	d.checkHealth()
+
+	// Report the new device list through each of our views
+	// (When there are multiple views, device discovery was performed for all devices and the device discovery library filters the list for each view)
+	for _, view := range d.Views {
+		devices := d.deviceDiscovery.Devices
+		if len(d.Views) > 1 {
+			filtered, err := d.deviceDiscovery.GetFilteredDevices(view.filter, d.includeIntegrated, d.includeDetachable)
+			if err != nil {
+				return err
+			}
+
+			for _, device := range filtered {
+				d.mergeRuntimeFiles(device)
+			}
+
+			devices = filtered
+		}
+
+		view.publish(devices)
+	}
+
 	return nil
 }
 
+// Starts a goroutine that waits for the refresh event from the device discovery library and reports each signal on the returned channel
+// (If refresh notifications are unavailable then the returned channel is nil, and so will never receive)
+func (d *DeviceWatcher) startRefreshNotifications() (<-chan struct{}, func()) {
+
+	// Determine whether the device discovery library supports refresh notifications
+	refreshEvent := d.deviceDiscovery.GetRefreshEventHandle()
+	if refreshEvent == 0 {
+		d.logger.Infow("Refresh notifications are unavailable, falling back to polling", "interval", pollingInterval)
+		return nil, func() {}
+	}
+
+	// Create the event used to stop the notification goroutine
+	stopEvent, err := windows.CreateEvent(nil, 1, 0, nil)
+	if err != nil {
+		d.logger.Infow("Failed to create refresh notification stop event, falling back to polling", "error", err, "interval", pollingInterval)
+		return nil, func() {}
+	}
+
+	// Wait for the refresh event to be signalled until we are stopped
+	notifications := make(chan struct{}, 1)
+	stopped := make(chan struct{})
+	go func() {
+		defer close(stopped)
+		for {
+			event, err := windows.WaitForMultipleObjects([]windows.Handle{refreshEvent, stopEvent}, false, windows.INFINITE)
+			if err != nil || event != windows.WAIT_OBJECT_0 {
+				return
+			}
+
+			// Report the notification without blocking, since a pending notification already guarantees a refresh check
+			select {
+			case notifications <- struct{}{}:
+			default:
+			}
+		}
+	}()
+
+	// Stopping the goroutine waits for it to complete, so the refresh event is not closed while it is still being waited upon
+	stop := func() {
+		windows.SetEvent(stopEvent)
+		<-stopped
+		windows.CloseHandle(stopEvent)
+	}
+
+	return notifications, stop
+}
+
+// Reports an error through each of our views without blocking
+// (The watch loop stops after reporting an error, so each view's buffered channel always has room for it unless an earlier error is still pending)
+func (d *DeviceWatcher) reportError(err error) {
+	for _, view := range d.Views {
+		select {
+		case view.Errors <- err:
+		default:
+		}
+	}
+}
+
+// Forwards any buffered log messages from the device discovery library to our own logger
+func (d *DeviceWatcher) drainLibraryLog() {
+	for _, message := range discovery.DrainDiscoveryLog(d.libraryLog) {
+
+		// Map the library's spdlog severity levels to the closest zap levels, treating any unrecognised levels as informational
+		log := d.logger.Infow
+		switch message.Level {
+		case "trace", "debug":
+			log = d.logger.Debugw
+		case "warning":
+			log = d.logger.Warnw
+		case "error", "critical":
+			log = d.logger.Errorw
+		}
+
+		log(
+			message.Message,
+			"component", "directx-device-discovery.dll",
+			"libraryTimestamp", message.Timestamp,
+			"libraryLevel", message.Level,
+			"source", message.Source,
+			"function", message.Function,
+		)
+	}
+}
+
 // The main device watch loop
 func (d *DeviceWatcher) watchDevices() {
 
+	// Pin the loop to a single OS thread, since the device discovery library reports error messages for the last operation performed by the calling thread
+	runtime.LockOSThread()
+	defer runtime.UnlockOSThread()
+
 	// Destroy the underlying DeviceDiscovery object when the loop completes
 	defer d.deviceDiscovery.Destroy()
 
-	// Use a context for waiting between polling operations rather than sleeping, so we remain responsive to shutdown and refresh events
-	sleep, cancelSleep := context.WithTimeout(context.Background(), time.Second*0)
-	defer cancelSleep()
+	// Wait for refresh notifications if they are supported, stopping before the DeviceDiscovery object is destroyed
+	notifications, stopNotifications := d.startRefreshNotifications()
+	defer stopNotifications()
+
+	// Sample device usage periodically so it is available when choosing preferred allocations
+	usageTicker := time.NewTicker(usageSamplingInterval)
+	defer usageTicker.Stop()
+
+	// Check device health periodically so driver resets and device removals are reported to the Kubelet
+	healthTicker := time.NewTicker(healthCheckInterval)
+	defer healthTicker.Stop()
+
+	// Forward the device discovery library's log messages to our own logger periodically, and once more when the loop completes
+	logTicker := time.NewTicker(libraryLogDrainInterval)
+	defer logTicker.Stop()
+	defer d.drainLibraryLog()
+
+	// Use a timer for waiting between polling operations rather than sleeping, so we remain responsive to shutdown and refresh events
+	wake := time.NewTimer(0)
+	defer wake.Stop()
+
+	// Rather than checking for changes as soon as a refresh is requested, we wait for the coalescing window so that any further requests are merged into the same check
+	coalescing := false
+	coalesce := func() {
+		if !coalescing {
+			if !wake.Stop() {
+				select {
+				case <-wake.C:
+				default:
+				}
+			}
+
+			wake.Reset(refreshCoalescingWindow)
+			coalescing = true
+		}
+	}
 
 	// Continue sending device updates until shutdown is requested:
 	forceRefresh := false
@@ -177,29 +493,52 @@ func (d *DeviceWatcher) watchDevices() {
 
 		case <-d.refresh:
 			forceRefresh = true
-			cancelSleep()
+			coalesce()
+
+		case <-notifications:
+			coalesce()
 
-		case <-sleep.Done():
+		case <-usageTicker.C:
+			d.sampleUsage()
+
+		case <-logTicker.C:
+			d.drainLibraryLog()
+
+		case <-healthTicker.C:
+
+			// Report any health changes without blocking, since a pending update will already pick up the latest health states
+			if d.checkHealth() {
+				for _, view := range d.Views {
+					select {
+					case view.HealthUpdates <- struct{}{}:
+					default:
+					}
+				}
+			}
+
+		case <-wake.C:
 
 			// Poll for device list changes
 			refresh, err := d.deviceDiscovery.IsRefreshRequired()
 			if err != nil {
-				d.Errors <- err
+				d.reportError(err)
 				return
 			}
 
 			// Retrieve the updated device list if one is available or if a forced refresh has been requested
 			if refresh || forceRefresh {
 				if err := d.refreshDevices(); err != nil {
-					d.Errors <- err
+					d.reportError(err)
 					return
 				}
 			}
 
-			// Wait 10 seconds before polling again
+			// If we are receiving refresh notifications then wait for the next notification, otherwise wait before polling again
 			forceRefresh = false
-			sleep, cancelSleep = context.WithTimeout(context.Background(), time.Second*10)
-			defer cancelSleep()
+			coalescing = false
+			if notifications == nil {
+				wake.Reset(pollingInterval)
+			}
 		}
 	}
 }
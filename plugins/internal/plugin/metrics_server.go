@@ -0,0 +1,169 @@
+//go:build windows
+
+package plugin
+
+import (
+	"errors"
+	"fmt"
+	"io"
+	"net"
+	"net/http"
+	"strings"
+
+	"github.com/tensorworks/directx-device-plugins/plugins/internal/discovery"
+	"go.uber.org/zap"
+)
+
+// The prefix for the names of all metrics that we expose
+const metricsPrefix = "directx_device_discovery_"
+
+// Describes a single metric that is derived from a discovery metrics record
+type metricDescription struct {
+
+	// The metric name, excluding our prefix
+	name string
+
+	// The Prometheus metric type ("counter" or "gauge")
+	metricType string
+
+	// The help text for the metric
+	help string
+
+	// Extracts the metric value from a discovery metrics record
+	value func(record *discovery.DiscoveryMetricsRecord) float64
+}
+
+// Converts a duration in nanoseconds to seconds, which is the base unit that Prometheus expects for durations
+func nanosecondsToSeconds(nanoseconds uint64) float64 {
+	return float64(nanoseconds) / 1e9
+}
+
+// The metrics that we expose for each discovery phase
+var phaseMetrics = []metricDescription{
+	{
+		name:       "phase_total",
+		metricType: "counter",
+		help:       "The number of times the discovery phase has been timed.",
+		value:      func(r *discovery.DiscoveryMetricsRecord) float64 { return float64(r.Count) },
+	},
+	{
+		name:       "phase_last_seconds",
+		metricType: "gauge",
+		help:       "The duration of the most recent execution of the discovery phase.",
+		value:      func(r *discovery.DiscoveryMetricsRecord) float64 { return nanosecondsToSeconds(r.LastNanoseconds) },
+	},
+	{
+		name:       "phase_min_seconds",
+		metricType: "gauge",
+		help:       "The shortest recorded duration of the discovery phase.",
+		value:      func(r *discovery.DiscoveryMetricsRecord) float64 { return nanosecondsToSeconds(r.MinNanoseconds) },
+	},
+	{
+		name:       "phase_max_seconds",
+		metricType: "gauge",
+		help:       "The longest recorded duration of the discovery phase.",
+		value:      func(r *discovery.DiscoveryMetricsRecord) float64 { return nanosecondsToSeconds(r.MaxNanoseconds) },
+	},
+	{
+		name:       "phase_seconds_total",
+		metricType: "counter",
+		help:       "The total time spent in the discovery phase.",
+		value:      func(r *discovery.DiscoveryMetricsRecord) float64 { return nanosecondsToSeconds(r.TotalNanoseconds) },
+	},
+}
+
+// Serves device discovery metrics over HTTP in the Prometheus text exposition format
+type MetricsServer struct {
+
+	// The device watcher from which metrics are retrieved
+	watcher *DeviceWatcher
+
+	// The HTTP server that services requests from Prometheus
+	server *http.Server
+
+	// The logger used to log diagnostic information
+	logger *zap.SugaredLogger
+}
+
+// Creates a new metrics server and starts listening on the specified address
+func NewMetricsServer(address string, watcher *DeviceWatcher, logger *zap.SugaredLogger) (*MetricsServer, error) {
+
+	// Attempt to listen on the specified address, so any errors are reported immediately rather than when serving
+	listener, err := net.Listen("tcp", address)
+	if err != nil {
+		return nil, err
+	}
+
+	// Create the metrics server
+	metrics := &MetricsServer{
+		watcher: watcher,
+		logger:  logger,
+	}
+
+	// Serve metrics from the conventional path
+	mux := http.NewServeMux()
+	mux.HandleFunc("/metrics", metrics.serveMetrics)
+	metrics.server = &http.Server{Handler: mux}
+
+	// Start serving requests in a separate goroutine
+	logger.Infow("Serving device discovery metrics", "address", listener.Addr().String())
+	go func() {
+		if err := metrics.server.Serve(listener); err != nil && !errors.Is(err, http.ErrServerClosed) {
+			logger.Errorf("Error: metrics server failed: %v", err)
+		}
+	}()
+
+	return metrics, nil
+}
+
+// Stops the metrics server
+func (m *MetricsServer) Stop() {
+	m.server.Close()
+}
+
+// Writes the metrics for a list of discovery metrics records
+func writeMetrics(w io.Writer, name string, description *metricDescription, help string, records []*discovery.DiscoveryMetricsRecord, perDevice bool) {
+	if len(records) == 0 {
+		return
+	}
+
+	// Write the metric metadata
+	fmt.Fprintf(w, "# HELP %s %s\n", name, help)
+	fmt.Fprintf(w, "# TYPE %s %s\n", name, description.metricType)
+
+	// Write a sample for each record
+	for _, record := range records {
+		if perDevice {
+			fmt.Fprintf(w, "%s{phase=\"%s\",adapter_luid=\"%d\"} %g\n", name, record.Phase, record.AdapterLUID, description.value(record))
+		} else {
+			fmt.Fprintf(w, "%s{phase=\"%s\"} %g\n", name, record.Phase, description.value(record))
+		}
+	}
+}
+
+// Handles requests for the current metrics
+func (m *MetricsServer) serveMetrics(w http.ResponseWriter, request *http.Request) {
+
+	// Split the records into those aggregated across all devices and those for individual devices
+	aggregated := []*discovery.DiscoveryMetricsRecord{}
+	devices := []*discovery.DiscoveryMetricsRecord{}
+	records := m.watcher.Metrics()
+	for index := range records {
+		if records[index].AdapterLUID == 0 {
+			aggregated = append(aggregated, &records[index])
+		} else {
+			devices = append(devices, &records[index])
+		}
+	}
+
+	// Format the metrics in a buffer so that the response is written in a single operation
+	builder := &strings.Builder{}
+	for index := range phaseMetrics {
+		description := &phaseMetrics[index]
+		writeMetrics(builder, metricsPrefix+description.name, description, description.help, aggregated, false)
+		writeMetrics(builder, metricsPrefix+"device_"+description.name, description, description.help+" (per device)", devices, true)
+	}
+
+	w.Header().Set("Content-Type", "text/plain; version=0.0.4")
+	io.WriteString(w, builder.String())
+}
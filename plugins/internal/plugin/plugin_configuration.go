@@ -23,12 +23,25 @@ type PluginConfig struct {
 	// The number of containers that can access each device simultaneously (set this to 1 for exclusive access)
 	Multitenancy uint32
 
+	// The amount of dedicated device memory in MiB represented by each advertised slot (leave as 0 to use the fixed Multitenancy count)
+	// (When this is set, each device is advertised once for every slice of its dedicated memory, and at least once)
+	MemorySlice uint32
+
 	// Specifies whether we advertise integrated devices (i.e. integrated GPUs)
 	IncludeIntegrated bool
 
 	// Specifies whether we advertise detachable devices (e.g. external GPUs)
 	IncludeDetachable bool
 
+	// The discovery backend used to query the details of PnP devices ("wmi", "configmanager" or "d3dkmt")
+	DiscoveryBackend string
+
+	// The absolute path to a file used to cache device details between plugin restarts (leave empty to disable caching)
+	CacheFile string
+
+	// The TCP address on which device discovery metrics are served in Prometheus text format (leave empty to disable the metrics server)
+	MetricsAddress string
+
 	// The list of additional runtime files to be mounted to System32 for each device vendor
 	AdditionalMounts map[string][]*discovery.RuntimeFile
 
@@ -36,6 +49,37 @@ type PluginConfig struct {
 	AdditionalMountsWow64 map[string][]*discovery.RuntimeFile
 }
 
+// Returns the amount of dedicated device memory represented by each advertised slot in bytes, or zero if memory slicing is disabled
+func (c *PluginConfig) memorySliceBytes() uint64 {
+	return uint64(c.MemorySlice) * 1024 * 1024
+}
+
+// Determines the number of slots under which a device is advertised, as per our multitenancy or memory slicing settings
+func (c *PluginConfig) slotsForDevice(device *discovery.Device) uint32 {
+	if c.MemorySlice == 0 {
+		return c.Multitenancy
+	}
+
+	// Devices with less than a single slice of dedicated memory (e.g. integrated GPUs) are still advertised once
+	slots := device.DedicatedMemory / c.memorySliceBytes()
+	if slots == 0 {
+		return 1
+	}
+
+	return uint32(slots)
+}
+
+// Determines the amount of dedicated device memory represented by each of a device's advertised slots in bytes, or zero if memory slicing is disabled
+// (Devices with less than a single slice of dedicated memory are advertised under a single slot that represents all of their dedicated memory)
+func (c *PluginConfig) slotMemoryForDevice(device *discovery.Device) uint64 {
+	slice := c.memorySliceBytes()
+	if device.DedicatedMemory < slice {
+		return device.DedicatedMemory
+	}
+
+	return slice
+}
+
 // Appends a default set of mounts to the supplied mounts, converting all vendor names to lower case to ensure consistency
 func appendMounts(mounts map[string][]*discovery.RuntimeFile, defaults map[string][]*discovery.RuntimeFile) map[string][]*discovery.RuntimeFile {
 
@@ -75,16 +119,24 @@ func LoadConfig(pluginName string, logger *zap.SugaredLogger) (*PluginConfig, er
 	// Set our default configuration values
 	v := viper.New()
 	v.SetDefault("multitenancy", 0)
+	v.SetDefault("memorySlice", 0)
 	v.SetDefault("includeIntegrated", false)
 	v.SetDefault("includeDetachable", false)
+	v.SetDefault("discoveryBackend", "wmi")
+	v.SetDefault("cacheFile", "")
+	v.SetDefault("metricsAddress", "")
 	v.SetDefault("additionalMounts", make(map[string][]*discovery.RuntimeFile))
 	v.SetDefault("additionalMountsWow64", make(map[string][]*discovery.RuntimeFile))
 
 	// The names of our environment variables reflect the plugin name
 	envPrefix := fmt.Sprint(strings.ToUpper(pluginName), "_DEVICE_PLUGIN_")
 	v.BindEnv("multitenancy", fmt.Sprint(envPrefix, "MULTITENANCY"))
+	v.BindEnv("memorySlice", fmt.Sprint(envPrefix, "MEMORY_SLICE"))
 	v.BindEnv("includeIntegrated", fmt.Sprint(envPrefix, "INCLUDE_INTEGRATED"))
 	v.BindEnv("includeDetachable", fmt.Sprint(envPrefix, "INCLUDE_DETACHABLE"))
+	v.BindEnv("discoveryBackend", fmt.Sprint(envPrefix, "DISCOVERY_BACKEND"))
+	v.BindEnv("cacheFile", fmt.Sprint(envPrefix, "CACHE_FILE"))
+	v.BindEnv("metricsAddress", fmt.Sprint(envPrefix, "METRICS_ADDRESS"))
 
 	// Check if a config file path was explicitly specified through an environment variable
 	configPath, configPathExists := os.LookupEnv(fmt.Sprint(envPrefix, "CONFIG_FILE"))
@@ -134,6 +186,21 @@ func LoadConfig(pluginName string, logger *zap.SugaredLogger) (*PluginConfig, er
 		c.Multitenancy = 1
 	}
 
+	// Memory slicing replaces the fixed multitenancy count, so warn if both have been specified
+	if c.MemorySlice != 0 && c.Multitenancy > 1 {
+		logger.Warnw("Both multitenancy and memory slicing were specified, ignoring multitenancy", "multitenancy", c.Multitenancy, "memorySlice", c.MemorySlice)
+	}
+
+	// Verify that the specified discovery backend is valid
+	if _, err := discovery.ParseDiscoveryBackend(c.DiscoveryBackend); err != nil {
+		return nil, err
+	}
+
+	// Verify that the cache file path is an absolute path if one was specified
+	if c.CacheFile != "" && !filepath.IsAbs(c.CacheFile) {
+		return nil, errors.New("cache file path must be an absolute path")
+	}
+
 	// Append our default mounts to any user-supplied values
 	c.AdditionalMounts = appendMounts(c.AdditionalMounts, mount.DefaultMounts)
 	c.AdditionalMountsWow64 = appendMounts(c.AdditionalMountsWow64, mount.DefaultMountsWow64)
@@ -0,0 +1,64 @@
+//go:build windows
+
+package plugin
+
+import (
+	"testing"
+
+	"github.com/tensorworks/directx-device-plugins/plugins/internal/discovery"
+)
+
+func TestSlotsForDevice(t *testing.T) {
+	tests := []struct {
+		name            string
+		multitenancy    uint32
+		memorySlice     uint32
+		dedicatedMemory uint64
+		expected        uint32
+	}{
+		{"multitenancy without memory slicing", 4, 0, 8192 * mebibyte, 4},
+		{"exclusive access without memory slicing", 1, 0, 8192 * mebibyte, 1},
+		{"memory divides evenly into slices", 1, 2048, 8192 * mebibyte, 4},
+		{"partial slices are discarded", 1, 3072, 8192 * mebibyte, 2},
+		{"exactly one slice", 1, 4096, 4096 * mebibyte, 1},
+		{"less than one slice", 1, 4096, 128 * mebibyte, 1},
+		{"no dedicated memory", 1, 4096, 0, 1},
+		{"memory slicing overrides multitenancy", 8, 4096, 16384 * mebibyte, 4},
+	}
+
+	for _, test := range tests {
+		t.Run(test.name, func(t *testing.T) {
+			config := &PluginConfig{Multitenancy: test.multitenancy, MemorySlice: test.memorySlice}
+			device := &discovery.Device{DedicatedMemory: test.dedicatedMemory}
+			if slots := config.slotsForDevice(device); slots != test.expected {
+				t.Errorf("expected %d slots, got %d", test.expected, slots)
+			}
+		})
+	}
+}
+
+func TestSlotMemoryForDevice(t *testing.T) {
+	tests := []struct {
+		name            string
+		memorySlice     uint32
+		dedicatedMemory uint64
+		expected        uint64
+	}{
+		{"memory slicing disabled", 0, 8192 * mebibyte, 0},
+		{"memory divides evenly into slices", 2048, 8192 * mebibyte, 2048 * mebibyte},
+		{"partial slices are discarded", 3072, 8192 * mebibyte, 3072 * mebibyte},
+		{"exactly one slice", 4096, 4096 * mebibyte, 4096 * mebibyte},
+		{"less than one slice", 4096, 128 * mebibyte, 128 * mebibyte},
+		{"no dedicated memory", 4096, 0, 0},
+	}
+
+	for _, test := range tests {
+		t.Run(test.name, func(t *testing.T) {
+			config := &PluginConfig{Multitenancy: 1, MemorySlice: test.memorySlice}
+			device := &discovery.Device{DedicatedMemory: test.dedicatedMemory}
+			if memory := config.slotMemoryForDevice(device); memory != test.expected {
+				t.Errorf("expected %d bytes per slot, got %d", test.expected, memory)
+			}
+		})
+	}
+}
@@ -0,0 +1,217 @@
+//go:build windows
+
+package plugin
+
+import (
+	"fmt"
+	"sort"
+	"strings"
+
+	"github.com/tensorworks/directx-device-plugins/plugins/internal/discovery"
+)
+
+// The topology details for a device that is available for allocation
+type allocationCandidate struct {
+
+	// The advertised device ID (including the multitenancy suffix)
+	id string
+
+	// The ID of the underlying physical device, which is shared by all multitenancy slots for the device
+	physicalID string
+
+	// The NUMA node to which the device is attached, or discovery.NumaNodeUnknown
+	numaNode int32
+
+	// The PCIe switch under which the device is located, or the PCIe root complex if the device is attached directly to a root port
+	pcieSwitch string
+
+	// The PCIe root complex under which the device is located
+	pcieRoot string
+
+	// The most recently sampled load of the underlying physical device, in thousandths
+	loadPermille int
+
+	// The total number of multitenancy slots under which the underlying physical device is advertised
+	totalSlots int
+
+	// The number of multitenancy slots of the underlying physical device that have already been allocated
+	allocatedSlots int
+}
+
+// Determines the PCIe switch under which a device is located, based on its location path
+// (A device's parent is the downstream port to which it is attached, so the port above that identifies the upstream switch
+// or the root port, and devices attached directly to root ports therefore share the PCIe root complex as their "switch")
+func pcieSwitchForDevice(device *discovery.Device) string {
+	components := strings.Split(device.LocationPath, "#")
+	if len(components) <= 2 {
+		return device.PcieRoot
+	}
+
+	return strings.Join(components[:len(components)-2], "#")
+}
+
+// Creates an allocation candidate for the specified advertised device ID
+func newAllocationCandidate(index *deviceIndex, usage map[int64]discovery.DeviceUsageRecord, id string) (*allocationCandidate, error) {
+	entry, err := index.lookup(id)
+	if err != nil {
+		return nil, err
+	}
+
+	// Retrieve the load of the device if it has been sampled, treating unsampled devices as idle
+	loadPermille := 0
+	if record, exists := usage[entry.Device.AdapterLUID]; exists {
+		loadPermille = int(record.Load() * 1000)
+	}
+
+	return &allocationCandidate{
+		id:           id,
+		physicalID:   entry.Device.ID,
+		numaNode:     entry.Device.NumaNode,
+		pcieSwitch:   pcieSwitchForDevice(entry.Device),
+		pcieRoot:     entry.Device.PcieRoot,
+		loadPermille: loadPermille,
+		totalSlots:   len(entry.IDs),
+	}, nil
+}
+
+// The number of criteria used when scoring allocation candidates
+const numAllocationCriteria = 7
+
+// Scores a candidate for inclusion in an allocation that already contains the selected devices, where higher scores are preferred
+// (Scores are compared lexicographically, so earlier criteria always take precedence over later criteria)
+func scoreCandidate(candidate *allocationCandidate, selected []*allocationCandidate, numaCapacity map[int32]int) [numAllocationCriteria]int {
+	score := [numAllocationCriteria]int{1, 0, 0, 0, 0, 0, 0}
+
+	for _, existing := range selected {
+
+		// Spread multitenancy slots across physical devices, so a physical device is only shared once all other devices are in use
+		if existing.physicalID == candidate.physicalID {
+			score[0] = 0
+		}
+
+		// Pack devices onto the same PCIe switch, then the same NUMA node, then the same PCIe root complex as the existing devices
+		if candidate.pcieSwitch != "" && existing.pcieSwitch == candidate.pcieSwitch {
+			score[1] += 1
+		}
+		if candidate.numaNode != discovery.NumaNodeUnknown && existing.numaNode == candidate.numaNode {
+			score[2] += 1
+		}
+		if candidate.pcieRoot != "" && existing.pcieRoot == candidate.pcieRoot {
+			score[3] += 1
+		}
+	}
+
+	// Prefer the least-loaded physical device, and then the physical device with the fewest tenants
+	score[4] = -candidate.loadPermille
+	score[5] = -candidate.allocatedSlots
+
+	// Prefer NUMA nodes with more available physical devices, so that an initial device is chosen where the rest of the allocation can be packed
+	if candidate.numaNode != discovery.NumaNodeUnknown {
+		score[6] = numaCapacity[candidate.numaNode]
+	}
+
+	return score
+}
+
+// Determines whether the first score is preferred over the second score
+func isPreferredScore(first [numAllocationCriteria]int, second [numAllocationCriteria]int) bool {
+	for criterion := range first {
+		if first[criterion] != second[criterion] {
+			return first[criterion] > second[criterion]
+		}
+	}
+
+	return false
+}
+
+// Selects the preferred devices for a container allocation request, packing devices onto the same PCIe switch and NUMA node
+// where possible while spreading multitenancy slots across physical devices and favouring the least-loaded physical devices
+// (Device IDs that are not present in the index, such as those of devices that were removed after the Kubelet received its
+// last device list, are skipped rather than failing the request, since the Kubelet treats the preferred allocation as a hint)
+func preferredDevices(index *deviceIndex, usage map[int64]discovery.DeviceUsageRecord, available []string, mustInclude []string, size int) ([]string, error) {
+
+	// Start with the devices that the allocation must include, passing through any that we cannot score so they are still included
+	selected := []*allocationCandidate{}
+	unscored := []string{}
+	included := make(map[string]bool)
+	for _, id := range mustInclude {
+		if included[id] {
+			continue
+		}
+		included[id] = true
+
+		candidate, err := newAllocationCandidate(index, usage, id)
+		if err != nil {
+			unscored = append(unscored, id)
+			continue
+		}
+
+		selected = append(selected, candidate)
+	}
+
+	// Gather the remaining available devices, sorted by ID so our choices are deterministic when devices score equally
+	candidates := []*allocationCandidate{}
+	for _, id := range available {
+		if included[id] {
+			continue
+		}
+		included[id] = true
+
+		candidate, err := newAllocationCandidate(index, usage, id)
+		if err != nil {
+			continue
+		}
+
+		candidates = append(candidates, candidate)
+	}
+	sort.Slice(candidates, func(i, j int) bool { return candidates[i].id < candidates[j].id })
+
+	// Determine how many slots of each physical device have already been allocated, since any slots not listed as available are in use
+	availableSlots := make(map[string]int)
+	for _, candidate := range append(append([]*allocationCandidate{}, selected...), candidates...) {
+		availableSlots[candidate.physicalID] += 1
+	}
+	for _, candidate := range candidates {
+		candidate.allocatedSlots = candidate.totalSlots - availableSlots[candidate.physicalID]
+	}
+
+	// Determine the number of distinct available physical devices attached to each NUMA node
+	numaCapacity := make(map[int32]int)
+	counted := make(map[string]bool)
+	for _, candidate := range candidates {
+		if !counted[candidate.physicalID] {
+			counted[candidate.physicalID] = true
+			numaCapacity[candidate.numaNode] += 1
+		}
+	}
+
+	// Verify that the request can be satisfied by the devices that the Kubelet listed
+	if size > len(included) {
+		return nil, fmt.Errorf("requested allocation size %d exceeds the %d available devices", size, len(included))
+	}
+
+	// Greedily add the highest-scoring candidate until we have selected the requested number of devices or run out of devices that we can score
+	for len(unscored)+len(selected) < size && len(candidates) > 0 {
+		best := 0
+		bestScore := scoreCandidate(candidates[0], selected, numaCapacity)
+		for candidate := 1; candidate < len(candidates); candidate += 1 {
+			score := scoreCandidate(candidates[candidate], selected, numaCapacity)
+			if isPreferredScore(score, bestScore) {
+				best = candidate
+				bestScore = score
+			}
+		}
+
+		selected = append(selected, candidates[best])
+		candidates = append(candidates[:best], candidates[best+1:]...)
+	}
+
+	// Return the IDs of the selected devices
+	ids := make([]string, 0, len(unscored)+len(selected))
+	ids = append(ids, unscored...)
+	for _, candidate := range selected {
+		ids = append(ids, candidate.id)
+	}
+
+	return ids, nil
+}
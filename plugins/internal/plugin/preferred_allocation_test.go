@@ -0,0 +1,147 @@
+//go:build windows
+
+package plugin
+
+import (
+	"reflect"
+	"testing"
+
+	"github.com/tensorworks/directx-device-plugins/plugins/internal/discovery"
+)
+
+// Creates a device attached to the specified PCIe switch port and NUMA node for use in allocation tests
+func newTopologyTestDevice(id string, luid int64, numaNode int32, switchPath string, port string) *discovery.Device {
+	return &discovery.Device{
+		ID:           id,
+		AdapterLUID:  luid,
+		NumaNode:     numaNode,
+		PcieRoot:     "PCIROOT(0)",
+		LocationPath: switchPath + "#PCI(" + port + ")#PCI(0000)",
+	}
+}
+
+// A topology with two devices under a PCIe switch on NUMA node 0, a device attached to a root port on NUMA node 0, and a device on NUMA node 1
+func newTopologyTestIndex(multitenancy uint32) *deviceIndex {
+	devices := []*discovery.Device{
+		newTopologyTestDevice("GPU0", 1, 0, "PCIROOT(0)#PCI(0100)#PCI(0000)", "0000"),
+		newTopologyTestDevice("GPU1", 2, 0, "PCIROOT(0)#PCI(0100)#PCI(0000)", "0800"),
+		newTopologyTestDevice("GPU2", 3, 0, "PCIROOT(0)", "0200"),
+		newTopologyTestDevice("GPU3", 4, 1, "PCIROOT(0)", "0300"),
+	}
+
+	return newDeviceIndex(devices, &PluginConfig{Multitenancy: multitenancy}, map[int64]discovery.DeviceHealth{})
+}
+
+func TestScoreCandidate(t *testing.T) {
+	existing := &allocationCandidate{id: "A\\0", physicalID: "A", numaNode: 0, pcieSwitch: "SW0", pcieRoot: "ROOT0"}
+
+	tests := []struct {
+		name     string
+		first    *allocationCandidate
+		second   *allocationCandidate
+		selected []*allocationCandidate
+	}{
+		{
+			"a different physical device is preferred over another slot of a selected device",
+			&allocationCandidate{id: "B\\0", physicalID: "B", numaNode: 1, pcieSwitch: "SW1", pcieRoot: "ROOT1"},
+			&allocationCandidate{id: "A\\1", physicalID: "A", numaNode: 0, pcieSwitch: "SW0", pcieRoot: "ROOT0"},
+			[]*allocationCandidate{existing},
+		},
+		{
+			"the same PCIe switch is preferred over the same NUMA node",
+			&allocationCandidate{id: "B\\0", physicalID: "B", numaNode: 1, pcieSwitch: "SW0", pcieRoot: "ROOT1"},
+			&allocationCandidate{id: "C\\0", physicalID: "C", numaNode: 0, pcieSwitch: "SW1", pcieRoot: "ROOT0"},
+			[]*allocationCandidate{existing},
+		},
+		{
+			"the same NUMA node is preferred over a lower load",
+			&allocationCandidate{id: "B\\0", physicalID: "B", numaNode: 0, pcieSwitch: "SW1", loadPermille: 900},
+			&allocationCandidate{id: "C\\0", physicalID: "C", numaNode: 1, pcieSwitch: "SW2", loadPermille: 0},
+			[]*allocationCandidate{existing},
+		},
+		{
+			"unknown NUMA nodes are not treated as matching",
+			&allocationCandidate{id: "B\\0", physicalID: "B", numaNode: discovery.NumaNodeUnknown, loadPermille: 0},
+			&allocationCandidate{id: "C\\0", physicalID: "C", numaNode: discovery.NumaNodeUnknown, loadPermille: 500},
+			[]*allocationCandidate{{id: "A\\0", physicalID: "A", numaNode: discovery.NumaNodeUnknown}},
+		},
+		{
+			"a lower load is preferred over fewer tenants",
+			&allocationCandidate{id: "B\\0", physicalID: "B", loadPermille: 100, allocatedSlots: 3},
+			&allocationCandidate{id: "C\\0", physicalID: "C", loadPermille: 200, allocatedSlots: 0},
+			[]*allocationCandidate{},
+		},
+		{
+			"fewer tenants are preferred when loads are equal",
+			&allocationCandidate{id: "B\\0", physicalID: "B", loadPermille: 100, allocatedSlots: 1},
+			&allocationCandidate{id: "C\\0", physicalID: "C", loadPermille: 100, allocatedSlots: 2},
+			[]*allocationCandidate{},
+		},
+	}
+
+	numaCapacity := map[int32]int{0: 1, 1: 1}
+	for _, test := range tests {
+		t.Run(test.name, func(t *testing.T) {
+			first := scoreCandidate(test.first, test.selected, numaCapacity)
+			second := scoreCandidate(test.second, test.selected, numaCapacity)
+			if !isPreferredScore(first, second) || isPreferredScore(second, first) {
+				t.Errorf("expected %v to be preferred over %v", first, second)
+			}
+		})
+	}
+}
+
+func TestPreferredDevices(t *testing.T) {
+	allSlots := []string{"GPU0\\0", "GPU0\\1", "GPU1\\0", "GPU1\\1", "GPU2\\0", "GPU2\\1", "GPU3\\0", "GPU3\\1"}
+
+	tests := []struct {
+		name        string
+		available   []string
+		mustInclude []string
+		size        int
+		expected    []string
+	}{
+		{"devices are packed under the same PCIe switch", allSlots, []string{}, 2, []string{"GPU0\\0", "GPU1\\0"}},
+		{"devices are packed onto the same NUMA node", allSlots, []string{}, 3, []string{"GPU0\\0", "GPU1\\0", "GPU2\\0"}},
+		{"slots are spread across physical devices", allSlots, []string{}, 5, []string{"GPU0\\0", "GPU1\\0", "GPU2\\0", "GPU3\\0", "GPU0\\1"}},
+		{"allocations are packed around required devices", allSlots, []string{"GPU1\\1"}, 2, []string{"GPU1\\1", "GPU0\\0"}},
+		{"required devices are deduplicated", allSlots, []string{"GPU3\\0", "GPU3\\0"}, 2, []string{"GPU3\\0", "GPU2\\0"}},
+		{"unknown available devices are skipped", append([]string{"GPU9\\0"}, allSlots...), []string{}, 1, []string{"GPU0\\0"}},
+		{"unknown required devices are passed through", allSlots, []string{"GPU9\\0"}, 2, []string{"GPU9\\0", "GPU0\\0"}},
+		{"allocations stop when no known devices remain", []string{"GPU9\\0", "GPU9\\1", "GPU3\\1"}, []string{}, 2, []string{"GPU3\\1"}},
+	}
+
+	index := newTopologyTestIndex(2)
+	for _, test := range tests {
+		t.Run(test.name, func(t *testing.T) {
+			devices, err := preferredDevices(index, map[int64]discovery.DeviceUsageRecord{}, test.available, test.mustInclude, test.size)
+			if err != nil {
+				t.Fatalf("unexpected error: %v", err)
+			}
+			if !reflect.DeepEqual(devices, test.expected) {
+				t.Errorf("expected %v, got %v", test.expected, devices)
+			}
+		})
+	}
+
+	// Requests larger than the list of available devices are rejected
+	if _, err := preferredDevices(index, map[int64]discovery.DeviceUsageRecord{}, []string{"GPU0\\0", "GPU0\\0"}, []string{}, 2); err == nil {
+		t.Errorf("expected an error for an allocation larger than the available devices")
+	}
+}
+
+func TestPreferredDevicesLoad(t *testing.T) {
+	usage := map[int64]discovery.DeviceUsageRecord{
+		1: {DedicatedMemoryUsed: 900, DedicatedMemoryTotal: 1000},
+		2: {DedicatedMemoryUsed: 100, DedicatedMemoryTotal: 1000},
+	}
+
+	// Devices that share the same topology are chosen by load, so the less-loaded device under the switch is preferred
+	devices, err := preferredDevices(newTopologyTestIndex(1), usage, []string{"GPU0\\0", "GPU1\\0"}, []string{}, 1)
+	if err != nil {
+		t.Fatalf("unexpected error: %v", err)
+	}
+	if !reflect.DeepEqual(devices, []string{"GPU1\\0"}) {
+		t.Errorf("expected [GPU1\\0], got %v", devices)
+	}
+}